@@ -0,0 +1,282 @@
+#include "analytics.h"
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+// Bucket 0 holds zero, bucket n holds [ 2^(n-1), 2^n ), the last one
+// everything from 16384 up
+#define cnAnalyticsBuckets 16
+
+#define cnAnalyticsRunMetrics eAnalyticsLevelScore
+
+struct AnalyticsSketch
+{
+  uint16_t m_vBuckets[ cnAnalyticsBuckets ];
+  uint16_t m_nSamples;
+  uint16_t m_nMax;
+  uint32_t m_nSum;
+};
+
+// Run and level halves are persisted under separate keys, each well
+// inside the 256 byte limit on a persisted value
+static struct AnalyticsSketch g_vAnalyticsSketches[ eAnalyticsMetricCount ];
+
+static uint32_t g_nAnalyticsRunKey = 0;
+static uint32_t g_nAnalyticsLevelKey = 0;
+
+static int g_vAnalyticsRunCounts[ eAnalyticsCounterCount ];
+static int g_vAnalyticsLevelCounts[ eAnalyticsCounterCount ];
+static int g_nAnalyticsRunStartScore = 0;
+static int g_nAnalyticsLevelStartScore = 0;
+
+static const char* const c_szAnalyticsMetricNames[ eAnalyticsMetricCount ] = {
+  "run score",
+  "run ticks",
+  "run gems",
+  "run land created",
+  "run tiles destroyed",
+  "level score",
+  "level ticks",
+  "level gems",
+  "level land created",
+  "level tiles destroyed"
+};
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+static int BucketForValue( uint32_t nValue )
+{
+  if( nValue == 0 )
+  {
+    return 0;
+  }
+
+  int nBucket = 32 - __builtin_clz( nValue );
+
+  return nBucket < cnAnalyticsBuckets ? nBucket : cnAnalyticsBuckets - 1;
+}
+
+static void HalveSketch( struct AnalyticsSketch* pSketch )
+{
+  uint16_t nSamples = 0;
+
+  for( int nBucket = 0 ; nBucket < cnAnalyticsBuckets ; ++nBucket )
+  {
+    pSketch->m_vBuckets[ nBucket ] /= 2;
+    nSamples += pSketch->m_vBuckets[ nBucket ];
+  }
+
+  // Keep the mean where it was
+  if( pSketch->m_nSamples > 0 )
+  {
+    pSketch->m_nSum = (uint32_t)( (uint64_t)pSketch->m_nSum * nSamples / pSketch->m_nSamples );
+  }
+
+  pSketch->m_nSamples = nSamples;
+}
+
+static void AddSample( EAnalyticsMetric eMetric, int nValue )
+{
+  struct AnalyticsSketch* pSketch = &g_vAnalyticsSketches[ eMetric ];
+  uint32_t nClamped = nValue > 0 ? (uint32_t)nValue : 0;
+
+  if( nClamped > UINT16_MAX )
+  {
+    nClamped = UINT16_MAX;
+  }
+
+  int nBucket = BucketForValue( nClamped );
+
+  if(    pSketch->m_vBuckets[ nBucket ] == UINT16_MAX
+      || pSketch->m_nSamples == UINT16_MAX
+      || pSketch->m_nSum > UINT32_MAX - nClamped )
+  {
+    HalveSketch( pSketch );
+  }
+
+  ++pSketch->m_vBuckets[ nBucket ];
+  ++pSketch->m_nSamples;
+  pSketch->m_nSum += nClamped;
+
+  if( nClamped > pSketch->m_nMax )
+  {
+    pSketch->m_nMax = (uint16_t)nClamped;
+  }
+}
+
+static void LoadHalf( uint32_t nKey, struct AnalyticsSketch* pSketches, int nCount )
+{
+  int nBytes = (int)sizeof( struct AnalyticsSketch ) * nCount;
+
+  if(    ! persist_exists( nKey )
+      || persist_get_size( nKey ) != nBytes
+      || persist_read_data( nKey, pSketches, nBytes ) != nBytes )
+  {
+    memset( pSketches, 0, nBytes );
+  }
+}
+
+void AnalyticsLoad( uint32_t nRunKey, uint32_t nLevelKey )
+{
+  g_nAnalyticsRunKey = nRunKey;
+  g_nAnalyticsLevelKey = nLevelKey;
+
+  LoadHalf( nRunKey, &g_vAnalyticsSketches[ 0 ], cnAnalyticsRunMetrics );
+  LoadHalf( nLevelKey, &g_vAnalyticsSketches[ cnAnalyticsRunMetrics ], eAnalyticsMetricCount - cnAnalyticsRunMetrics );
+}
+
+void AnalyticsSave()
+{
+  persist_write_data( g_nAnalyticsRunKey,
+                      &g_vAnalyticsSketches[ 0 ],
+                      sizeof( struct AnalyticsSketch ) * cnAnalyticsRunMetrics );
+
+  persist_write_data( g_nAnalyticsLevelKey,
+                      &g_vAnalyticsSketches[ cnAnalyticsRunMetrics ],
+                      sizeof( struct AnalyticsSketch ) * ( eAnalyticsMetricCount - cnAnalyticsRunMetrics ) );
+}
+
+void AnalyticsStartRun( int nScore )
+{
+  for( int nCounter = 0 ; nCounter < eAnalyticsCounterCount ; ++nCounter )
+  {
+    g_vAnalyticsRunCounts[ nCounter ] = 0;
+    g_vAnalyticsLevelCounts[ nCounter ] = 0;
+  }
+
+  g_nAnalyticsRunStartScore = nScore;
+  g_nAnalyticsLevelStartScore = nScore;
+}
+
+void AnalyticsCount( EAnalyticsCounter eCounter )
+{
+  ++g_vAnalyticsRunCounts[ eCounter ];
+  ++g_vAnalyticsLevelCounts[ eCounter ];
+}
+
+static uint16_t Saturate( int nCount )
+{
+  return nCount < UINT16_MAX ? (uint16_t)nCount : UINT16_MAX;
+}
+
+void AnalyticsGetCounts( struct AnalyticsCounts* pCounts )
+{
+  for( int nCounter = 0 ; nCounter < eAnalyticsCounterCount ; ++nCounter )
+  {
+    pCounts->m_vRun[ nCounter ] = Saturate( g_vAnalyticsRunCounts[ nCounter ] );
+    pCounts->m_vLevel[ nCounter ] = Saturate( g_vAnalyticsLevelCounts[ nCounter ] );
+  }
+}
+
+void AnalyticsSetCounts( const struct AnalyticsCounts* pCounts )
+{
+  for( int nCounter = 0 ; nCounter < eAnalyticsCounterCount ; ++nCounter )
+  {
+    g_vAnalyticsRunCounts[ nCounter ] = pCounts->m_vRun[ nCounter ];
+    g_vAnalyticsLevelCounts[ nCounter ] = pCounts->m_vLevel[ nCounter ];
+  }
+}
+
+void AnalyticsEndLevel( int nScore )
+{
+  AddSample( eAnalyticsLevelScore, nScore - g_nAnalyticsLevelStartScore );
+
+  for( int nCounter = 0 ; nCounter < eAnalyticsCounterCount ; ++nCounter )
+  {
+    AddSample( (EAnalyticsMetric)( eAnalyticsLevelTicks + nCounter ), g_vAnalyticsLevelCounts[ nCounter ] );
+    g_vAnalyticsLevelCounts[ nCounter ] = 0;
+  }
+
+  g_nAnalyticsLevelStartScore = nScore;
+}
+
+void AnalyticsEndRun( int nScore )
+{
+  AnalyticsEndLevel( nScore );
+
+  AddSample( eAnalyticsRunScore, nScore - g_nAnalyticsRunStartScore );
+
+  for( int nCounter = 0 ; nCounter < eAnalyticsCounterCount ; ++nCounter )
+  {
+    AddSample( (EAnalyticsMetric)( eAnalyticsRunTicks + nCounter ), g_vAnalyticsRunCounts[ nCounter ] );
+  }
+
+  AnalyticsStartRun( nScore );
+  AnalyticsSave();
+}
+
+int AnalyticsSamples( EAnalyticsMetric eMetric )
+{
+  return g_vAnalyticsSketches[ eMetric ].m_nSamples;
+}
+
+int AnalyticsQuantile( EAnalyticsMetric eMetric, int nPercent )
+{
+  const struct AnalyticsSketch* pSketch = &g_vAnalyticsSketches[ eMetric ];
+
+  if( pSketch->m_nSamples == 0 )
+  {
+    return 0;
+  }
+
+  // Rank of the sample we want, in 1/100ths so the interpolation below
+  // doesn't lose everything to integer division
+  int nRank = pSketch->m_nSamples * nPercent;
+  int nBelow = 0;
+
+  for( int nBucket = 0 ; nBucket < cnAnalyticsBuckets ; ++nBucket )
+  {
+    int nInBucket = pSketch->m_vBuckets[ nBucket ] * 100;
+
+    if( nInBucket == 0 || nBelow + nInBucket < nRank )
+    {
+      nBelow += nInBucket;
+      continue;
+    }
+
+    if( nBucket == 0 )
+    {
+      return 0;
+    }
+
+    int nLow = 1 << ( nBucket - 1 );
+    int nHigh = nBucket == cnAnalyticsBuckets - 1 ? pSketch->m_nMax + 1 : 1 << nBucket;
+    int nValue = nLow + (int)( (int64_t)( nHigh - nLow ) * ( nRank - nBelow ) / nInBucket );
+
+    return nValue < pSketch->m_nMax ? nValue : pSketch->m_nMax;
+  }
+
+  return pSketch->m_nMax;
+}
+
+int AnalyticsMean( EAnalyticsMetric eMetric )
+{
+  const struct AnalyticsSketch* pSketch = &g_vAnalyticsSketches[ eMetric ];
+
+  return pSketch->m_nSamples > 0 ? (int)( pSketch->m_nSum / pSketch->m_nSamples ) : 0;
+}
+
+int AnalyticsMax( EAnalyticsMetric eMetric )
+{
+  return g_vAnalyticsSketches[ eMetric ].m_nMax;
+}
+
+void AnalyticsLogSummary()
+{
+  for( int nMetric = 0 ; nMetric < eAnalyticsMetricCount ; ++nMetric )
+  {
+    EAnalyticsMetric eMetric = (EAnalyticsMetric)nMetric;
+
+    APP_LOG( APP_LOG_LEVEL_INFO,
+             "analytics %s : %d samples, mean %d, p50 %d, p90 %d, max %d",
+             c_szAnalyticsMetricNames[ nMetric ],
+             AnalyticsSamples( eMetric ),
+             AnalyticsMean( eMetric ),
+             AnalyticsQuantile( eMetric, 50 ),
+             AnalyticsQuantile( eMetric, 90 ),
+             AnalyticsMax( eMetric ) );
+  }
+}
@@ -0,0 +1,80 @@
+#ifndef HOPPER_ANALYTICS_H
+#define HOPPER_ANALYTICS_H
+
+#include <pebble.h>
+
+// -------------------------------------------------------------------
+// Gameplay analytics
+//
+// Each metric is a fixed size log2 histogram, so memory and the
+// persisted blob stay the same size however many games are played.
+// Counting an event is one add, ending a level or a run is one bucket
+// increment per metric, and a quantile is a walk over the 16 buckets,
+// never over past games. Values inside a bucket are interpolated, so a
+// quantile is good to within its power of two.
+//
+// When a bucket would overflow every bucket is halved, older games
+// fade out and the shape of the distribution is kept.
+//
+
+typedef enum
+{
+  eAnalyticsTicks = 0,
+  eAnalyticsGems = 1,
+  eAnalyticsLandCreated = 2,
+  eAnalyticsTilesDestroyed = 3,
+  eAnalyticsCounterCount = 4
+} EAnalyticsCounter;
+
+// Per run metrics, then the same again per level
+typedef enum
+{
+  eAnalyticsRunScore = 0,
+  eAnalyticsRunTicks,
+  eAnalyticsRunGems,
+  eAnalyticsRunLandCreated,
+  eAnalyticsRunTilesDestroyed,
+  eAnalyticsLevelScore,
+  eAnalyticsLevelTicks,
+  eAnalyticsLevelGems,
+  eAnalyticsLevelLandCreated,
+  eAnalyticsLevelTilesDestroyed,
+  eAnalyticsMetricCount
+} EAnalyticsMetric;
+
+// Counts of the run and level in progress. Undo keeps a copy in each
+// snapshot and puts it back, so a hop undone and taken again is only
+// counted once.
+struct AnalyticsCounts
+{
+  uint16_t m_vRun[ eAnalyticsCounterCount ];
+  uint16_t m_vLevel[ eAnalyticsCounterCount ];
+};
+
+// Reads the sketches back from persistent storage, fresh ones if there
+// are none or they are from an older layout
+void AnalyticsLoad( uint32_t nRunKey, uint32_t nLevelKey );
+void AnalyticsSave();
+
+void AnalyticsStartRun( int nScore );
+void AnalyticsCount( EAnalyticsCounter eCounter );
+
+// Above 65535 a count is kept as 65535, as it would be in the sketch
+void AnalyticsGetCounts( struct AnalyticsCounts* pCounts );
+void AnalyticsSetCounts( const struct AnalyticsCounts* pCounts );
+
+// Score is the running total, the level's share is worked out here
+void AnalyticsEndLevel( int nScore );
+
+// Ends the level in progress as well, and saves
+void AnalyticsEndRun( int nScore );
+
+// Samples in the sketch, halved along with the buckets
+int AnalyticsSamples( EAnalyticsMetric eMetric );
+int AnalyticsQuantile( EAnalyticsMetric eMetric, int nPercent );
+int AnalyticsMean( EAnalyticsMetric eMetric );
+int AnalyticsMax( EAnalyticsMetric eMetric );
+
+void AnalyticsLogSummary();
+
+#endif // HOPPER_ANALYTICS_H
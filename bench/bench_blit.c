@@ -0,0 +1,370 @@
+// -------------------------------------------------------------------
+// Host benchmark : SDK draw calls vs the framebuffer blit kernels
+//
+// Build and run from the repo root :
+//
+//   cc -O2 -Ihost -I. bench/bench_blit.c drawlist.c blit.c rng.c host/pebble_gfx.c -o bench_blit
+//   ./bench_blit
+//
+// Plays the same draw lists out through both paths of the draw list,
+// checks the two framebuffers match bit for bit over a spread of random
+// boards, and that culling the hidden block faces changes nothing on
+// them either, then times a frame on each path. Any board that doesn't
+// match fails the run. The SDK path runs on the
+// software rasterizer in host/pebble_gfx.c, so its absolute numbers are
+// only a stand-in for the watch.
+//
+// The same boards are drawn through the SDK path with the hidden block
+// faces culled and with every block drawn whole, counting the pixels the
+// rasterizer actually writes, overdraw included.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+#include <pebble.h>
+
+#include "bitboard.h"
+#include "drawlist.h"
+#include "rng.h"
+
+#define cnBoardsCompared 3000
+#define cnFramesTimed 20000
+#define cnSprites 9
+#define cnEnemies 3
+
+static const GPathInfo ISOBLOCK = {
+  .num_points = 6,
+  .points = (GPoint []) { { 0, 5 }, { 8, 0 }, { 16, 5 }, { 16, 9 }, { 8, 14 }, { 0, 9 } }
+};
+
+static const GPathInfo ISOBLOCKTOP = {
+  .num_points = 4,
+  .points = (GPoint []) { { 0, 5 }, { 8, 0 }, { 16, 5 }, { 8, 10 } }
+};
+
+static const GPathInfo ISOBLOCKTOPLEFT = {
+  .num_points = 6,
+  .points = (GPoint []) { { 0, 5 }, { 8, 0 }, { 16, 5 }, { 8, 10 }, { 8, 14 }, { 0, 9 } }
+};
+
+static const GPathInfo ISOBLOCKTOPRIGHT = {
+  .num_points = 6,
+  .points = (GPoint []) { { 0, 5 }, { 8, 0 }, { 16, 5 }, { 16, 9 }, { 8, 14 }, { 8, 10 } }
+};
+
+static const GPathInfo EXITMARKER = {
+  .num_points = 7,
+  .points = (GPoint []) { { 1, 2 }, { 3, 2 }, { 3, 0 }, { 6, 3 }, { 3, 6 }, { 3, 4 }, { 0, 4 } }
+};
+
+static const GPathInfo DANGERMARKER = {
+  .num_points = 4,
+  .points = (GPoint []) { { 3, 5 }, { 8, 2 }, { 13, 5 }, { 8, 8 } }
+};
+
+static uint8_t g_vSdkFrame[ cnHostScreenHeight * 20 ];
+static uint8_t g_vWholeFrame[ cnHostScreenHeight * 20 ];
+
+static double NowNs()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint64_t NowCycles()
+{
+#ifdef HAVE_RDTSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// A blob of a silhouette with dark detail inside, white outside so the
+// AND pass leaves the background alone, like the real sprite art
+static void MakeSprite( struct Rng* pRng, GBitmap** ppMask, GBitmap** ppSprite )
+{
+  *ppMask = gbitmap_create_blank( GSize( 16, 16 ), GBitmapFormat1Bit );
+  *ppSprite = gbitmap_create_blank( GSize( 16, 16 ), GBitmapFormat1Bit );
+
+  uint8_t* pMask = gbitmap_get_data( *ppMask );
+  uint8_t* pSprite = gbitmap_get_data( *ppSprite );
+  int nBytesPerRow = gbitmap_get_bytes_per_row( *ppMask );
+
+  for( int y = 0 ; y < 16 ; ++y )
+  {
+    for( int x = 0 ; x < 16 ; ++x )
+    {
+      int nDX = 2 * x - 15;
+      int nDY = 2 * y - 15;
+      bool fInside = nDX * nDX + nDY * nDY < 196;
+      bool fWhite = ! fInside || RngBelow( pRng, 3 ) != 0;
+
+      if( fInside )
+      {
+        pMask[ y * nBytesPerRow + x / 8 ] |= (uint8_t)( 1 << ( x % 8 ) );
+      }
+
+      if( fWhite )
+      {
+        pSprite[ y * nBytesPerRow + x / 8 ] |= (uint8_t)( 1 << ( x % 8 ) );
+      }
+    }
+  }
+}
+
+// One frame's list the way DrawIsoTiles builds it, from a random board.
+// Drawing every block whole takes the same draws, so a seed gives the
+// same board either way.
+static void BuildFrame( struct Rng* pRng, bool fCullHiddenFaces )
+{
+  Bitboard nLand = 0;
+  Bitboard nGems = 0;
+  Bitboard nDanger = 0;
+
+  for( int nCell = 0 ; nCell < 64 ; ++nCell )
+  {
+    if( RngBelow( pRng, 6 ) != 0 )
+    {
+      nLand |= (Bitboard)1 << nCell;
+
+      if( RngBelow( pRng, 5 ) == 0 )
+      {
+        nGems |= (Bitboard)1 << nCell;
+      }
+      else if( RngBelow( pRng, 6 ) == 0 )
+      {
+        nDanger |= (Bitboard)1 << nCell;
+      }
+    }
+  }
+
+  Bitboard nBridge = ~nLand & BitboardNeighbours( nLand ) & RngNext( pRng );
+
+  int nPlayerX = RngBelow( pRng, 8 );
+  int nPlayerY = RngBelow( pRng, 8 );
+  int nExitX = RngBelow( pRng, 8 );
+  int nExitY = RngBelow( pRng, 8 );
+  bool fBounce = RngBelow( pRng, 2 ) != 0;
+
+  Bitboard nEnemies = 0;
+
+  for( int nEnemy = 0 ; nEnemy < cnEnemies ; ++nEnemy )
+  {
+    nEnemies |= BitboardCell( RngBelow( pRng, 8 ), RngBelow( pRng, 8 ) );
+  }
+
+  Bitboard nLandFront = BitboardShiftNW( BitboardShiftNE( nLand ) );
+  Bitboard nLeftHidden = BitboardShiftNE( nLand ) & nLandFront;
+  Bitboard nRightHidden = BitboardShiftNW( nLand ) & nLandFront;
+
+  DrawListBegin();
+
+  for( int x = 0 ; x < 8 ; ++x )
+  {
+    for( int y = 7 ; y >= 0 ; --y )
+    {
+      int nXPx = -5 + ( y + 1 ) * 8 + x * 8;
+      int nYPx = 84 + x * 5 - ( y + 1 ) * 5;
+
+      if( BitboardTest( nLand, x, y ) )
+      {
+        int nFaces = eBlockFaceAll;
+
+        if( fCullHiddenFaces )
+        {
+          if( BitboardTest( nLeftHidden, x, y ) ) nFaces &= ~eBlockFaceLeft;
+          if( BitboardTest( nRightHidden, x, y ) ) nFaces &= ~eBlockFaceRight;
+        }
+
+        DrawListAddBlock( nXPx, nYPx, nFaces );
+
+        if( BitboardTest( nDanger, x, y ) )
+        {
+          DrawListAddDangerMarker( nXPx, nYPx );
+        }
+      }
+      else if( BitboardTest( nBridge, x, y ) )
+      {
+        DrawListAddBridgeHint( nXPx, nYPx );
+      }
+
+      if( x == nExitX && y == nExitY )
+      {
+        DrawListAddExitMarker( nXPx + 5, nYPx + 2, fBounce );
+      }
+
+      if( BitboardTest( nEnemies, x, y ) )
+      {
+        DrawListAddSprite( 4 + (int)RngBelow( pRng, 4 ), nXPx, nYPx - 8 );
+      }
+      else if( BitboardTest( nGems, x, y ) )
+      {
+        DrawListAddSprite( 8, nXPx, nYPx - 8 + ( fBounce ? 2 : 0 ) );
+      }
+
+      if( x == nPlayerX && y == nPlayerY )
+      {
+        DrawListAddSprite( (int)RngBelow( pRng, 4 ), nXPx, nYPx - 8 );
+      }
+    }
+  }
+}
+
+static void ClearScreen()
+{
+  GBitmap* pScreen = host_screen_bitmap();
+  memset( gbitmap_get_data( pScreen ), 0, (size_t)gbitmap_get_bytes_per_row( pScreen ) * cnHostScreenHeight );
+}
+
+static void DrawFrame( bool fBlit )
+{
+  ClearScreen();
+  DrawListSetFramebufferBlit( fBlit );
+  DrawListDraw( host_graphics_context() );
+}
+
+// Every board drawn whole through the SDK, then with the hidden faces
+// culled, then culled through the blit path, all three bit for bit
+static int CompareBoards()
+{
+  struct Rng rng;
+  RngSeed( &rng, 2024 );
+
+  uint8_t* pScreen = gbitmap_get_data( host_screen_bitmap() );
+  int nCullMismatches = 0;
+  int nBlitMismatches = 0;
+
+  for( int nBoard = 0 ; nBoard < cnBoardsCompared ; ++nBoard )
+  {
+    struct Rng boardRng = rng;
+
+    BuildFrame( &boardRng, false );
+    DrawFrame( false );
+    memcpy( g_vWholeFrame, pScreen, sizeof( g_vWholeFrame ) );
+
+    BuildFrame( &rng, true );
+    DrawFrame( false );
+    memcpy( g_vSdkFrame, pScreen, sizeof( g_vSdkFrame ) );
+
+    if( memcmp( g_vWholeFrame, g_vSdkFrame, sizeof( g_vSdkFrame ) ) != 0 )
+    {
+      ++nCullMismatches;
+    }
+
+    DrawFrame( true );
+
+    if( memcmp( g_vSdkFrame, pScreen, sizeof( g_vSdkFrame ) ) != 0 )
+    {
+      ++nBlitMismatches;
+    }
+  }
+
+  printf( "boards_compared %d\n", cnBoardsCompared );
+  printf( "boards_culled_mismatched %d\n", nCullMismatches );
+  printf( "boards_mismatched %d\n", nBlitMismatches );
+  printf( "culled_pixel_identical %d\n", nCullMismatches == 0 );
+  printf( "pixel_identical %d\n", nBlitMismatches == 0 );
+
+  return nCullMismatches + nBlitMismatches;
+}
+
+// Pixels written a frame on the SDK path, over the compared boards
+static double PixelWritesPerFrame( bool fCullHiddenFaces )
+{
+  struct Rng rng;
+  RngSeed( &rng, 2024 );
+
+  long nWrites = 0;
+
+  for( int nBoard = 0 ; nBoard < cnBoardsCompared ; ++nBoard )
+  {
+    BuildFrame( &rng, fCullHiddenFaces );
+
+    long nBefore = host_pixel_writes();
+    DrawFrame( false );
+    nWrites += host_pixel_writes() - nBefore;
+  }
+
+  return (double)nWrites / cnBoardsCompared;
+}
+
+static void CountPixelWrites()
+{
+  double fCulled = PixelWritesPerFrame( true );
+  double fWhole = PixelWritesPerFrame( false );
+
+  printf( "pixel_writes_per_frame %.0f\n", fCulled );
+  printf( "pixel_writes_unculled_per_frame %.0f\n", fWhole );
+  printf( "pixel_writes_saved_pct %.1f\n", fWhole > 0 ? 100.0 * ( fWhole - fCulled ) / fWhole : 0.0 );
+}
+
+static void TimePath( bool fBlit, const char* szName )
+{
+  struct Rng rng;
+  RngSeed( &rng, 7 );
+  BuildFrame( &rng, true );
+
+  // Warm up, and on the blit path capture the stamps
+  DrawFrame( fBlit );
+
+  double fStart = NowNs();
+  uint64_t nStartCycles = NowCycles();
+
+  for( int nFrame = 0 ; nFrame < cnFramesTimed ; ++nFrame )
+  {
+    DrawFrame( fBlit );
+  }
+
+  uint64_t nCycles = NowCycles() - nStartCycles;
+  double fNs = ( NowNs() - fStart ) / cnFramesTimed;
+
+  printf( "frame_%s_items %d\n", szName, DrawListItemCount() );
+  printf( "frame_%s_ns %.0f\n", szName, fNs );
+
+#ifdef HAVE_RDTSC
+  printf( "frame_%s_cycles %.0f\n", szName, (double)nCycles / cnFramesTimed );
+#else
+  (void)nCycles;
+#endif
+}
+
+int main()
+{
+  DrawListInit( gpath_create( &ISOBLOCK ),
+                gpath_create( &ISOBLOCKTOP ),
+                gpath_create( &ISOBLOCKTOPLEFT ),
+                gpath_create( &ISOBLOCKTOPRIGHT ),
+                gpath_create( &EXITMARKER ),
+                gpath_create( &DANGERMARKER ) );
+
+  struct Rng rng;
+  RngSeed( &rng, 1 );
+
+  for( int nSprite = 0 ; nSprite < cnSprites ; ++nSprite )
+  {
+    GBitmap* pMask;
+    GBitmap* pSprite;
+
+    MakeSprite( &rng, &pMask, &pSprite );
+    DrawListSetSprite( nSprite, pMask, pSprite );
+  }
+
+  int nMismatches = CompareBoards();
+
+  CountPixelWrites();
+
+  TimePath( false, "sdk" );
+  TimePath( true, "blit" );
+
+  return nMismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+// -------------------------------------------------------------------
+// Host benchmark : incremental component tracking vs full relabel
+//
+// Build and run from the repo root :
+//
+//   cc -O2 -I. bench/bench_connectivity.c connectivity.c -o bench_connectivity
+//   ./bench_connectivity
+//
+// Replays the same stream of single tile flips through both
+// ConnectivitySetTile and ConnectivityRebuild, checks they agree and
+// reports the cost per flip of each.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "connectivity.h"
+
+#define cnFlips 200000
+
+static double NowNs()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint64_t g_nSeed = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t NextRandom()
+{
+  g_nSeed ^= g_nSeed << 13;
+  g_nSeed ^= g_nSeed >> 7;
+  g_nSeed ^= g_nSeed << 17;
+  return g_nSeed;
+}
+
+static Bitboard StartingLand()
+{
+  // Same 5 in 6 land density as GenerateNewMap
+  Bitboard nLand = 0;
+
+  for( int nCell = 0 ; nCell < 64 ; ++nCell )
+  {
+    if( NextRandom() % 6 != 0 )
+    {
+      nLand |= (Bitboard)1 << nCell;
+    }
+  }
+
+  return nLand;
+}
+
+int main()
+{
+  static uint8_t vFlips[ cnFlips ];
+
+  for( int nFlip = 0 ; nFlip < cnFlips ; ++nFlip )
+  {
+    vFlips[ nFlip ] = (uint8_t)( NextRandom() % 64 );
+  }
+
+  Bitboard nStart = StartingLand();
+
+  //
+  //  Check the incremental labels match a full relabel after every flip
+  //
+
+  Bitboard nLand = nStart;
+  ConnectivityRebuild( nLand );
+
+  for( int nFlip = 0 ; nFlip < cnFlips / 10 ; ++nFlip )
+  {
+    int nCell = vFlips[ nFlip ];
+
+    nLand ^= (Bitboard)1 << nCell;
+    ConnectivitySetTile( nLand, nCell / 8, nCell % 8, ( nLand >> nCell ) & 1 );
+
+    for( int nCheck = 0 ; nCheck < 64 ; ++nCheck )
+    {
+      Bitboard nExpected = ( nLand >> nCheck ) & 1 ? ConnectivityFlood( (Bitboard)1 << nCheck, nLand ) : 0;
+
+      if( ConnectivityComponentOf( nCheck / 8, nCheck % 8 ) != nExpected )
+      {
+        fprintf( stderr, "mismatch at flip %d cell %d\n", nFlip, nCheck );
+        return 1;
+      }
+    }
+  }
+
+  //
+  //  Time both
+  //
+
+  nLand = nStart;
+  ConnectivityRebuild( nLand );
+
+  double fStart = NowNs();
+
+  for( int nFlip = 0 ; nFlip < cnFlips ; ++nFlip )
+  {
+    int nCell = vFlips[ nFlip ];
+
+    nLand ^= (Bitboard)1 << nCell;
+    ConnectivitySetTile( nLand, nCell / 8, nCell % 8, ( nLand >> nCell ) & 1 );
+  }
+
+  double fIncrementalNs = ( NowNs() - fStart ) / cnFlips;
+  int nIncrementalComponents = ConnectivityComponentCount();
+
+  nLand = nStart;
+  fStart = NowNs();
+
+  for( int nFlip = 0 ; nFlip < cnFlips ; ++nFlip )
+  {
+    nLand ^= (Bitboard)1 << vFlips[ nFlip ];
+    ConnectivityRebuild( nLand );
+  }
+
+  double fRebuildNs = ( NowNs() - fStart ) / cnFlips;
+
+  if( ConnectivityComponentCount() != nIncrementalComponents )
+  {
+    fprintf( stderr, "component count mismatch\n" );
+    return 1;
+  }
+
+  printf( "connectivity_incremental_ns_per_flip %.1f\n", fIncrementalNs );
+  printf( "connectivity_rebuild_ns_per_flip %.1f\n", fRebuildNs );
+  printf( "connectivity_speedup %.2f\n", fRebuildNs / fIncrementalNs );
+
+  return 0;
+}
@@ -0,0 +1,87 @@
+// -------------------------------------------------------------------
+// Host benchmark : batched environment throughput
+//
+// Build and run from the repo root :
+//
+//   cc -O2 -pthread -I. bench/bench_env.c env/hopper_env.c env/hopper_game.c rng.c -o bench_env
+//   ./bench_env [ games ] [ steps ]
+//
+// Steps every game with random actions, first on one thread and then on
+// every core, and reports env steps per second for each.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "env/hopper_env.h"
+
+static double NowNs()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void Run( int nGames, int nSteps, int nThreads )
+{
+  struct HopperEnv* pEnv = HopperEnvCreate( nGames, nThreads, 1234 );
+
+  if( ! pEnv )
+  {
+    fprintf( stderr, "env create failed\n" );
+    exit( 1 );
+  }
+
+  uint8_t* pnActions = (uint8_t*)malloc( (size_t)nGames );
+  struct Rng rng;
+  RngSeed( &rng, 99 );
+
+  long nEpisodes = 0;
+  double fRewardTotal = 0.0;
+  double fStepNs = 0.0;
+
+  for( int nStep = 0 ; nStep < nSteps ; ++nStep )
+  {
+    // Mostly hop, sometimes turn
+    for( int nGame = 0 ; nGame < nGames ; ++nGame )
+    {
+      uint32_t nDraw = RngNext( &rng );
+      pnActions[ nGame ] = ( nDraw & 3 ) == 0 ? (uint8_t)( ( nDraw >> 2 ) & 1 ) : eHopperActionHop;
+    }
+
+    double fStart = NowNs();
+    HopperEnvStep( pEnv, pnActions );
+    fStepNs += NowNs() - fStart;
+
+    const uint8_t* pnDones = HopperEnvDones( pEnv );
+    const float* pfRewards = HopperEnvRewards( pEnv );
+
+    for( int nGame = 0 ; nGame < nGames ; ++nGame )
+    {
+      nEpisodes += pnDones[ nGame ];
+      fRewardTotal += pfRewards[ nGame ];
+    }
+  }
+
+  double fSteps = (double)nGames * nSteps;
+
+  printf( "env_threads %d\n", HopperEnvThreadCount( pEnv ) );
+  printf( "env_steps_per_sec %.0f\n", fSteps / ( fStepNs * 1e-9 ) );
+  printf( "env_ns_per_step %.2f\n", fStepNs / fSteps );
+  printf( "env_episodes %ld mean_reward_per_step %.3f\n", nEpisodes, fRewardTotal / fSteps );
+
+  free( pnActions );
+  HopperEnvDestroy( pEnv );
+}
+
+int main( int argc, char** argv )
+{
+  int nGames = argc > 1 ? atoi( argv[ 1 ] ) : 65536;
+  int nSteps = argc > 2 ? atoi( argv[ 2 ] ) : 200;
+
+  Run( nGames, nSteps, 1 );
+  Run( nGames, nSteps, 0 );
+
+  return 0;
+}
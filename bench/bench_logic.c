@@ -0,0 +1,581 @@
+// -------------------------------------------------------------------
+// Host benchmark : game logic in main.c
+//
+// Build with the host build, or by hand from the repo root :
+//
+//   cmake -S . -B build && cmake --build build --target bench_logic
+//   ./build/bench_logic [ scale ]
+//
+// Builds main.c itself against the host stand-in for the SDK and times
+// the logic functions one call at a time on boards dealt from fixed
+// seeds. Each function reports ops, ns per op, ops per second and a
+// checksum of what the calls returned, so a change that moves the
+// numbers can be told apart from one that changes the behaviour.
+// Scale multiplies every op count, 1 by default.
+//
+// Calls that change the game are run in batches from a saved state and
+// the state is put back between batches. Putting it back is timed on
+// its own and taken off.
+//
+// Idle frames are the play view redrawn with only the bounce changing,
+// once drawn in full and once through the frame memo, and checked to
+// come out the same. A run of live ticks gives the memo's hit rate in
+// actual play.
+//
+// The host twin of the rules in env/ is played alongside main.c from the
+// same seeds and the same actions, and the two checked to stay in step.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// main.c's types and globals are file scope, so take the whole file and
+// keep its entry point out of the way
+#define main HopperAppMain
+#include "main.c"
+#undef main
+
+#include "env/hopper_game.h"
+
+#define cnBoards 8
+#define cnBatchOps 64
+
+struct BenchState
+{
+  struct GameOptions m_gameOptions;
+  bool m_vMap[ cnArrayWidth ][ cnArrayHeight ];
+  Bitboard m_nLandBits;
+  Bitboard m_nGemBits;
+};
+
+static struct BenchState g_vBoards[ cnBoards ];
+
+static double NowNs()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void SaveState( struct BenchState* pState )
+{
+  pState->m_gameOptions = g_gameOptions;
+  memcpy( pState->m_vMap, g_nMap, sizeof( g_nMap ) );
+  pState->m_nLandBits = g_nLandBits;
+  pState->m_nGemBits = EntityStoreCells( eEntityKindGem );
+}
+
+static void RestoreState( const struct BenchState* pState )
+{
+  g_gameOptions = pState->m_gameOptions;
+  memcpy( g_nMap, pState->m_vMap, sizeof( g_nMap ) );
+  g_nLandBits = pState->m_nLandBits;
+
+  EntityStoreSetKindCells( eEntityKindGem, pState->m_nGemBits, 0 );
+  PlaceEnemyEntities();
+
+  PathingRebuild( g_nLandBits );
+  ConnectivityRebuild( g_nLandBits );
+}
+
+// Live levels from seeds 1 to 8, enough score to build land. The back
+// half have their gems taken so a level complete check walks the map.
+static void DealBoards()
+{
+  for( int nBoard = 0 ; nBoard < cnBoards ; ++nBoard )
+  {
+    RngSeed( &g_gameOptions.m_rng, (uint64_t)( nBoard + 1 ) );
+
+    g_gameOptions.m_nScore = 1000;
+    g_gameOptions.m_fGameOver = false;
+    g_nLevelsDealt = 0;
+
+    GenerateNewMap();
+
+    if( nBoard >= cnBoards / 2 )
+    {
+      EntityStoreClearKind( eEntityKindGem );
+    }
+
+    SaveState( &g_vBoards[ nBoard ] );
+  }
+}
+
+static void Report( const char* szName, long nOps, double fNs, uint32_t nChecksum )
+{
+  printf( "%s_ops %ld\n", szName, nOps );
+  printf( "%s_ns_per_op %.2f\n", szName, fNs / (double)nOps );
+  printf( "%s_ops_per_sec %.0f\n", szName, (double)nOps / ( fNs * 1e-9 ) );
+  printf( "%s_checksum %08x\n", szName, nChecksum );
+}
+
+static uint32_t Mix( uint32_t nChecksum, uint32_t nValue )
+{
+  return ( nChecksum ^ nValue ) * 16777619u;
+}
+
+// -------------------------------------------------------------------
+// Read only
+//
+
+static void BenchHandleEntityMove( long nOps )
+{
+  uint32_t nChecksum = 2166136261u;
+  double fNs = 0.0;
+  long nDone = 0;
+
+  while( nDone < nOps )
+  {
+    for( int nBoard = 0 ; nBoard < cnBoards && nDone < nOps ; ++nBoard )
+    {
+      RestoreState( &g_vBoards[ nBoard ] );
+
+      double fStart = NowNs();
+
+      for( int nCell = 0 ; nCell < cnArrayWidth * cnArrayHeight * 4 ; ++nCell, ++nDone )
+      {
+        int nNewX = -1;
+        int nNewY = -1;
+
+        bool fMoved = HandleEntityMove( ( nCell >> 2 ) / cnArrayHeight,
+                                        ( nCell >> 2 ) % cnArrayHeight,
+                                        (EEntityDirectionFacing)( nCell & 3 ),
+                                        false,
+                                        &nNewX,
+                                        &nNewY,
+                                        false );
+
+        nChecksum = Mix( nChecksum, (uint32_t)fMoved | (uint32_t)( nNewX + 1 ) << 1 | (uint32_t)( nNewY + 1 ) << 5 );
+      }
+
+      fNs += NowNs() - fStart;
+    }
+  }
+
+  Report( "HandleEntityMove", nDone, fNs, nChecksum );
+}
+
+static void BenchGetDistanceAndDirection( long nOps )
+{
+  uint32_t nChecksum = 2166136261u;
+  double fNs = 0.0;
+  long nDone = 0;
+
+  while( nDone < nOps )
+  {
+    for( int nBoard = 0 ; nBoard < cnBoards && nDone < nOps ; ++nBoard )
+    {
+      RestoreState( &g_vBoards[ nBoard ] );
+
+      double fStart = NowNs();
+
+      for( int nCell = 0 ; nCell < cnArrayWidth * cnArrayHeight ; ++nCell, ++nDone )
+      {
+        EEntityDirectionFacing eDirection = eEntityFacingNE;
+        int nDistance = 0;
+
+        GetDisanceAndDirectionToPlayer( nCell / cnArrayHeight, nCell % cnArrayHeight, &eDirection, &nDistance );
+
+        nChecksum = Mix( nChecksum, (uint32_t)eDirection | (uint32_t)nDistance << 2 );
+      }
+
+      fNs += NowNs() - fStart;
+    }
+  }
+
+  Report( "GetDisanceAndDirectionToPlayer", nDone, fNs, nChecksum );
+}
+
+static void BenchCheckIfLevelIsComplete( long nOps )
+{
+  uint32_t nChecksum = 2166136261u;
+  double fNs = 0.0;
+  long nDone = 0;
+
+  while( nDone < nOps )
+  {
+    for( int nBoard = 0 ; nBoard < cnBoards && nDone < nOps ; ++nBoard )
+    {
+      RestoreState( &g_vBoards[ nBoard ] );
+
+      double fStart = NowNs();
+
+      for( int nCall = 0 ; nCall < 256 ; ++nCall, ++nDone )
+      {
+        nChecksum = Mix( nChecksum, (uint32_t)CheckIfLevelIsComplete() );
+      }
+
+      fNs += NowNs() - fStart;
+    }
+  }
+
+  Report( "CheckIfLevelIsComplete", nDone, fNs, nChecksum );
+}
+
+// -------------------------------------------------------------------
+// Changing the game
+//
+
+static uint32_t GameChecksum( uint32_t nChecksum )
+{
+  nChecksum = Mix( nChecksum, (uint32_t)g_nLandBits );
+  nChecksum = Mix( nChecksum, (uint32_t)( g_nLandBits >> 32 ) );
+  nChecksum = Mix( nChecksum, (uint32_t)g_gameOptions.m_nScore );
+  nChecksum = Mix( nChecksum, (uint32_t)g_gameOptions.m_fGameOver );
+
+  for( int nEnemy = 0 ; nEnemy < g_gameOptions.m_nNumberOfEnemies ; ++nEnemy )
+  {
+    nChecksum = Mix( nChecksum,   (uint32_t)g_gameOptions.m_enemiesArray[ nEnemy ].m_nX
+                                | (uint32_t)g_gameOptions.m_enemiesArray[ nEnemy ].m_nY << 4
+                                | (uint32_t)g_gameOptions.m_enemiesArray[ nEnemy ].m_eDirectionFacing << 8 );
+  }
+
+  return nChecksum;
+}
+
+// Restores alone, to take off the batched timings below
+static double RestoreNs( long nBatches )
+{
+  double fStart = NowNs();
+
+  for( long nBatch = 0 ; nBatch < nBatches ; ++nBatch )
+  {
+    RestoreState( &g_vBoards[ nBatch % cnBoards ] );
+  }
+
+  return NowNs() - fStart;
+}
+
+static void BenchHandleEnemyUnitMove( long nOps )
+{
+  uint32_t nChecksum = 2166136261u;
+  long nBatches = ( nOps + cnBatchOps - 1 ) / cnBatchOps;
+
+  double fStart = NowNs();
+
+  for( long nBatch = 0 ; nBatch < nBatches ; ++nBatch )
+  {
+    RestoreState( &g_vBoards[ nBatch % cnBoards ] );
+
+    for( int nOp = 0 ; nOp < cnBatchOps ; ++nOp )
+    {
+      struct EntityPos* pEnemy = &g_gameOptions.m_enemiesArray[ nOp % g_gameOptions.m_nNumberOfEnemies ];
+
+      HandleEnemyUnitMove( &pEnemy->m_nX, &pEnemy->m_nY, &pEnemy->m_eDirectionFacing );
+    }
+
+    nChecksum = GameChecksum( nChecksum );
+  }
+
+  double fNs = NowNs() - fStart - RestoreNs( nBatches );
+
+  Report( "HandleEnemyUnitMove", nBatches * cnBatchOps, fNs, nChecksum );
+}
+
+static void BenchTickEnemyUnits( long nOps )
+{
+  uint32_t nChecksum = 2166136261u;
+  long nBatches = ( nOps + cnBatchOps - 1 ) / cnBatchOps;
+
+  double fStart = NowNs();
+
+  for( long nBatch = 0 ; nBatch < nBatches ; ++nBatch )
+  {
+    RestoreState( &g_vBoards[ nBatch % cnBoards ] );
+
+    for( int nOp = 0 ; nOp < cnBatchOps ; ++nOp )
+    {
+      TickEnemyUnits();
+    }
+
+    nChecksum = GameChecksum( nChecksum );
+  }
+
+  double fNs = NowNs() - fStart - RestoreNs( nBatches );
+
+  Report( "TickEnemyUnits", nBatches * cnBatchOps, fNs, nChecksum );
+}
+
+// One long run of levels from a fixed seed, every other one from the
+// level pack when res/levels.pack was found
+static void BenchGenerateNewMap( long nOps )
+{
+  uint32_t nChecksum = 2166136261u;
+
+  RngSeed( &g_gameOptions.m_rng, 1234 );
+  g_nLevelsDealt = 0;
+  g_nLevelPackNext = 0;
+
+  double fStart = NowNs();
+
+  for( long nOp = 0 ; nOp < nOps ; ++nOp )
+  {
+    GenerateNewMap();
+
+    nChecksum = Mix( nChecksum, (uint32_t)g_nLandBits ^ (uint32_t)g_gameOptions.m_playerObj.m_nX << 8 );
+  }
+
+  double fNs = NowNs() - fStart;
+
+  Report( "GenerateNewMap", nOps, fNs, nChecksum );
+}
+
+// -------------------------------------------------------------------
+// Frames
+//
+
+static uint32_t ScreenChecksum( uint32_t nChecksum )
+{
+  GBitmap* pScreen = host_screen_bitmap();
+  const uint8_t* pData = gbitmap_get_data( pScreen );
+  int nBytes = gbitmap_get_bytes_per_row( pScreen ) * gbitmap_get_bounds( pScreen ).size.h;
+
+  for( int nByte = 0 ; nByte < nBytes ; ++nByte )
+  {
+    nChecksum = Mix( nChecksum, pData[ nByte ] );
+  }
+
+  return nChecksum;
+}
+
+static void RenderIdleFrame()
+{
+  g_fBounceSpritesThisSecond = ! g_fBounceSpritesThisSecond;
+
+  layer_mark_dirty( g_pDrawingLayer );
+  host_render();
+}
+
+// Idle frames on every board, checksummed but not timed
+static uint32_t IdleFramesChecksum()
+{
+  uint32_t nChecksum = 2166136261u;
+
+  for( int nBoard = 0 ; nBoard < cnBoards ; ++nBoard )
+  {
+    RestoreState( &g_vBoards[ nBoard ] );
+
+    for( int nFrame = 0 ; nFrame < 8 ; ++nFrame )
+    {
+      RenderIdleFrame();
+      nChecksum = ScreenChecksum( nChecksum );
+    }
+  }
+
+  return nChecksum;
+}
+
+static double IdleFramesNs( long nOps )
+{
+  double fNs = 0.0;
+  long nDone = 0;
+
+  while( nDone < nOps )
+  {
+    for( int nBoard = 0 ; nBoard < cnBoards && nDone < nOps ; ++nBoard )
+    {
+      RestoreState( &g_vBoards[ nBoard ] );
+
+      double fStart = NowNs();
+
+      for( int nFrame = 0 ; nFrame < 256 ; ++nFrame, ++nDone )
+      {
+        RenderIdleFrame();
+      }
+
+      fNs += NowNs() - fStart;
+    }
+  }
+
+  return fNs;
+}
+
+static void BenchIdleFrames( long nOps )
+{
+  FrameMemoSetEnabled( false );
+
+  uint32_t nDrawnChecksum = IdleFramesChecksum();
+  double fDrawnNs = IdleFramesNs( nOps );
+
+  FrameMemoSetEnabled( true );
+
+  uint32_t nMemoChecksum = IdleFramesChecksum();
+  double fMemoNs = IdleFramesNs( nOps );
+
+  Report( "IdleFrameDrawn", nOps, fDrawnNs, nDrawnChecksum );
+  Report( "IdleFrameMemo", nOps, fMemoNs, nMemoChecksum );
+
+  printf( "idle_frame_pixels_identical %d\n", nDrawnChecksum == nMemoChecksum );
+  printf( "frame_memo_saved_us_per_idle_second %.2f\n", ( fDrawnNs - fMemoNs ) / (double)nOps * 1e-3 );
+}
+
+// Seconds of actual play, skeletons wandering, nobody pressing anything
+static void BenchLiveFrames( long nSeconds )
+{
+  int nHits = FrameMemoHits();
+  int nMisses = FrameMemoMisses();
+
+  for( long nSecond = 0 ; nSecond < nSeconds ; ++nSecond )
+  {
+    if(    nSecond % 60 == 0
+        || g_gameOptions.m_fGameOver
+        || CheckIfLevelIsComplete() )
+    {
+      RestoreState( &g_vBoards[ ( nSecond / 60 ) % cnBoards ] );
+      g_gameOptions.m_fGameOver = false;
+    }
+
+    host_advance_ms( 1000 );
+    host_render();
+  }
+
+  nHits = FrameMemoHits() - nHits;
+  nMisses = FrameMemoMisses() - nMisses;
+
+  printf( "frame_memo_live_frames %d\n", nHits + nMisses );
+  printf( "frame_memo_live_hit_rate %.3f\n", nHits + nMisses ? (double)nHits / (double)( nHits + nMisses ) : 0.0 );
+}
+
+// -------------------------------------------------------------------
+// Env parity
+//
+
+// False at the first thing main.c and the env disagree on
+static bool SameAsEnv( const struct HopperGame* pGame )
+{
+  if(    g_nLandBits != pGame->m_nLand
+      || GetTreasureBits() != pGame->m_nGems
+      || g_gameOptions.m_nScore != pGame->m_nScore
+      || g_gameOptions.m_fGameOver != (bool)pGame->m_fGameOver
+      || g_gameOptions.m_fCanLevelBeExited != (bool)pGame->m_fCanLevelBeExited
+      || g_gameOptions.m_playerObj.m_nX != pGame->m_nPlayerX
+      || g_gameOptions.m_playerObj.m_nY != pGame->m_nPlayerY
+      || (int)g_gameOptions.m_playerObj.m_eDirectionFacing != pGame->m_nPlayerFacing
+      || g_gameOptions.m_exitObj.m_nX != pGame->m_nExitX
+      || g_gameOptions.m_exitObj.m_nY != pGame->m_nExitY
+      || g_gameOptions.m_nNumberOfEnemies != pGame->m_nNumberOfEnemies )
+  {
+    return false;
+  }
+
+  for( int nEnemy = 0 ; nEnemy < pGame->m_nNumberOfEnemies ; ++nEnemy )
+  {
+    if(    g_gameOptions.m_enemiesArray[ nEnemy ].m_nX != pGame->m_vEnemyX[ nEnemy ]
+        || g_gameOptions.m_enemiesArray[ nEnemy ].m_nY != pGame->m_vEnemyY[ nEnemy ]
+        || (int)g_gameOptions.m_enemiesArray[ nEnemy ].m_eDirectionFacing != pGame->m_vEnemyFacing[ nEnemy ] )
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Runs from seeds 1 up, each to game over or nSteps, a hop and an enemy
+// tick or a turn and an enemy tick a step on both sides. Levels are all
+// dealt live, as the env deals them.
+static void BenchEnvParity( long nRuns, int nSteps )
+{
+  uint32_t nLevelPackLevels = g_nLevelPackLevels;
+  g_nLevelPackLevels = 0;
+
+  struct Rng actionRng;
+  RngSeed( &actionRng, 0xac7105ull );
+
+  long nPlayed = 0;
+  long nLevels = 0;
+  long nDiverged = 0;
+  long nFirstDiverged = -1;
+
+  for( long nRun = 0 ; nRun < nRuns ; ++nRun )
+  {
+    struct HopperGame game;
+
+    HopperGameReset( &game, (uint64_t)( nRun + 1 ) );
+
+    RngSeed( &g_gameOptions.m_rng, (uint64_t)( nRun + 1 ) );
+    g_gameOptions.m_nScore = 0;
+    g_gameOptions.m_fGameOver = false;
+    g_nLevelsDealt = 0;
+
+    GenerateNewMap();
+
+    bool fSame = SameAsEnv( &game );
+
+    for( int nStep = 0 ; nStep < nSteps && fSame && ! game.m_fGameOver ; ++nStep )
+    {
+      uint32_t nDraw = RngNext( &actionRng );
+      EHopperAction eAction = ( nDraw & 3 ) == 0 ? (EHopperAction)( ( nDraw >> 2 ) & 1 ) : eHopperActionHop;
+
+      if( eAction == eHopperActionHop )
+      {
+        HandlePlayerMove();
+      }
+      else
+      {
+        UpdatePlayerDirectionFacing( eAction == eHopperActionRotateUp );
+      }
+
+      TickEnemyUnits();
+
+      uint16_t nLevelsCleared = game.m_nLevelsCleared;
+
+      HopperGameStep( &game, eAction );
+
+      nLevels += game.m_nLevelsCleared - nLevelsCleared;
+      ++nPlayed;
+
+      fSame = SameAsEnv( &game );
+    }
+
+    if( ! fSame )
+    {
+      ++nDiverged;
+
+      if( nFirstDiverged < 0 )
+      {
+        nFirstDiverged = nRun + 1;
+      }
+    }
+  }
+
+  g_nLevelPackLevels = nLevelPackLevels;
+
+  printf( "env_parity_runs %ld\n", nRuns );
+  printf( "env_parity_steps %ld\n", nPlayed );
+  printf( "env_parity_levels_cleared %ld\n", nLevels );
+  printf( "env_parity_runs_diverged %ld\n", nDiverged );
+  printf( "env_parity_first_diverged_seed %ld\n", nFirstDiverged );
+  printf( "env_parity_identical %d\n", nDiverged == 0 );
+}
+
+int main( int argc, char** argv )
+{
+  long nScale = argc > 1 ? atol( argv[ 1 ] ) : 1;
+
+  if( nScale < 1 )
+  {
+    nScale = 1;
+  }
+
+  // Bring the app up as the watch would, then deal the boards
+  handle_init();
+  DealBoards();
+
+  printf( "level_pack_levels %d\n", (int)g_nLevelPackLevels );
+
+  BenchHandleEntityMove( nScale * 20000000 );
+  BenchGetDistanceAndDirection( nScale * 20000000 );
+  BenchCheckIfLevelIsComplete( nScale * 20000000 );
+  BenchHandleEnemyUnitMove( nScale * 2000000 );
+  BenchTickEnemyUnits( nScale * 2000000 );
+  BenchGenerateNewMap( nScale * 200000 );
+  BenchIdleFrames( nScale * 20000 );
+  BenchLiveFrames( nScale * 3600 );
+  BenchEnvParity( nScale * 2000, 2000 );
+
+  handle_deinit();
+
+  return 0;
+}
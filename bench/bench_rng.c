@@ -0,0 +1,233 @@
+// -------------------------------------------------------------------
+// Host benchmark : per game PRNG vs the C library rand()
+//
+// Build and run from the repo root :
+//
+//   cc -O2 -I. bench/bench_rng.c rng.c -o bench_rng
+//   ./bench_rng
+//
+// Reports the cost of a single draw, of all the draws one level needs,
+// and chi-square statistics for the ways the game consumes draws.
+//
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "rng.h"
+
+#define cnDraws 20000000
+#define cnLevels 1000000
+#define cnQualitySamples 6000000
+#define cnLevelCells 64
+
+static double NowNs()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Keeps the optimiser from throwing the draws away
+static volatile uint32_t g_nSink;
+
+static double ChiSquare( const long* pnCounts, int nBuckets, long nSamples )
+{
+  double fExpected = (double)nSamples / nBuckets;
+  double fChi = 0.0;
+
+  for( int nBucket = 0 ; nBucket < nBuckets ; ++nBucket )
+  {
+    double fDelta = (double)pnCounts[ nBucket ] - fExpected;
+    fChi += fDelta * fDelta / fExpected;
+  }
+
+  return fChi;
+}
+
+static void BenchDraws()
+{
+  uint32_t nAccum = 0;
+
+  srand( 1 );
+  double fStart = NowNs();
+
+  for( int n = 0 ; n < cnDraws ; ++n )
+  {
+    nAccum += (uint32_t)rand();
+  }
+
+  double fRandNs = ( NowNs() - fStart ) / cnDraws;
+
+  struct Rng rng;
+  RngSeed( &rng, 1 );
+  fStart = NowNs();
+
+  for( int n = 0 ; n < cnDraws ; ++n )
+  {
+    nAccum += RngNext( &rng );
+  }
+
+  double fRngNs = ( NowNs() - fStart ) / cnDraws;
+
+  g_nSink = nAccum;
+
+  printf( "draw_rand_ns %.2f\n", fRandNs );
+  printf( "draw_rng_ns %.2f\n", fRngNs );
+}
+
+static void BenchLevelDraws()
+{
+  uint32_t nAccum = 0;
+
+  // GenerateNewMap before : two rand() % n per cell plus positions
+  srand( 1 );
+  double fStart = NowNs();
+
+  for( int nLevel = 0 ; nLevel < cnLevels ; ++nLevel )
+  {
+    for( int nCell = 0 ; nCell < cnLevelCells ; ++nCell )
+    {
+      bool fLand = rand() % 6 != 0;
+
+      if( fLand && rand() % 5 == 0 )
+      {
+        ++nAccum;
+      }
+    }
+
+    for( int nPosition = 0 ; nPosition < 11 ; ++nPosition )
+    {
+      nAccum += (uint32_t)( rand() % 8 );
+    }
+  }
+
+  double fRandNs = ( NowNs() - fStart ) / cnLevels;
+
+  // GenerateNewMap now : one bulk fill then a handful of bounded draws
+  struct Rng rng;
+  RngSeed( &rng, 1 );
+  uint32_t vCellDraws[ cnLevelCells ];
+
+  fStart = NowNs();
+
+  for( int nLevel = 0 ; nLevel < cnLevels ; ++nLevel )
+  {
+    RngFill( &rng, vCellDraws, cnLevelCells );
+
+    for( int nCell = 0 ; nCell < cnLevelCells ; ++nCell )
+    {
+      if(    RngScale16( vCellDraws[ nCell ], 6 ) != 0
+          && RngScale16( vCellDraws[ nCell ] >> 16, 5 ) == 0 )
+      {
+        ++nAccum;
+      }
+    }
+
+    for( int nPosition = 0 ; nPosition < 11 ; ++nPosition )
+    {
+      nAccum += (uint32_t)RngBelow( &rng, 8 );
+    }
+  }
+
+  double fRngNs = ( NowNs() - fStart ) / cnLevels;
+
+  g_nSink = nAccum;
+
+  printf( "level_rand_ns %.1f\n", fRandNs );
+  printf( "level_rng_ns %.1f\n", fRngNs );
+}
+
+static void Quality()
+{
+  //
+  //  Uniformity of the 1 in 6 land roll, 5 degrees of freedom
+  //
+
+  long vRand[ 16 ] = { 0 };
+  long vRng[ 16 ] = { 0 };
+  long vFill[ 16 ] = { 0 };
+
+  srand( 7 );
+  struct Rng rng;
+  RngSeed( &rng, 7 );
+
+  static uint32_t vBlock[ 1024 ];
+
+  for( int n = 0 ; n < cnQualitySamples ; ++n )
+  {
+    ++vRand[ rand() % 6 ];
+    ++vRng[ RngBelow( &rng, 6 ) ];
+
+    if( n % 1024 == 0 )
+    {
+      RngFill( &rng, vBlock, 1024 );
+    }
+
+    ++vFill[ RngScale16( vBlock[ n % 1024 ], 6 ) ];
+  }
+
+  printf( "chi2_uniform6_df5_rand %.2f\n", ChiSquare( vRand, 6, cnQualitySamples ) );
+  printf( "chi2_uniform6_df5_rng %.2f\n", ChiSquare( vRng, 6, cnQualitySamples ) );
+  printf( "chi2_uniform6_df5_fill %.2f\n", ChiSquare( vFill, 6, cnQualitySamples ) );
+
+  //
+  //  Serial pairs of the low two bits, the bits enemy facing uses.
+  //  15 degrees of freedom.
+  //
+
+  long vRandPairs[ 16 ] = { 0 };
+  long vRngPairs[ 16 ] = { 0 };
+
+  int nLastRand = rand() & 3;
+  int nLastRng = (int)( RngNext( &rng ) & 3 );
+
+  for( int n = 0 ; n < cnQualitySamples ; ++n )
+  {
+    int nRand = rand() & 3;
+    int nRng = (int)( RngNext( &rng ) & 3 );
+
+    ++vRandPairs[ nLastRand * 4 + nRand ];
+    ++vRngPairs[ nLastRng * 4 + nRng ];
+
+    nLastRand = nRand;
+    nLastRng = nRng;
+  }
+
+  printf( "chi2_pairs_df15_rand %.2f\n", ChiSquare( vRandPairs, 16, cnQualitySamples ) );
+  printf( "chi2_pairs_df15_rng %.2f\n", ChiSquare( vRngPairs, 16, cnQualitySamples ) );
+
+  //
+  //  Jumped streams shouldn't line up with each other
+  //
+
+  struct Rng streamA;
+  struct Rng streamB;
+
+  RngStream( &streamA, &rng, 0 );
+  RngStream( &streamB, &rng, 1 );
+
+  long nMatches = 0;
+
+  for( int n = 0 ; n < cnQualitySamples ; ++n )
+  {
+    if( ( RngNext( &streamA ) & 0xFF ) == ( RngNext( &streamB ) & 0xFF ) )
+    {
+      ++nMatches;
+    }
+  }
+
+  printf( "stream_byte_match_rate %.5f expected %.5f\n",
+          (double)nMatches / cnQualitySamples,
+          1.0 / 256.0 );
+}
+
+int main()
+{
+  BenchDraws();
+  BenchLevelDraws();
+  Quality();
+
+  return 0;
+}
@@ -0,0 +1,83 @@
+#ifndef HOPPER_BITBOARD_H
+#define HOPPER_BITBOARD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// -------------------------------------------------------------------
+// 64 bit board helpers
+//
+// The play field is 8x8 so a whole layer of it (land, gems, enemies...)
+// fits in a single uint64_t. Cell (x, y) lives at bit ( x * 8 + y ),
+// which keeps the four hop directions as plain shifts :
+//
+//   NE ( y + 1 ) : << 1    SW ( y - 1 ) : >> 1
+//   SE ( x + 1 ) : << 8    NW ( x - 1 ) : >> 8
+//
+// The y shifts need a column mask so bits don't wrap between rows.
+//
+
+typedef uint64_t Bitboard;
+
+#define cnBitboardSide 8
+
+static const Bitboard c_nBitboardEmpty = 0;
+static const Bitboard c_nBitboardFull = ~(Bitboard)0;
+
+// Cells with y == 0 and y == 7 respectively
+static const Bitboard c_nBitboardColumnY0 = 0x0101010101010101ULL;
+static const Bitboard c_nBitboardColumnY7 = 0x8080808080808080ULL;
+
+static inline int BitboardIndex( int x, int y )
+{
+  return x * cnBitboardSide + y;
+}
+
+static inline Bitboard BitboardCell( int x, int y )
+{
+  return (Bitboard)1 << BitboardIndex( x, y );
+}
+
+static inline bool BitboardTest( Bitboard b, int x, int y )
+{
+  return ( b >> BitboardIndex( x, y ) ) & 1;
+}
+
+static inline Bitboard BitboardSet( Bitboard b, int x, int y, bool fValue )
+{
+  return fValue ? ( b | BitboardCell( x, y ) )
+                : ( b & ~BitboardCell( x, y ) );
+}
+
+static inline int BitboardCount( Bitboard b )
+{
+  return __builtin_popcountll( b );
+}
+
+// Index of the lowest set bit, b must not be empty
+static inline int BitboardLowestIndex( Bitboard b )
+{
+  return __builtin_ctzll( b );
+}
+
+static inline Bitboard BitboardShiftNE( Bitboard b ) { return ( b << 1 ) & ~c_nBitboardColumnY0; }
+static inline Bitboard BitboardShiftSW( Bitboard b ) { return ( b >> 1 ) & ~c_nBitboardColumnY7; }
+static inline Bitboard BitboardShiftSE( Bitboard b ) { return b << 8; }
+static inline Bitboard BitboardShiftNW( Bitboard b ) { return b >> 8; }
+
+// Every cell one hop away from any cell in b
+static inline Bitboard BitboardNeighbours( Bitboard b )
+{
+  return   BitboardShiftNE( b )
+         | BitboardShiftSW( b )
+         | BitboardShiftSE( b )
+         | BitboardShiftNW( b );
+}
+
+// Grow b by one hop, staying on cells set in walkable
+static inline Bitboard BitboardDilate( Bitboard b, Bitboard walkable )
+{
+  return ( b | BitboardNeighbours( b ) ) & walkable;
+}
+
+#endif // HOPPER_BITBOARD_H
@@ -0,0 +1,176 @@
+#include <string.h>
+
+#include "blit.h"
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+static inline uint32_t LoadWord( const uint8_t* pData )
+{
+  uint32_t nWord;
+  memcpy( &nWord, pData, sizeof( nWord ) );
+  return nWord;
+}
+
+static inline void StoreWord( uint8_t* pData, uint32_t nWord )
+{
+  memcpy( pData, &nWord, sizeof( nWord ) );
+}
+
+// ( word & ~clear ) | set for one row, shifted to start at pixel nXPx
+// and clipped to the target
+static inline void BlitRow( const struct BlitTarget* pTarget,
+                            int nYPx,
+                            int nXPx,
+                            uint32_t nSet,
+                            uint32_t nClear )
+{
+  if( (unsigned)nYPx >= (unsigned)pTarget->m_nHeight )
+  {
+    return;
+  }
+
+  int nWord = 0;
+  uint64_t nSet64;
+  uint64_t nClear64;
+
+  if( nXPx >= 0 )
+  {
+    nWord = nXPx >> 5;
+    nSet64 = (uint64_t)nSet << ( nXPx & 31 );
+    nClear64 = (uint64_t)nClear << ( nXPx & 31 );
+  }
+  else if( nXPx > -32 )
+  {
+    nSet64 = nSet >> -nXPx;
+    nClear64 = nClear >> -nXPx;
+  }
+  else
+  {
+    return;
+  }
+
+  // Columns of the two word window that are on screen
+  int nVisible = pTarget->m_nWidth - nWord * 32;
+
+  if( nVisible <= 0 )
+  {
+    return;
+  }
+
+  if( nVisible < 64 )
+  {
+    uint64_t nVisibleMask = ( (uint64_t)1 << nVisible ) - 1;
+
+    nSet64 &= nVisibleMask;
+    nClear64 &= nVisibleMask;
+  }
+
+  uint8_t* pWord = pTarget->m_pData + nYPx * pTarget->m_nBytesPerRow + nWord * 4;
+
+  StoreWord( pWord, ( LoadWord( pWord ) & ~(uint32_t)nClear64 ) | (uint32_t)nSet64 );
+
+  if( ( nSet64 | nClear64 ) >> 32 )
+  {
+    pWord += 4;
+
+    StoreWord( pWord, ( LoadWord( pWord ) & ~(uint32_t)( nClear64 >> 32 ) ) | (uint32_t)( nSet64 >> 32 ) );
+  }
+}
+
+bool BlitTargetFromBitmap( struct BlitTarget* pTarget, GBitmap* pBitmap )
+{
+  GRect bounds = gbitmap_get_bounds( pBitmap );
+
+  if(    gbitmap_get_format( pBitmap ) != GBitmapFormat1Bit
+      || gbitmap_get_bytes_per_row( pBitmap ) < ( ( bounds.size.w + 31 ) / 32 ) * 4 )
+  {
+    return false;
+  }
+
+  pTarget->m_pData = gbitmap_get_data( pBitmap );
+  pTarget->m_nBytesPerRow = gbitmap_get_bytes_per_row( pBitmap );
+  pTarget->m_nWidth = bounds.size.w;
+  pTarget->m_nHeight = bounds.size.h;
+
+  return true;
+}
+
+void BlitCaptureStampOnBlack( struct BlitStamp* pStamp,
+                              const struct BlitTarget* pTarget,
+                              int nXPx,
+                              int nYPx,
+                              int nRows )
+{
+  if( nRows > cnBlitStampRows )
+  {
+    nRows = cnBlitStampRows;
+  }
+
+  pStamp->m_nRows = (uint8_t)nRows;
+
+  for( int nRow = 0 ; nRow < nRows ; ++nRow )
+  {
+    // White on black was written by the shape, and is all it left white
+    pStamp->m_vSet[ nRow ] = LoadWord( pTarget->m_pData + ( nYPx + nRow ) * pTarget->m_nBytesPerRow + nXPx / 8 );
+    pStamp->m_vClear[ nRow ] = pStamp->m_vSet[ nRow ];
+  }
+}
+
+void BlitCaptureStampOnWhite( struct BlitStamp* pStamp,
+                              const struct BlitTarget* pTarget,
+                              int nXPx,
+                              int nYPx )
+{
+  for( int nRow = 0 ; nRow < pStamp->m_nRows ; ++nRow )
+  {
+    // Black on white was written by the shape too
+    uint32_t nOnWhite = LoadWord( pTarget->m_pData + ( nYPx + nRow ) * pTarget->m_nBytesPerRow + nXPx / 8 );
+
+    pStamp->m_vClear[ nRow ] |= ~nOnWhite;
+  }
+}
+
+void BlitUnpackSprite( struct BlitSprite* pSprite, const GBitmap* pMask, const GBitmap* pBitmap )
+{
+  const uint8_t* pMaskData = gbitmap_get_data( pMask );
+  const uint8_t* pBitmapData = gbitmap_get_data( pBitmap );
+  int nMaskBytesPerRow = gbitmap_get_bytes_per_row( pMask );
+  int nBitmapBytesPerRow = gbitmap_get_bytes_per_row( pBitmap );
+
+  for( int nRow = 0 ; nRow < cnBlitSpriteRows ; ++nRow )
+  {
+    const uint8_t* pMaskRow = pMaskData + nRow * nMaskBytesPerRow;
+    const uint8_t* pBitmapRow = pBitmapData + nRow * nBitmapBytesPerRow;
+
+    uint16_t nMask = (uint16_t)( pMaskRow[ 0 ] | ( pMaskRow[ 1 ] << 8 ) );
+    uint16_t nBitmap = (uint16_t)( pBitmapRow[ 0 ] | ( pBitmapRow[ 1 ] << 8 ) );
+
+    // ( dst | mask ) & sprite == ( dst & sprite ) | ( mask & sprite )
+    pSprite->m_vSet[ nRow ] = nMask & nBitmap;
+    pSprite->m_vClear[ nRow ] = (uint16_t)~nBitmap;
+  }
+}
+
+void BlitDrawStamp( const struct BlitTarget* pTarget, const struct BlitStamp* pStamp, int nXPx, int nYPx )
+{
+  for( int nRow = 0 ; nRow < pStamp->m_nRows ; ++nRow )
+  {
+    if( pStamp->m_vClear[ nRow ] )
+    {
+      BlitRow( pTarget, nYPx + nRow, nXPx, pStamp->m_vSet[ nRow ], pStamp->m_vClear[ nRow ] );
+    }
+  }
+}
+
+void BlitDrawSprite( const struct BlitTarget* pTarget, const struct BlitSprite* pSprite, int nXPx, int nYPx )
+{
+  for( int nRow = 0 ; nRow < cnBlitSpriteRows ; ++nRow )
+  {
+    if( pSprite->m_vSet[ nRow ] | pSprite->m_vClear[ nRow ] )
+    {
+      BlitRow( pTarget, nYPx + nRow, nXPx, pSprite->m_vSet[ nRow ], pSprite->m_vClear[ nRow ] );
+    }
+  }
+}
@@ -0,0 +1,75 @@
+#ifndef HOPPER_BLIT_H
+#define HOPPER_BLIT_H
+
+#include <pebble.h>
+
+// -------------------------------------------------------------------
+// Word parallel kernels for drawing straight into the framebuffer
+//
+// The 1-bit framebuffer holds pixel x of a row in bit x % 8 of byte
+// x / 8, so read as little endian 32-bit words pixel x is bit x % 32 of
+// word x / 32. Every draw here boils down to one kernel per row :
+//
+//   word = ( word & ~clear ) | set
+//
+// over the one or two words the row lands in, with the row shifted into
+// place by the draw's x position.
+//
+// Shapes ( blocks and markers ) are stamps captured from the SDK's own
+// rasterizer, so they match gpath_draw_filled and gpath_draw_outline
+// pixel for pixel. A sprite drawn as its mask with GCompOpOr then its
+// bitmap with GCompOpAnd is ( dst | mask ) & sprite, which is the same
+// kernel with clear = ~sprite and set = mask & sprite.
+//
+
+// Tallest shape, a whole block with its front edge line
+#define cnBlitStampRows 22
+
+#define cnBlitSpriteRows 16
+
+struct BlitStamp
+{
+  uint8_t m_nRows;
+  uint32_t m_vSet[ cnBlitStampRows ];
+  uint32_t m_vClear[ cnBlitStampRows ];
+};
+
+struct BlitSprite
+{
+  uint16_t m_vSet[ cnBlitSpriteRows ];
+  uint16_t m_vClear[ cnBlitSpriteRows ];
+};
+
+struct BlitTarget
+{
+  uint8_t* m_pData;
+  int m_nBytesPerRow;
+  int m_nWidth;
+  int m_nHeight;
+};
+
+// Point a target at a captured framebuffer. False if it isn't a 1 bit
+// bitmap with whole words per row, which is all the kernels can write.
+bool BlitTargetFromBitmap( struct BlitTarget* pTarget, GBitmap* pBitmap );
+
+// Stamps are captured from a shape drawn with its origin at ( nXPx, nYPx )
+// once on a black background, then again on a white one, as only one
+// framebuffer capture can be held at a time. nXPx must be a multiple of
+// 32. Pixels the shape wrote show up white on black or black on white.
+void BlitCaptureStampOnBlack( struct BlitStamp* pStamp,
+                              const struct BlitTarget* pTarget,
+                              int nXPx,
+                              int nYPx,
+                              int nRows );
+void BlitCaptureStampOnWhite( struct BlitStamp* pStamp,
+                              const struct BlitTarget* pTarget,
+                              int nXPx,
+                              int nYPx );
+
+// Unpack a 16x16 mask and sprite pair into kernel rows
+void BlitUnpackSprite( struct BlitSprite* pSprite, const GBitmap* pMask, const GBitmap* pBitmap );
+
+void BlitDrawStamp( const struct BlitTarget* pTarget, const struct BlitStamp* pStamp, int nXPx, int nYPx );
+void BlitDrawSprite( const struct BlitTarget* pTarget, const struct BlitSprite* pSprite, int nXPx, int nYPx );
+
+#endif // HOPPER_BLIT_H
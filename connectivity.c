@@ -0,0 +1,288 @@
+#include "connectivity.h"
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+#define cnConnectivityCells ( cnBitboardSide * cnBitboardSide )
+#define cnNoComponent 0xFF
+
+// Longest possible shortest path on the board, bounds the bridge search
+#define cnMaxBridgeLayers ( 2 * cnBitboardSide )
+
+static uint8_t g_nCellComponent[ cnConnectivityCells ];
+static Bitboard g_nComponentCells[ cnConnectivityCells ];
+
+// Bit n set when component slot n is in use
+static Bitboard g_nUsedComponents = 0;
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+Bitboard ConnectivityFlood( Bitboard nSeed, Bitboard nWithin )
+{
+  Bitboard nFilled = nSeed & nWithin;
+
+  for( ;; )
+  {
+    Bitboard nGrown = BitboardDilate( nFilled, nWithin );
+
+    if( nGrown == nFilled )
+    {
+      return nFilled;
+    }
+
+    nFilled = nGrown;
+  }
+}
+
+static int AllocComponent( Bitboard nCells )
+{
+  int nComponent = BitboardLowestIndex( ~g_nUsedComponents );
+
+  g_nUsedComponents |= (Bitboard)1 << nComponent;
+  g_nComponentCells[ nComponent ] = nCells;
+
+  while( nCells )
+  {
+    g_nCellComponent[ BitboardLowestIndex( nCells ) ] = (uint8_t)nComponent;
+    nCells &= nCells - 1;
+  }
+
+  return nComponent;
+}
+
+static void FreeComponent( int nComponent )
+{
+  g_nUsedComponents &= ~( (Bitboard)1 << nComponent );
+  g_nComponentCells[ nComponent ] = 0;
+}
+
+static void RelabelCells( Bitboard nCells, int nComponent )
+{
+  while( nCells )
+  {
+    g_nCellComponent[ BitboardLowestIndex( nCells ) ] = (uint8_t)nComponent;
+    nCells &= nCells - 1;
+  }
+}
+
+void ConnectivityRebuild( Bitboard nLand )
+{
+  g_nUsedComponents = 0;
+
+  for( int nCell = 0 ; nCell < cnConnectivityCells ; ++nCell )
+  {
+    g_nCellComponent[ nCell ] = cnNoComponent;
+    g_nComponentCells[ nCell ] = 0;
+  }
+
+  Bitboard nUnlabelled = nLand;
+
+  while( nUnlabelled )
+  {
+    Bitboard nSeed = nUnlabelled & ( ~nUnlabelled + 1 );
+    Bitboard nComponent = ConnectivityFlood( nSeed, nLand );
+
+    AllocComponent( nComponent );
+    nUnlabelled &= ~nComponent;
+  }
+}
+
+static void AddTile( Bitboard nLand, int nCell )
+{
+  Bitboard nCellBit = (Bitboard)1 << nCell;
+  Bitboard nNeighbours = BitboardNeighbours( nCellBit ) & nLand;
+
+  if( ! nNeighbours )
+  {
+    // An island of one
+    AllocComponent( nCellBit );
+    return;
+  }
+
+  // Keep the biggest neighbouring component and fold the rest into it,
+  // so the fewest cells need relabelling
+  int nKeep = cnNoComponent;
+  int nKeepSize = -1;
+  Bitboard nScan = nNeighbours;
+
+  while( nScan )
+  {
+    int nComponent = g_nCellComponent[ BitboardLowestIndex( nScan ) ];
+    nScan &= nScan - 1;
+
+    int nSize = BitboardCount( g_nComponentCells[ nComponent ] );
+
+    if( nSize > nKeepSize )
+    {
+      nKeep = nComponent;
+      nKeepSize = nSize;
+    }
+  }
+
+  nScan = nNeighbours;
+
+  while( nScan )
+  {
+    int nComponent = g_nCellComponent[ BitboardLowestIndex( nScan ) ];
+    nScan &= nScan - 1;
+
+    if( nComponent != nKeep )
+    {
+      Bitboard nCells = g_nComponentCells[ nComponent ];
+
+      RelabelCells( nCells, nKeep );
+      g_nComponentCells[ nKeep ] |= nCells;
+      FreeComponent( nComponent );
+    }
+  }
+
+  g_nComponentCells[ nKeep ] |= nCellBit;
+  g_nCellComponent[ nCell ] = (uint8_t)nKeep;
+}
+
+static void RemoveTile( int nCell )
+{
+  int nComponent = g_nCellComponent[ nCell ];
+
+  if( nComponent == cnNoComponent )
+  {
+    return;
+  }
+
+  Bitboard nCellBit = (Bitboard)1 << nCell;
+  Bitboard nRemaining = g_nComponentCells[ nComponent ] & ~nCellBit;
+  Bitboard nNeighbours = BitboardNeighbours( nCellBit ) & nRemaining;
+
+  g_nCellComponent[ nCell ] = cnNoComponent;
+
+  if( ! nNeighbours )
+  {
+    // Was an island of one
+    FreeComponent( nComponent );
+    return;
+  }
+
+  // Flood from one neighbour. If it reaches the others nothing split.
+  Bitboard nPiece = ConnectivityFlood( nNeighbours & ( ~nNeighbours + 1 ), nRemaining );
+
+  g_nComponentCells[ nComponent ] = nPiece;
+  nRemaining &= ~nPiece;
+  nNeighbours &= nRemaining;
+
+  // Each neighbour left over starts a new component
+  while( nNeighbours )
+  {
+    nPiece = ConnectivityFlood( nNeighbours & ( ~nNeighbours + 1 ), nRemaining );
+
+    AllocComponent( nPiece );
+    nRemaining &= ~nPiece;
+    nNeighbours &= nRemaining;
+  }
+}
+
+void ConnectivitySetTile( Bitboard nLand, int x, int y, bool fLand )
+{
+  int nCell = BitboardIndex( x, y );
+  bool fWasLand = g_nCellComponent[ nCell ] != cnNoComponent;
+
+  if( fLand == fWasLand )
+  {
+    return;
+  }
+
+  if( fLand )
+  {
+    AddTile( nLand, nCell );
+  }
+  else
+  {
+    RemoveTile( nCell );
+  }
+}
+
+Bitboard ConnectivityComponentOf( int x, int y )
+{
+  int nComponent = g_nCellComponent[ BitboardIndex( x, y ) ];
+
+  if( nComponent == cnNoComponent )
+  {
+    return 0;
+  }
+
+  return g_nComponentCells[ nComponent ];
+}
+
+Bitboard ConnectivityReachableFrom( Bitboard nLand, int x, int y )
+{
+  Bitboard nCell = BitboardCell( x, y );
+  Bitboard nReachable = nCell | ConnectivityComponentOf( x, y );
+
+  if( ! ( nCell & nLand ) )
+  {
+    // Off the land, can hop onto any neighbouring component
+    Bitboard nNeighbours = BitboardNeighbours( nCell ) & nLand;
+
+    while( nNeighbours )
+    {
+      int nNeighbour = BitboardLowestIndex( nNeighbours );
+      nNeighbours &= nNeighbours - 1;
+
+      nReachable |= g_nComponentCells[ g_nCellComponent[ nNeighbour ] ];
+    }
+  }
+
+  return nReachable;
+}
+
+int ConnectivityComponentCount()
+{
+  return BitboardCount( g_nUsedComponents );
+}
+
+Bitboard ConnectivityFindBridge( Bitboard nLand, Bitboard nFrom, Bitboard nTargets )
+{
+  if( ! nTargets )
+  {
+    return 0;
+  }
+
+  Bitboard vLayers[ cnMaxBridgeLayers + 1 ];
+  int nLayers = 0;
+
+  Bitboard nLayer = nFrom;
+  Bitboard nVisited = nFrom;
+
+  // Breadth first over every cell until we touch a target
+  while( ! ( nLayer & nTargets ) )
+  {
+    vLayers[ nLayers++ ] = nLayer;
+
+    nLayer = BitboardNeighbours( nLayer ) & ~nVisited;
+    nVisited |= nLayer;
+
+    if(    ! nLayer
+        || nLayers > cnMaxBridgeLayers )
+    {
+      return 0;
+    }
+  }
+
+  // Walk back from the target one layer at a time
+  Bitboard nStep = nLayer & nTargets;
+  nStep &= ~nStep + 1;
+
+  Bitboard nBridge = nStep & ~nLand;
+
+  while( nLayers > 1 )
+  {
+    nStep = BitboardNeighbours( nStep ) & vLayers[ --nLayers ];
+    nStep &= ~nStep + 1;
+
+    nBridge |= nStep & ~nLand;
+  }
+
+  return nBridge;
+}
@@ -0,0 +1,40 @@
+#ifndef HOPPER_CONNECTIVITY_H
+#define HOPPER_CONNECTIVITY_H
+
+#include "bitboard.h"
+
+// -------------------------------------------------------------------
+// Connected components of the land grid
+//
+// Every land cell carries a component label and every label owns a
+// bitboard of its cells. Flipping a single tile only touches the
+// components around it : new land merges its neighbours' components,
+// removed land re-floods just the component it was cut out of to see
+// if it split.
+//
+
+// Label the whole map from scratch
+void ConnectivityRebuild( Bitboard nLand );
+
+// Keep the labels in step with a single tile flip. nLand is the map
+// after the change.
+void ConnectivitySetTile( Bitboard nLand, int x, int y, bool fLand );
+
+// Cells in the same component as ( x, y ), empty if it's not land
+Bitboard ConnectivityComponentOf( int x, int y );
+
+// Every cell an entity at ( x, y ) can walk to. Includes the start
+// cell even when it isn't land, since the player may start in the sea.
+Bitboard ConnectivityReachableFrom( Bitboard nLand, int x, int y );
+
+int ConnectivityComponentCount();
+
+// Shortest run of cells linking nFrom to any cell in nTargets, moving
+// over sea as well as land. Returns only the sea cells on that run,
+// i.e. the tiles that would need creating. Empty if nTargets is empty.
+Bitboard ConnectivityFindBridge( Bitboard nLand, Bitboard nFrom, Bitboard nTargets );
+
+// Flood nSeed out over nWithin
+Bitboard ConnectivityFlood( Bitboard nSeed, Bitboard nWithin );
+
+#endif // HOPPER_CONNECTIVITY_H
@@ -0,0 +1,701 @@
+#include "drawlist.h"
+#include "blit.h"
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+// Longest run of non overlapping sprites held back for one mask pass
+#define cnDrawListMaxBatch 8
+
+static const int c_nSpriteDimensionPx = 16;
+
+// Unknown state, forces the first set of each frame through
+static const int c_nStateUnknown = -1;
+
+struct DrawItem
+{
+  int16_t m_nX;
+  int16_t m_nY;
+  uint8_t m_eKind;
+
+  // Sprite id, block faces, or non zero for a white exit marker
+  uint8_t m_nArg;
+};
+
+struct DrawListSprite
+{
+  GBitmap* m_pMask;
+  GBitmap* m_pSprite;
+};
+
+static GPath* g_pDrawListBlock = NULL;
+static GPath* g_pDrawListBlockTop = NULL;
+static GPath* g_pDrawListBlockTopLeft = NULL;
+static GPath* g_pDrawListBlockTopRight = NULL;
+static GPath* g_pDrawListExitMarker = NULL;
+static GPath* g_pDrawListDangerMarker = NULL;
+
+static struct DrawListSprite g_vDrawListSprites[ cnDrawListMaxSprites ];
+
+static struct DrawItem g_vDrawItems[ cnDrawListMaxItems ];
+static int g_nDrawItemCount = 0;
+
+static int g_vBatch[ cnDrawListMaxBatch ];
+static int g_nBatchCount = 0;
+
+// Context state as last set, 0 black 1 white for the colours
+static int g_nFillColour = -1;
+static int g_nStrokeColour = -1;
+static int g_nCompOp = -1;
+
+static int g_nStateChanges = 0;
+static int g_nUnbatchedStateChanges = 0;
+static int g_nDroppedItems = 0;
+static int g_nLastItemCount = 0;
+
+// Running totals over every frame drawn, for the summary
+static uint32_t g_nDrawListFrames = 0;
+static uint32_t g_nDrawListTotalItems = 0;
+static uint32_t g_nDrawListTotalStateChanges = 0;
+static uint32_t g_nDrawListTotalUnbatchedStateChanges = 0;
+static uint32_t g_nDrawListTotalDroppedItems = 0;
+
+// Framebuffer blit path : every shape the list can hold, captured once
+// from the SDK into a slot a word apart at the top of the screen
+typedef enum
+{
+  eStampBlock = 0,
+  eStampBlockTop,
+  eStampBlockTopLeft,
+  eStampBlockTopRight,
+  eStampBridgeHint,
+  eStampDangerMarker,
+  eStampExitMarkerBlack,
+  eStampExitMarkerWhite,
+  eStampCount
+} EStamp;
+
+static const struct
+{
+  uint8_t m_eKind;
+  uint8_t m_nArg;
+} c_vStampShapes[ eStampCount ] = {
+  { eDrawItemBlock, eBlockFaceAll },
+  { eDrawItemBlock, eBlockFaceTop },
+  { eDrawItemBlock, eBlockFaceTop | eBlockFaceLeft },
+  { eDrawItemBlock, eBlockFaceTop | eBlockFaceRight },
+  { eDrawItemBridgeHint, 0 },
+  { eDrawItemDangerMarker, 0 },
+  { eDrawItemExitMarker, 0 },
+  { eDrawItemExitMarker, 1 }
+};
+
+#define cnStampsPerBand 4
+
+static const int c_nStampAreaWidth = cnStampsPerBand * 32;
+static const int c_nStampAreaHeight = ( eStampCount / cnStampsPerBand ) * cnBlitStampRows;
+
+static bool g_fFramebufferBlit = false;
+static bool g_fStampsCaptured = false;
+
+static struct BlitStamp g_vStamps[ eStampCount ];
+static struct BlitSprite g_vBlitSprites[ cnDrawListMaxSprites ];
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+void DrawListInit( GPath* pBlock, 
+                   GPath* pBlockTop,
+                   GPath* pBlockTopLeft,
+                   GPath* pBlockTopRight,
+                   GPath* pExitMarker, 
+                   GPath* pDangerMarker )
+{
+  g_pDrawListBlock = pBlock;
+  g_pDrawListBlockTop = pBlockTop;
+  g_pDrawListBlockTopLeft = pBlockTopLeft;
+  g_pDrawListBlockTopRight = pBlockTopRight;
+  g_pDrawListExitMarker = pExitMarker;
+  g_pDrawListDangerMarker = pDangerMarker;
+}
+
+void DrawListSetSprite( int nSprite, GBitmap* pMask, GBitmap* pSprite )
+{
+  if( nSprite < 0 || nSprite >= cnDrawListMaxSprites )
+  {
+    return;
+  }
+
+  g_vDrawListSprites[ nSprite ].m_pMask = pMask;
+  g_vDrawListSprites[ nSprite ].m_pSprite = pSprite;
+
+  if( pMask && pSprite )
+  {
+    BlitUnpackSprite( &g_vBlitSprites[ nSprite ], pMask, pSprite );
+  }
+}
+
+void DrawListBegin()
+{
+  g_nDrawItemCount = 0;
+  g_nDroppedItems = 0;
+}
+
+static void AddItem( EDrawItemKind eKind, int nXPx, int nYPx, int nArg )
+{
+  if( g_nDrawItemCount == cnDrawListMaxItems )
+  {
+    ++g_nDroppedItems;
+    return;
+  }
+
+  struct DrawItem* pItem = &g_vDrawItems[ g_nDrawItemCount++ ];
+
+  pItem->m_nX = (int16_t)nXPx;
+  pItem->m_nY = (int16_t)nYPx;
+  pItem->m_eKind = (uint8_t)eKind;
+  pItem->m_nArg = (uint8_t)nArg;
+}
+
+void DrawListAddBlock( int nXPx, int nYPx, int nFaces )
+{
+  AddItem( eDrawItemBlock, nXPx, nYPx, nFaces );
+}
+
+void DrawListAddBridgeHint( int nXPx, int nYPx )
+{
+  AddItem( eDrawItemBridgeHint, nXPx, nYPx, 0 );
+}
+
+void DrawListAddDangerMarker( int nXPx, int nYPx )
+{
+  AddItem( eDrawItemDangerMarker, nXPx, nYPx, 0 );
+}
+
+void DrawListAddExitMarker( int nXPx, int nYPx, bool fFillWhite )
+{
+  AddItem( eDrawItemExitMarker, nXPx, nYPx, fFillWhite ? 1 : 0 );
+}
+
+void DrawListAddSprite( int nSprite, int nXPx, int nYPx )
+{
+  if(    nSprite < 0
+      || nSprite >= cnDrawListMaxSprites
+      || ! g_vDrawListSprites[ nSprite ].m_pMask
+      || ! g_vDrawListSprites[ nSprite ].m_pSprite )
+  {
+    return;
+  }
+
+  AddItem( eDrawItemSprite, nXPx, nYPx, nSprite );
+}
+
+// -------------------------------------------------------------------
+// Playback
+//
+
+static void SetFillColour( GContext* ctx, bool fWhite )
+{
+  if( g_nFillColour != (int)fWhite )
+  {
+    graphics_context_set_fill_color( ctx, fWhite ? GColorWhite : GColorBlack );
+    g_nFillColour = (int)fWhite;
+    ++g_nStateChanges;
+  }
+}
+
+static void SetStrokeColour( GContext* ctx, bool fWhite )
+{
+  if( g_nStrokeColour != (int)fWhite )
+  {
+    graphics_context_set_stroke_color( ctx, fWhite ? GColorWhite : GColorBlack );
+    g_nStrokeColour = (int)fWhite;
+    ++g_nStateChanges;
+  }
+}
+
+static void SetCompOp( GContext* ctx, GCompOp eCompOp )
+{
+  if( g_nCompOp != (int)eCompOp )
+  {
+    graphics_context_set_compositing_mode( ctx, eCompOp );
+    g_nCompOp = (int)eCompOp;
+    ++g_nStateChanges;
+  }
+}
+
+// Pixels an item can touch, outlines included
+static GRect ItemBounds( const struct DrawItem* pItem )
+{
+  switch( pItem->m_eKind )
+  {
+    case eDrawItemBlock:
+      if( pItem->m_nArg == eBlockFaceAll )
+      {
+        // The front edge line runs down to y + 21
+        return GRect( pItem->m_nX, pItem->m_nY, 17, 22 );
+      }
+
+      if( pItem->m_nArg & ( eBlockFaceLeft | eBlockFaceRight ) )
+      {
+        return GRect( pItem->m_nX, pItem->m_nY, 17, 15 );
+      }
+
+      return GRect( pItem->m_nX, pItem->m_nY, 17, 11 );
+
+    case eDrawItemBridgeHint:
+      return GRect( pItem->m_nX, pItem->m_nY, 17, 15 );
+
+    case eDrawItemDangerMarker:
+      return GRect( pItem->m_nX + 3, pItem->m_nY + 2, 11, 7 );
+
+    case eDrawItemExitMarker:
+      return GRect( pItem->m_nX, pItem->m_nY, 7, 7 );
+
+    default:
+      return GRect( pItem->m_nX, pItem->m_nY, c_nSpriteDimensionPx, c_nSpriteDimensionPx );
+  }
+}
+
+static bool RectsOverlap( GRect a, GRect b )
+{
+  return    a.origin.x < b.origin.x + b.size.w
+         && b.origin.x < a.origin.x + a.size.w
+         && a.origin.y < b.origin.y + b.size.h
+         && b.origin.y < a.origin.y + a.size.h;
+}
+
+static bool BatchOverlaps( GRect bounds )
+{
+  for( int nBatch = 0 ; nBatch < g_nBatchCount ; ++nBatch )
+  {
+    if( RectsOverlap( bounds, ItemBounds( &g_vDrawItems[ g_vBatch[ nBatch ] ] ) ) )
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static void DrawBatch( GContext* ctx )
+{
+  if( g_nBatchCount == 0 )
+  {
+    return;
+  }
+
+  // Punch out every silhouette first then lay the sprite detail on top
+  SetCompOp( ctx, GCompOpOr );
+
+  for( int nBatch = 0 ; nBatch < g_nBatchCount ; ++nBatch )
+  {
+    const struct DrawItem* pItem = &g_vDrawItems[ g_vBatch[ nBatch ] ];
+
+    graphics_draw_bitmap_in_rect( ctx,
+                                  (const GBitmap*) g_vDrawListSprites[ pItem->m_nArg ].m_pMask,
+                                  ItemBounds( pItem ) );
+  }
+
+  SetCompOp( ctx, GCompOpAnd );
+
+  for( int nBatch = 0 ; nBatch < g_nBatchCount ; ++nBatch )
+  {
+    const struct DrawItem* pItem = &g_vDrawItems[ g_vBatch[ nBatch ] ];
+
+    graphics_draw_bitmap_in_rect( ctx,
+                                  (const GBitmap*) g_vDrawListSprites[ pItem->m_nArg ].m_pSprite,
+                                  ItemBounds( pItem ) );
+  }
+
+  g_nBatchCount = 0;
+}
+
+static void DrawBlockLine( GContext* ctx, GPoint origin, int nX0, int nY0, int nX1, int nY1 )
+{
+  graphics_draw_line( ctx,
+                      GPoint( origin.x + nX0, origin.y + nY0 ),
+                      GPoint( origin.x + nX1, origin.y + nY1 ) );
+}
+
+static void DrawBlock( GContext* ctx, GPoint origin, int nFaces )
+{
+  if( ( nFaces & eBlockFaceAll ) == eBlockFaceAll )
+  {
+    gpath_move_to( g_pDrawListBlock, origin );
+
+    SetFillColour( ctx, true );
+    gpath_draw_filled( ctx, g_pDrawListBlock );
+
+    SetStrokeColour( ctx, false );
+    gpath_draw_outline( ctx, g_pDrawListBlock );
+
+    // Face outlines the path outline doesn't already give us
+    DrawBlockLine( ctx, origin, 0, 5, 8, 10 );
+    DrawBlockLine( ctx, origin, 8, 10, 16, 5 );
+    DrawBlockLine( ctx, origin, 8, 10, 8, 21 );
+    return;
+  }
+
+  GPath* pPath = g_pDrawListBlockTop;
+
+  if( nFaces & eBlockFaceLeft )
+  {
+    pPath = g_pDrawListBlockTopLeft;
+  }
+  else if( nFaces & eBlockFaceRight )
+  {
+    pPath = g_pDrawListBlockTopRight;
+  }
+
+  gpath_move_to( pPath, origin );
+
+  SetFillColour( ctx, true );
+  gpath_draw_filled( ctx, pPath );
+
+  // The cut down path is only filled. Its outline would run some edges
+  // the other way round from the whole block's, and a line drawn the
+  // other way can land on different pixels, so each edge still showing
+  // is drawn as the whole block draws it.
+  SetStrokeColour( ctx, false );
+
+  DrawBlockLine( ctx, origin, 0, 5, 8, 0 );
+  DrawBlockLine( ctx, origin, 8, 0, 16, 5 );
+  DrawBlockLine( ctx, origin, 0, 5, 8, 10 );
+  DrawBlockLine( ctx, origin, 8, 10, 16, 5 );
+
+  if( nFaces & eBlockFaceRight )
+  {
+    DrawBlockLine( ctx, origin, 16, 5, 16, 9 );
+    DrawBlockLine( ctx, origin, 16, 9, 8, 14 );
+  }
+
+  if( nFaces & eBlockFaceLeft )
+  {
+    DrawBlockLine( ctx, origin, 8, 14, 0, 9 );
+    DrawBlockLine( ctx, origin, 0, 9, 0, 5 );
+  }
+
+  if( nFaces & ( eBlockFaceLeft | eBlockFaceRight ) )
+  {
+    DrawBlockLine( ctx, origin, 8, 10, 8, 14 );
+  }
+}
+
+static void DrawShape( GContext* ctx, const struct DrawItem* pItem )
+{
+  GPoint origin = GPoint( pItem->m_nX, pItem->m_nY );
+
+  switch( pItem->m_eKind )
+  {
+    case eDrawItemBlock:
+      DrawBlock( ctx, origin, pItem->m_nArg );
+      break;
+
+    case eDrawItemBridgeHint:
+      gpath_move_to( g_pDrawListBlock, origin );
+
+      SetStrokeColour( ctx, true );
+      gpath_draw_outline( ctx, g_pDrawListBlock );
+      break;
+
+    case eDrawItemDangerMarker:
+      gpath_move_to( g_pDrawListDangerMarker, origin );
+
+      SetFillColour( ctx, false );
+      gpath_draw_filled( ctx, g_pDrawListDangerMarker );
+      break;
+
+    case eDrawItemExitMarker:
+      gpath_move_to( g_pDrawListExitMarker, origin );
+
+      SetFillColour( ctx, pItem->m_nArg != 0 );
+      gpath_draw_filled( ctx, g_pDrawListExitMarker );
+
+      SetStrokeColour( ctx, false );
+      gpath_draw_outline( ctx, g_pDrawListExitMarker );
+      break;
+
+    default:
+      break;
+  }
+}
+
+// Stats for one item, the same whichever path draws it
+static void CountItem( const struct DrawItem* pItem )
+{
+  switch( pItem->m_eKind )
+  {
+    case eDrawItemBridgeHint:
+    case eDrawItemDangerMarker:
+      g_nUnbatchedStateChanges += 1;
+      break;
+
+    default:
+      g_nUnbatchedStateChanges += 2;
+      break;
+  }
+}
+
+static void ForgetContextState()
+{
+  // Nothing is known about the context at the start of a frame
+  g_nFillColour = c_nStateUnknown;
+  g_nStrokeColour = c_nStateUnknown;
+  g_nCompOp = c_nStateUnknown;
+}
+
+// -------------------------------------------------------------------
+// Framebuffer blit path
+//
+
+static int StampSlotX( int nStamp )
+{
+  return ( nStamp % cnStampsPerBand ) * 32;
+}
+
+static int StampSlotY( int nStamp )
+{
+  return ( nStamp / cnStampsPerBand ) * cnBlitStampRows;
+}
+
+static int StampForItem( const struct DrawItem* pItem )
+{
+  for( int nStamp = 0 ; nStamp < eStampCount ; ++nStamp )
+  {
+    if(    c_vStampShapes[ nStamp ].m_eKind == pItem->m_eKind
+        && c_vStampShapes[ nStamp ].m_nArg == pItem->m_nArg )
+    {
+      return nStamp;
+    }
+  }
+
+  return -1;
+}
+
+static bool CaptureStampPass( GContext* ctx, bool fOnWhite )
+{
+  ForgetContextState();
+
+  graphics_context_set_fill_color( ctx, fOnWhite ? GColorWhite : GColorBlack );
+  graphics_fill_rect( ctx, GRect( 0, 0, c_nStampAreaWidth, c_nStampAreaHeight ), 0, GCornerNone );
+
+  for( int nStamp = 0 ; nStamp < eStampCount ; ++nStamp )
+  {
+    struct DrawItem item;
+
+    item.m_nX = (int16_t)StampSlotX( nStamp );
+    item.m_nY = (int16_t)StampSlotY( nStamp );
+    item.m_eKind = c_vStampShapes[ nStamp ].m_eKind;
+    item.m_nArg = c_vStampShapes[ nStamp ].m_nArg;
+
+    DrawShape( ctx, &item );
+  }
+
+  GBitmap* pFramebuffer = graphics_capture_frame_buffer( ctx );
+
+  if( ! pFramebuffer )
+  {
+    return false;
+  }
+
+  struct BlitTarget target;
+
+  if( ! BlitTargetFromBitmap( &target, pFramebuffer ) )
+  {
+    graphics_release_frame_buffer( ctx, pFramebuffer );
+    return false;
+  }
+
+  for( int nStamp = 0 ; nStamp < eStampCount ; ++nStamp )
+  {
+    if( fOnWhite )
+    {
+      BlitCaptureStampOnWhite( &g_vStamps[ nStamp ], &target, StampSlotX( nStamp ), StampSlotY( nStamp ) );
+    }
+    else
+    {
+      BlitCaptureStampOnBlack( &g_vStamps[ nStamp ], &target, StampSlotX( nStamp ), StampSlotY( nStamp ), cnBlitStampRows );
+    }
+  }
+
+  graphics_release_frame_buffer( ctx, pFramebuffer );
+
+  return true;
+}
+
+// Draw every shape once through the SDK and keep what it produced. Runs
+// on the first blitted frame, before anything else is drawn, and leaves
+// the area black again for the window background.
+static bool CaptureStamps( GContext* ctx )
+{
+  bool fCaptured =    CaptureStampPass( ctx, false )
+                   && CaptureStampPass( ctx, true );
+
+  graphics_context_set_fill_color( ctx, GColorBlack );
+  graphics_fill_rect( ctx, GRect( 0, 0, c_nStampAreaWidth, c_nStampAreaHeight ), 0, GCornerNone );
+
+  ForgetContextState();
+
+  return fCaptured;
+}
+
+static bool DrawItemsToFramebuffer( GContext* ctx )
+{
+  GBitmap* pFramebuffer = graphics_capture_frame_buffer( ctx );
+
+  if( ! pFramebuffer )
+  {
+    return false;
+  }
+
+  struct BlitTarget target;
+
+  if( ! BlitTargetFromBitmap( &target, pFramebuffer ) )
+  {
+    graphics_release_frame_buffer( ctx, pFramebuffer );
+    return false;
+  }
+
+  // Straight painter order, the kernels don't have any state to batch
+  for( int nItem = 0 ; nItem < g_nDrawItemCount ; ++nItem )
+  {
+    const struct DrawItem* pItem = &g_vDrawItems[ nItem ];
+
+    if( pItem->m_eKind == eDrawItemSprite )
+    {
+      BlitDrawSprite( &target, &g_vBlitSprites[ pItem->m_nArg ], pItem->m_nX, pItem->m_nY );
+    }
+    else
+    {
+      int nStamp = StampForItem( pItem );
+
+      if( nStamp >= 0 )
+      {
+        BlitDrawStamp( &target, &g_vStamps[ nStamp ], pItem->m_nX, pItem->m_nY );
+      }
+    }
+
+    CountItem( pItem );
+  }
+
+  graphics_release_frame_buffer( ctx, pFramebuffer );
+
+  return true;
+}
+
+void DrawListSetFramebufferBlit( bool fEnable )
+{
+  g_fFramebufferBlit = fEnable;
+}
+
+bool DrawListFramebufferBlit()
+{
+  return g_fFramebufferBlit;
+}
+
+// -------------------------------------------------------------------
+// Frame
+//
+
+static void AddToTotals()
+{
+  ++g_nDrawListFrames;
+  g_nDrawListTotalItems += (uint32_t)g_nLastItemCount;
+  g_nDrawListTotalStateChanges += (uint32_t)g_nStateChanges;
+  g_nDrawListTotalUnbatchedStateChanges += (uint32_t)g_nUnbatchedStateChanges;
+  g_nDrawListTotalDroppedItems += (uint32_t)g_nDroppedItems;
+}
+
+void DrawListDraw( GContext* ctx )
+{
+  if(    g_fFramebufferBlit
+      && ! g_fStampsCaptured )
+  {
+    g_fStampsCaptured = CaptureStamps( ctx );
+
+    if( ! g_fStampsCaptured )
+    {
+      // No framebuffer access, or not one the kernels can write, stay on
+      // the SDK path for good
+      g_fFramebufferBlit = false;
+    }
+  }
+
+  ForgetContextState();
+
+  g_nStateChanges = 0;
+  g_nUnbatchedStateChanges = 0;
+  g_nBatchCount = 0;
+  g_nLastItemCount = g_nDrawItemCount;
+
+  if(    g_fFramebufferBlit
+      && DrawItemsToFramebuffer( ctx ) )
+  {
+    AddToTotals();
+    return;
+  }
+
+  for( int nItem = 0 ; nItem < g_nDrawItemCount ; ++nItem )
+  {
+    const struct DrawItem* pItem = &g_vDrawItems[ nItem ];
+
+    // Anything drawn over a held back sprite must wait for it
+    if(    BatchOverlaps( ItemBounds( pItem ) )
+        || (    pItem->m_eKind == eDrawItemSprite
+             && g_nBatchCount == cnDrawListMaxBatch ) )
+    {
+      DrawBatch( ctx );
+    }
+
+    if( pItem->m_eKind == eDrawItemSprite )
+    {
+      g_vBatch[ g_nBatchCount++ ] = nItem;
+    }
+    else
+    {
+      DrawShape( ctx, pItem );
+    }
+
+    CountItem( pItem );
+  }
+
+  DrawBatch( ctx );
+
+  AddToTotals();
+}
+
+int DrawListItemCount()
+{
+  return g_nLastItemCount;
+}
+
+int DrawListStateChanges()
+{
+  return g_nStateChanges;
+}
+
+int DrawListUnbatchedStateChanges()
+{
+  return g_nUnbatchedStateChanges;
+}
+
+int DrawListDroppedItems()
+{
+  return g_nDroppedItems;
+}
+
+void DrawListLogSummary()
+{
+  uint32_t nFrames = g_nDrawListFrames ? g_nDrawListFrames : 1;
+
+  APP_LOG( APP_LOG_LEVEL_INFO,
+           "draw list : %d frames, per frame %d items, %d state changes ( %d unbatched ), %d items dropped",
+           (int)g_nDrawListFrames,
+           (int)( g_nDrawListTotalItems / nFrames ),
+           (int)( g_nDrawListTotalStateChanges / nFrames ),
+           (int)( g_nDrawListTotalUnbatchedStateChanges / nFrames ),
+           (int)g_nDrawListTotalDroppedItems );
+}
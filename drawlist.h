@@ -0,0 +1,88 @@
+#ifndef HOPPER_DRAWLIST_H
+#define HOPPER_DRAWLIST_H
+
+#include <pebble.h>
+
+// -------------------------------------------------------------------
+// Painter ordered draw list
+//
+// A frame is described back to front as a list of items and then played
+// out in a single pass. Playback remembers the fill colour, stroke colour
+// and compositing mode last set on the context and only changes them when
+// an item needs something different.
+//
+// Sprites are a mask drawn with GCompOpOr then the sprite drawn with
+// GCompOpAnd. A run of sprites that don't overlap one another is held
+// back and drawn as all of the masks then all of the sprites, two mode
+// changes for the whole run. The run is drawn as soon as a later item
+// overlaps any sprite in it, so the picture is the same as strict
+// painter order.
+//
+
+typedef enum
+{
+  eDrawItemBlock = 0,         // filled isometric block with face outlines
+  eDrawItemBridgeHint = 1,    // white outline of a block still to be built
+  eDrawItemDangerMarker = 2,  // black diamond on a block's top face
+  eDrawItemExitMarker = 3,    // arrow, filled white or black
+  eDrawItemSprite = 4         // registered mask and sprite pair
+} EDrawItemKind;
+
+// Faces of a block still worth drawing once the blocks in front of it
+// are down. The top face is always open on a flat map, left and right
+// are the two side faces as seen on screen.
+typedef enum
+{
+  eBlockFaceTop = 1,
+  eBlockFaceLeft = 2,
+  eBlockFaceRight = 4,
+  eBlockFaceAll = 7
+} EBlockFace;
+
+// Every tile as block plus marker, a gem on each and all the units
+#define cnDrawListMaxItems 208
+
+#define cnDrawListMaxSprites 16
+
+// The block paths are the whole block, the top face alone and the top
+// face with its left or right side face
+void DrawListInit( GPath* pBlock, 
+                   GPath* pBlockTop,
+                   GPath* pBlockTopLeft,
+                   GPath* pBlockTopRight,
+                   GPath* pExitMarker, 
+                   GPath* pDangerMarker );
+
+// Register the mask and sprite bitmaps drawn for sprite id nSprite
+void DrawListSetSprite( int nSprite, GBitmap* pMask, GBitmap* pSprite );
+
+// Start describing a new frame
+void DrawListBegin();
+
+// Add items back to front, positions are the top left in pixels
+void DrawListAddBlock( int nXPx, int nYPx, int nFaces );
+void DrawListAddBridgeHint( int nXPx, int nYPx );
+void DrawListAddDangerMarker( int nXPx, int nYPx );
+void DrawListAddExitMarker( int nXPx, int nYPx, bool fFillWhite );
+void DrawListAddSprite( int nSprite, int nXPx, int nYPx );
+
+// Play the frame out onto the context
+void DrawListDraw( GContext* ctx );
+
+// Draw straight into the framebuffer with the blit kernels rather than
+// through gpath and bitmap calls. The first frame drawn this way captures
+// each shape from the SDK, so the picture is the same either way.
+void DrawListSetFramebufferBlit( bool fEnable );
+bool DrawListFramebufferBlit();
+
+// Stats for the last frame drawn. Unbatched is what setting the state
+// for every item individually would have cost.
+int DrawListItemCount();
+int DrawListStateChanges();
+int DrawListUnbatchedStateChanges();
+int DrawListDroppedItems();
+
+// Frames drawn so far, their average stats and all the items dropped
+void DrawListLogSummary();
+
+#endif // HOPPER_DRAWLIST_H
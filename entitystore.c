@@ -0,0 +1,183 @@
+#include "entitystore.h"
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+#define cnEntityStoreCells ( cnBitboardSide * cnBitboardSide )
+
+struct EntityKindStore
+{
+  Bitboard m_nCells;
+  int m_nCount;
+
+  // Dense, the first m_nCount are live
+  uint8_t m_vCells[ cnEntityStoreCells ];
+  uint8_t m_vPayloads[ cnEntityStoreCells ];
+
+  // Dense slot of the entity on each cell, only meaningful where the
+  // cell's bit is set in m_nCells
+  uint8_t m_vSlotOfCell[ cnEntityStoreCells ];
+};
+
+// A little over 1k all told
+static struct EntityKindStore g_vEntityKinds[ eEntityKindCount ];
+static uint8_t g_vEntityCellMasks[ cnEntityStoreCells ];
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+static bool AddAtCell( EEntityKind eKind, int nCell, uint8_t nPayload )
+{
+  struct EntityKindStore* pKind = &g_vEntityKinds[ eKind ];
+  Bitboard nBit = (Bitboard)1 << nCell;
+
+  if( pKind->m_nCells & nBit )
+  {
+    return false;
+  }
+
+  int nSlot = pKind->m_nCount++;
+
+  pKind->m_vCells[ nSlot ] = (uint8_t)nCell;
+  pKind->m_vPayloads[ nSlot ] = nPayload;
+  pKind->m_vSlotOfCell[ nCell ] = (uint8_t)nSlot;
+  pKind->m_nCells |= nBit;
+
+  g_vEntityCellMasks[ nCell ] |= EntityKindBit( eKind );
+
+  return true;
+}
+
+static bool RemoveAtCell( EEntityKind eKind, int nCell )
+{
+  struct EntityKindStore* pKind = &g_vEntityKinds[ eKind ];
+  Bitboard nBit = (Bitboard)1 << nCell;
+
+  if( ! ( pKind->m_nCells & nBit ) )
+  {
+    return false;
+  }
+
+  // Swap the last entity into the hole
+  int nSlot = pKind->m_vSlotOfCell[ nCell ];
+  int nLast = --pKind->m_nCount;
+
+  pKind->m_vCells[ nSlot ] = pKind->m_vCells[ nLast ];
+  pKind->m_vPayloads[ nSlot ] = pKind->m_vPayloads[ nLast ];
+  pKind->m_vSlotOfCell[ pKind->m_vCells[ nSlot ] ] = (uint8_t)nSlot;
+  pKind->m_nCells &= ~nBit;
+
+  g_vEntityCellMasks[ nCell ] &= (uint8_t)~EntityKindBit( eKind );
+
+  return true;
+}
+
+void EntityStoreClear()
+{
+  for( int nKind = 0 ; nKind < eEntityKindCount ; ++nKind )
+  {
+    g_vEntityKinds[ nKind ].m_nCells = 0;
+    g_vEntityKinds[ nKind ].m_nCount = 0;
+  }
+
+  for( int nCell = 0 ; nCell < cnEntityStoreCells ; ++nCell )
+  {
+    g_vEntityCellMasks[ nCell ] = 0;
+  }
+}
+
+void EntityStoreClearKind( EEntityKind eKind )
+{
+  struct EntityKindStore* pKind = &g_vEntityKinds[ eKind ];
+
+  for( int nSlot = 0 ; nSlot < pKind->m_nCount ; ++nSlot )
+  {
+    g_vEntityCellMasks[ pKind->m_vCells[ nSlot ] ] &= (uint8_t)~EntityKindBit( eKind );
+  }
+
+  pKind->m_nCells = 0;
+  pKind->m_nCount = 0;
+}
+
+void EntityStoreSetKindCells( EEntityKind eKind, Bitboard nCells, uint8_t nPayload )
+{
+  EntityStoreClearKind( eKind );
+
+  while( nCells )
+  {
+    AddAtCell( eKind, BitboardLowestIndex( nCells ), nPayload );
+    nCells &= nCells - 1;
+  }
+}
+
+bool EntityStoreAdd( EEntityKind eKind, int x, int y, uint8_t nPayload )
+{
+  return AddAtCell( eKind, BitboardIndex( x, y ), nPayload );
+}
+
+bool EntityStoreRemove( EEntityKind eKind, int x, int y )
+{
+  return RemoveAtCell( eKind, BitboardIndex( x, y ) );
+}
+
+bool EntityStoreMove( EEntityKind eKind, int nFromX, int nFromY, int nToX, int nToY, uint8_t nPayload )
+{
+  int nFrom = BitboardIndex( nFromX, nFromY );
+  int nTo = BitboardIndex( nToX, nToY );
+
+  if(    nFrom != nTo
+      && ( g_vEntityKinds[ eKind ].m_nCells & ( (Bitboard)1 << nTo ) ) )
+  {
+    return false;
+  }
+
+  RemoveAtCell( eKind, nFrom );
+
+  return AddAtCell( eKind, nTo, nPayload );
+}
+
+uint8_t EntityStoreCellMask( int x, int y )
+{
+  return g_vEntityCellMasks[ BitboardIndex( x, y ) ];
+}
+
+bool EntityStoreHas( EEntityKind eKind, int x, int y )
+{
+  return ( g_vEntityCellMasks[ BitboardIndex( x, y ) ] & EntityKindBit( eKind ) ) != 0;
+}
+
+uint8_t EntityStorePayload( EEntityKind eKind, int x, int y )
+{
+  int nCell = BitboardIndex( x, y );
+  const struct EntityKindStore* pKind = &g_vEntityKinds[ eKind ];
+
+  if( ! ( g_vEntityCellMasks[ nCell ] & EntityKindBit( eKind ) ) )
+  {
+    return 0;
+  }
+
+  return pKind->m_vPayloads[ pKind->m_vSlotOfCell[ nCell ] ];
+}
+
+void EntityStoreSetPayload( EEntityKind eKind, int x, int y, uint8_t nPayload )
+{
+  int nCell = BitboardIndex( x, y );
+  struct EntityKindStore* pKind = &g_vEntityKinds[ eKind ];
+
+  if( g_vEntityCellMasks[ nCell ] & EntityKindBit( eKind ) )
+  {
+    pKind->m_vPayloads[ pKind->m_vSlotOfCell[ nCell ] ] = nPayload;
+  }
+}
+
+Bitboard EntityStoreCells( EEntityKind eKind )
+{
+  return g_vEntityKinds[ eKind ].m_nCells;
+}
+
+int EntityStoreCount( EEntityKind eKind )
+{
+  return g_vEntityKinds[ eKind ].m_nCount;
+}
@@ -0,0 +1,58 @@
+#ifndef HOPPER_ENTITYSTORE_H
+#define HOPPER_ENTITYSTORE_H
+
+#include "bitboard.h"
+
+// -------------------------------------------------------------------
+// What stands on each tile, other than the player
+//
+// Each kind of entity keeps a dense array of the tiles it is on, with a
+// payload byte per entity ( a skeleton's facing ), so walking every gem
+// or every skeleton touches nothing else. Each tile keeps a mask with a
+// bit per kind standing on it, and each kind a bitboard of its tiles,
+// so "what is on ( x, y )" and whole map questions are a single load.
+//
+// A tile holds at most one entity of each kind but any mix of kinds, so
+// a gem and a skeleton can share one. Everything is fixed size and
+// nothing allocates. New pickups or hazards are a new kind, up to 8.
+//
+
+typedef enum
+{
+  eEntityKindGem = 0,
+  eEntityKindEnemy = 1,
+  eEntityKindCount = 2
+} EEntityKind;
+
+#define EntityKindBit( eKind ) ( (uint8_t)( 1 << ( eKind ) ) )
+
+// Empties every kind, or just the one
+void EntityStoreClear();
+void EntityStoreClearKind( EEntityKind eKind );
+
+// Replaces every entity of a kind with one on each cell in nCells
+void EntityStoreSetKindCells( EEntityKind eKind, Bitboard nCells, uint8_t nPayload );
+
+// False, and nothing changed, if there's already one of that kind there
+bool EntityStoreAdd( EEntityKind eKind, int x, int y, uint8_t nPayload );
+
+// False if there wasn't one of that kind there
+bool EntityStoreRemove( EEntityKind eKind, int x, int y );
+
+// Off ( nFromX, nFromY ) if it was there and on to ( nToX, nToY ) with
+// the payload given. False if the destination already has one.
+bool EntityStoreMove( EEntityKind eKind, int nFromX, int nFromY, int nToX, int nToY, uint8_t nPayload );
+
+// Kinds on a tile, EntityKindBit( kind ) for each
+uint8_t EntityStoreCellMask( int x, int y );
+
+bool EntityStoreHas( EEntityKind eKind, int x, int y );
+
+// Payload of the one of that kind on a tile, 0 if there's none
+uint8_t EntityStorePayload( EEntityKind eKind, int x, int y );
+void EntityStoreSetPayload( EEntityKind eKind, int x, int y, uint8_t nPayload );
+
+Bitboard EntityStoreCells( EEntityKind eKind );
+int EntityStoreCount( EEntityKind eKind );
+
+#endif // HOPPER_ENTITYSTORE_H
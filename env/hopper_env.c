@@ -0,0 +1,277 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "hopper_env.h"
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+struct HopperEnvWorker
+{
+  struct HopperEnv* m_pEnv;
+  pthread_t m_thread;
+  int m_nFirstGame;
+  int m_nLastGame;
+};
+
+struct HopperEnv
+{
+  int m_nGames;
+  int m_nThreads;
+
+  struct HopperGame* m_pGames;
+  uint64_t* m_pnObservations;
+  float* m_pfRewards;
+  uint8_t* m_pnDones;
+
+  // Set before each step, read by the workers
+  const uint8_t* m_pnActions;
+  bool m_fQuit;
+
+  bool m_fThreadsStarted;
+  pthread_barrier_t m_stepStart;
+  pthread_barrier_t m_stepDone;
+
+  struct HopperEnvWorker* m_pWorkers;
+};
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+static void WriteObservation( const struct HopperGame* pGame, uint64_t* pnObs )
+{
+  pnObs[ 0 ] = pGame->m_nLand;
+  pnObs[ 1 ] = pGame->m_nGems;
+  pnObs[ 2 ] = HopperGameEnemyBits( pGame );
+  pnObs[ 3 ] =   (uint64_t)pGame->m_nPlayerX
+               | ( (uint64_t)pGame->m_nPlayerY << 3 )
+               | ( (uint64_t)pGame->m_nPlayerFacing << 6 )
+               | ( (uint64_t)pGame->m_nExitX << 8 )
+               | ( (uint64_t)pGame->m_nExitY << 11 )
+               | ( (uint64_t)pGame->m_fCanLevelBeExited << 14 );
+}
+
+static void ResetGame( struct HopperGame* pGame )
+{
+  // Next episode's seed comes from this game's own stream
+  uint64_t nSeed = ( (uint64_t)RngNext( &pGame->m_rng ) << 32 ) | RngNext( &pGame->m_rng );
+
+  HopperGameReset( pGame, nSeed );
+}
+
+static void StepRange( struct HopperEnv* pEnv, int nFirstGame, int nLastGame )
+{
+  const uint8_t* pnActions = pEnv->m_pnActions;
+
+  for( int nGame = nFirstGame ; nGame < nLastGame ; ++nGame )
+  {
+    struct HopperGame* pGame = &pEnv->m_pGames[ nGame ];
+
+    int nReward = HopperGameStep( pGame, (EHopperAction)pnActions[ nGame ] );
+
+    bool fDone =    pGame->m_fGameOver
+                 || pGame->m_nTicks >= cnHopperMaxEpisodeTicks;
+
+    if( fDone )
+    {
+      ResetGame( pGame );
+    }
+
+    pEnv->m_pfRewards[ nGame ] = (float)nReward;
+    pEnv->m_pnDones[ nGame ] = (uint8_t)fDone;
+
+    WriteObservation( pGame, &pEnv->m_pnObservations[ nGame * cnHopperObsWords ] );
+  }
+}
+
+static void* WorkerMain( void* pContext )
+{
+  struct HopperEnvWorker* pWorker = (struct HopperEnvWorker*)pContext;
+  struct HopperEnv* pEnv = pWorker->m_pEnv;
+
+  for( ;; )
+  {
+    pthread_barrier_wait( &pEnv->m_stepStart );
+
+    if( pEnv->m_fQuit )
+    {
+      return NULL;
+    }
+
+    StepRange( pEnv, pWorker->m_nFirstGame, pWorker->m_nLastGame );
+
+    pthread_barrier_wait( &pEnv->m_stepDone );
+  }
+}
+
+struct HopperEnv* HopperEnvCreate( int nGames, int nThreads, uint64_t nSeed )
+{
+  if( nThreads <= 0 )
+  {
+    nThreads = (int)sysconf( _SC_NPROCESSORS_ONLN );
+  }
+
+  if( nThreads > nGames )
+  {
+    nThreads = nGames;
+  }
+
+  if( nThreads < 1 )
+  {
+    nThreads = 1;
+  }
+
+  struct HopperEnv* pEnv = (struct HopperEnv*)calloc( 1, sizeof( struct HopperEnv ) );
+
+  if( ! pEnv )
+  {
+    return NULL;
+  }
+
+  pEnv->m_nGames = nGames;
+  pEnv->m_nThreads = nThreads;
+
+  // Line up the game records on cache lines so threads never share one
+  if(    posix_memalign( (void**)&pEnv->m_pGames, 64, sizeof( struct HopperGame ) * (size_t)nGames ) != 0
+      || posix_memalign( (void**)&pEnv->m_pnObservations, 64, sizeof( uint64_t ) * cnHopperObsWords * (size_t)nGames ) != 0 )
+  {
+    HopperEnvDestroy( pEnv );
+    return NULL;
+  }
+
+  pEnv->m_pfRewards = (float*)calloc( (size_t)nGames, sizeof( float ) );
+  pEnv->m_pnDones = (uint8_t*)calloc( (size_t)nGames, sizeof( uint8_t ) );
+  pEnv->m_pWorkers = (struct HopperEnvWorker*)calloc( (size_t)nThreads, sizeof( struct HopperEnvWorker ) );
+
+  if( ! pEnv->m_pfRewards || ! pEnv->m_pnDones || ! pEnv->m_pWorkers )
+  {
+    HopperEnvDestroy( pEnv );
+    return NULL;
+  }
+
+  for( int nGame = 0 ; nGame < nGames ; ++nGame )
+  {
+    HopperGameReset( &pEnv->m_pGames[ nGame ], RngMix64( nSeed + (uint64_t)nGame ) );
+    WriteObservation( &pEnv->m_pGames[ nGame ], &pEnv->m_pnObservations[ nGame * cnHopperObsWords ] );
+  }
+
+  // Worker 0 is the calling thread, the rest get their own
+  pthread_barrier_init( &pEnv->m_stepStart, NULL, (unsigned)nThreads );
+  pthread_barrier_init( &pEnv->m_stepDone, NULL, (unsigned)nThreads );
+
+  for( int nThread = 0 ; nThread < nThreads ; ++nThread )
+  {
+    struct HopperEnvWorker* pWorker = &pEnv->m_pWorkers[ nThread ];
+
+    pWorker->m_pEnv = pEnv;
+    pWorker->m_nFirstGame = (int)( (int64_t)nGames * nThread / nThreads );
+    pWorker->m_nLastGame = (int)( (int64_t)nGames * ( nThread + 1 ) / nThreads );
+
+    if( nThread > 0 )
+    {
+      pthread_create( &pWorker->m_thread, NULL, WorkerMain, pWorker );
+    }
+  }
+
+  pEnv->m_fThreadsStarted = true;
+
+  return pEnv;
+}
+
+void HopperEnvDestroy( struct HopperEnv* pEnv )
+{
+  if( ! pEnv )
+  {
+    return;
+  }
+
+  if( pEnv->m_fThreadsStarted )
+  {
+    pEnv->m_fQuit = true;
+
+    if( pEnv->m_nThreads > 1 )
+    {
+      pthread_barrier_wait( &pEnv->m_stepStart );
+    }
+
+    for( int nThread = 1 ; nThread < pEnv->m_nThreads ; ++nThread )
+    {
+      pthread_join( pEnv->m_pWorkers[ nThread ].m_thread, NULL );
+    }
+
+    pthread_barrier_destroy( &pEnv->m_stepStart );
+    pthread_barrier_destroy( &pEnv->m_stepDone );
+  }
+
+  free( pEnv->m_pGames );
+  free( pEnv->m_pnObservations );
+  free( pEnv->m_pfRewards );
+  free( pEnv->m_pnDones );
+  free( pEnv->m_pWorkers );
+  free( pEnv );
+}
+
+void HopperEnvReset( struct HopperEnv* pEnv )
+{
+  for( int nGame = 0 ; nGame < pEnv->m_nGames ; ++nGame )
+  {
+    struct HopperGame* pGame = &pEnv->m_pGames[ nGame ];
+
+    ResetGame( pGame );
+
+    pEnv->m_pfRewards[ nGame ] = 0.0f;
+    pEnv->m_pnDones[ nGame ] = 0;
+
+    WriteObservation( pGame, &pEnv->m_pnObservations[ nGame * cnHopperObsWords ] );
+  }
+}
+
+void HopperEnvStep( struct HopperEnv* pEnv, const uint8_t* pnActions )
+{
+  pEnv->m_pnActions = pnActions;
+
+  if( pEnv->m_nThreads == 1 )
+  {
+    StepRange( pEnv, 0, pEnv->m_nGames );
+    return;
+  }
+
+  pthread_barrier_wait( &pEnv->m_stepStart );
+
+  StepRange( pEnv, pEnv->m_pWorkers[ 0 ].m_nFirstGame, pEnv->m_pWorkers[ 0 ].m_nLastGame );
+
+  pthread_barrier_wait( &pEnv->m_stepDone );
+}
+
+int HopperEnvGameCount( const struct HopperEnv* pEnv )
+{
+  return pEnv->m_nGames;
+}
+
+int HopperEnvThreadCount( const struct HopperEnv* pEnv )
+{
+  return pEnv->m_nThreads;
+}
+
+const uint64_t* HopperEnvObservations( const struct HopperEnv* pEnv )
+{
+  return pEnv->m_pnObservations;
+}
+
+const float* HopperEnvRewards( const struct HopperEnv* pEnv )
+{
+  return pEnv->m_pfRewards;
+}
+
+const uint8_t* HopperEnvDones( const struct HopperEnv* pEnv )
+{
+  return pEnv->m_pnDones;
+}
+
+struct HopperGame* HopperEnvGames( struct HopperEnv* pEnv )
+{
+  return pEnv->m_pGames;
+}
@@ -0,0 +1,60 @@
+#ifndef HOPPER_ENV_H
+#define HOPPER_ENV_H
+
+#include "hopper_game.h"
+
+// -------------------------------------------------------------------
+// Batched lockstep environment
+//
+// Steps N independent games together for bot training and evaluation.
+// Games live in one contiguous array of 64 byte HopperGame records and
+// the results of each step are written to contiguous per-field arrays :
+//
+//   observations : cnHopperObsWords uint64_t per game
+//                  [ 0 ] land  [ 1 ] gems  [ 2 ] enemies  [ 3 ] packed
+//                  player x, y, facing, exit x, y and exit open flag
+//   rewards      : score change this step, one float per game
+//   dones        : 1 if the game ended this step
+//
+// A game that ends ( caught, or out of ticks ) is reset in the same step
+// from its own Rng, so its observation is already the first of the next
+// episode. Stepping fans out over a pool of worker threads that lives
+// as long as the environment.
+//
+
+#define cnHopperObsWords 4
+
+// Episodes are cut off here so a level whose last gem was stolen
+// can't run forever
+#define cnHopperMaxEpisodeTicks 2000
+
+struct HopperEnv;
+
+// nThreads of 0 uses every online core
+struct HopperEnv* HopperEnvCreate( int nGames, int nThreads, uint64_t nSeed );
+void HopperEnvDestroy( struct HopperEnv* pEnv );
+
+// Reset every game and fill in the observations
+void HopperEnvReset( struct HopperEnv* pEnv );
+
+// One action per game, values from EHopperAction
+void HopperEnvStep( struct HopperEnv* pEnv, const uint8_t* pnActions );
+
+int HopperEnvGameCount( const struct HopperEnv* pEnv );
+int HopperEnvThreadCount( const struct HopperEnv* pEnv );
+
+const uint64_t* HopperEnvObservations( const struct HopperEnv* pEnv );
+const float* HopperEnvRewards( const struct HopperEnv* pEnv );
+const uint8_t* HopperEnvDones( const struct HopperEnv* pEnv );
+
+struct HopperGame* HopperEnvGames( struct HopperEnv* pEnv );
+
+// Unpack the fourth observation word
+static inline int HopperObsPlayerX( uint64_t nPacked )      { return (int)( nPacked & 7 ); }
+static inline int HopperObsPlayerY( uint64_t nPacked )      { return (int)( ( nPacked >> 3 ) & 7 ); }
+static inline int HopperObsPlayerFacing( uint64_t nPacked ) { return (int)( ( nPacked >> 6 ) & 3 ); }
+static inline int HopperObsExitX( uint64_t nPacked )        { return (int)( ( nPacked >> 8 ) & 7 ); }
+static inline int HopperObsExitY( uint64_t nPacked )        { return (int)( ( nPacked >> 11 ) & 7 ); }
+static inline bool HopperObsCanExit( uint64_t nPacked )     { return ( nPacked >> 14 ) & 1; }
+
+#endif // HOPPER_ENV_H
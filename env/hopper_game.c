@@ -0,0 +1,292 @@
+#include <stdlib.h>
+
+#include "hopper_game.h"
+
+_Static_assert( sizeof( struct HopperGame ) <= 64, "HopperGame should fit a cache line" );
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+static bool StepCoords( int* pnX, int* pnY, int nFacing )
+{
+  switch( nFacing )
+  {
+    default:
+    case eHopperFacingNE:
+      ++*pnY;
+      break;
+
+    case eHopperFacingNW:
+      --*pnX;
+      break;
+
+    case eHopperFacingSW:
+      --*pnY;
+      break;
+
+    case eHopperFacingSE:
+      ++*pnX;
+      break;
+  }
+
+  return    *pnX >= 0
+         && *pnX < cnHopperSide
+         && *pnY >= 0
+         && *pnY < cnHopperSide;
+}
+
+Bitboard HopperGameEnemyBits( const struct HopperGame* pGame )
+{
+  Bitboard nEnemies = 0;
+
+  for( int nEnemy = 0 ; nEnemy < pGame->m_nNumberOfEnemies ; ++nEnemy )
+  {
+    nEnemies |= BitboardCell( pGame->m_vEnemyX[ nEnemy ], pGame->m_vEnemyY[ nEnemy ] );
+  }
+
+  return nEnemies;
+}
+
+void HopperGameGenerateLevel( struct HopperGame* pGame )
+{
+  struct Rng* pRng = &pGame->m_rng;
+
+  // Same draws in the same order as GenerateNewMap
+  uint32_t vCellDraws[ cnHopperSide * cnHopperSide ];
+
+  RngFill( pRng, vCellDraws, cnHopperSide * cnHopperSide );
+
+  Bitboard nLand = 0;
+  Bitboard nGems = 0;
+
+  for( int nCell = 0 ; nCell < cnHopperSide * cnHopperSide ; ++nCell )
+  {
+    if( RngScale16( vCellDraws[ nCell ], 6 ) != 0 )
+    {
+      nLand |= (Bitboard)1 << nCell;
+
+      if( RngScale16( vCellDraws[ nCell ] >> 16, 5 ) == 0 )
+      {
+        nGems |= (Bitboard)1 << nCell;
+      }
+    }
+  }
+
+  pGame->m_nLand = nLand;
+  pGame->m_nGems = nGems;
+
+  pGame->m_nPlayerX = (uint8_t)RngBelow( pRng, cnHopperSide );
+  pGame->m_nPlayerY = (uint8_t)RngBelow( pRng, cnHopperSide );
+  pGame->m_nPlayerFacing = eHopperFacingSE;
+
+  pGame->m_nExitX = (uint8_t)RngBelow( pRng, cnHopperSide );
+  pGame->m_nExitY = (uint8_t)RngBelow( pRng, cnHopperSide );
+
+  pGame->m_fCanLevelBeExited = false;
+
+  int nNumEnemiesToGenerate = 2 + RngBelow( pRng, 2 );
+
+  Bitboard nEnemies = 0;
+
+  for( int nEnemy = 0 ; nEnemy < nNumEnemiesToGenerate ; ++nEnemy )
+  {
+    int x;
+    int y;
+
+    // One skeleton a tile, drawn again as GenerateLiveLevel does
+    do
+    {
+      x = RngBelow( pRng, cnHopperSide );
+      y = RngBelow( pRng, cnHopperSide );
+    }
+    while( nEnemies & BitboardCell( x, y ) );
+
+    nEnemies |= BitboardCell( x, y );
+
+    pGame->m_vEnemyX[ nEnemy ] = (uint8_t)x;
+    pGame->m_vEnemyY[ nEnemy ] = (uint8_t)y;
+    pGame->m_vEnemyFacing[ nEnemy ] = eHopperFacingNE;
+  }
+
+  pGame->m_nNumberOfEnemies = (uint8_t)nNumEnemiesToGenerate;
+}
+
+void HopperGameReset( struct HopperGame* pGame, uint64_t nSeed )
+{
+  RngSeed( &pGame->m_rng, nSeed );
+
+  pGame->m_nScore = 0;
+  pGame->m_nTicks = 0;
+  pGame->m_fGameOver = false;
+  pGame->m_nLevelsCleared = 0;
+
+  HopperGameGenerateLevel( pGame );
+}
+
+int HopperGamePlayerAction( struct HopperGame* pGame, EHopperAction eAction )
+{
+  // Anti clockwise NE .. NW .. SW .. SE and the reverse, as
+  // UpdatePlayerDirectionFacing
+  static const uint8_t c_vRotateUp[] = { eHopperFacingNW, eHopperFacingSW, eHopperFacingNE, eHopperFacingSE };
+  static const uint8_t c_vRotateDown[] = { eHopperFacingSE, eHopperFacingNE, eHopperFacingSW, eHopperFacingNW };
+
+  switch( eAction )
+  {
+    case eHopperActionRotateUp:
+      pGame->m_nPlayerFacing = c_vRotateUp[ pGame->m_nPlayerFacing ];
+      return 0;
+
+    case eHopperActionRotateDown:
+      pGame->m_nPlayerFacing = c_vRotateDown[ pGame->m_nPlayerFacing ];
+      return 0;
+
+    default:
+      break;
+  }
+
+  int nScoreBefore = pGame->m_nScore;
+  int x = pGame->m_nPlayerX;
+  int y = pGame->m_nPlayerY;
+
+  if( ! StepCoords( &x, &y, pGame->m_nPlayerFacing ) )
+  {
+    return 0;
+  }
+
+  Bitboard nDest = BitboardCell( x, y );
+
+  if( ! ( pGame->m_nLand & nDest ) )
+  {
+    if( pGame->m_nScore < c_nHopperScoreLandCreationPenalty )
+    {
+      return 0;
+    }
+
+    // Create new land at a cost to score
+    pGame->m_nLand |= nDest;
+    pGame->m_nScore -= c_nHopperScoreLandCreationPenalty;
+  }
+
+  if( HopperGameEnemyBits( pGame ) & nDest )
+  {
+    return pGame->m_nScore - nScoreBefore;
+  }
+
+  pGame->m_nPlayerX = (uint8_t)x;
+  pGame->m_nPlayerY = (uint8_t)y;
+  pGame->m_nScore += c_nHopperScoreStep;
+
+  if( pGame->m_nGems & nDest )
+  {
+    pGame->m_nScore += c_nHopperScoreTreasure;
+    pGame->m_nGems &= ~nDest;
+
+    if( ! pGame->m_nGems )
+    {
+      pGame->m_fCanLevelBeExited = true;
+    }
+  }
+
+  if(    pGame->m_fCanLevelBeExited
+      && x == pGame->m_nExitX
+      && y == pGame->m_nExitY )
+  {
+    ++pGame->m_nLevelsCleared;
+    HopperGameGenerateLevel( pGame );
+  }
+
+  return pGame->m_nScore - nScoreBefore;
+}
+
+void HopperGameTickEnemies( struct HopperGame* pGame )
+{
+  // Hop offsets indexed by facing, NE NW SE SW
+  static const int8_t c_vStepX[] = { 0, -1, 1, 0 };
+  static const int8_t c_vStepY[] = { 1, 0, 0, -1 };
+
+  // Facing towards the player indexed by ( dx > 0 ) * 2 + ( dy > 0 ),
+  // the quadrants GetDisanceAndDirectionToPlayer picks
+  static const uint8_t c_vTowardsPlayer[] = { eHopperFacingNE, eHopperFacingSE, eHopperFacingNW, eHopperFacingSW };
+
+  ++pGame->m_nTicks;
+
+  Bitboard nEnemies = HopperGameEnemyBits( pGame );
+
+  for( int nEnemy = 0 ; nEnemy < pGame->m_nNumberOfEnemies ; ++nEnemy )
+  {
+    // Draws are taken as TickEnemyUnits and HandleEnemyUnitMove take
+    // them, one to move, one to turn and one for the new facing if it
+    // does, and one to crumble only after a hop, so a seed plays out the
+    // same here as on the watch
+    if( RngNext( &pGame->m_rng ) & 1 )
+    {
+      continue;
+    }
+
+    int nOldX = pGame->m_vEnemyX[ nEnemy ];
+    int nOldY = pGame->m_vEnemyY[ nEnemy ];
+    int nFacing = pGame->m_vEnemyFacing[ nEnemy ];
+
+    if( RngBelow( &pGame->m_rng, 3 ) == 0 )
+    {
+      nFacing = (int)( RngNext( &pGame->m_rng ) & 3 );
+    }
+
+    int nDeltaX = nOldX - pGame->m_nPlayerX;
+    int nDeltaY = nOldY - pGame->m_nPlayerY;
+    int nDistance = abs( nDeltaX ) > abs( nDeltaY ) ? abs( nDeltaX ) : abs( nDeltaY );
+
+    if( nDistance <= 5 )
+    {
+      nFacing = c_vTowardsPlayer[ ( nDeltaX > 0 ) * 2 + ( nDeltaY > 0 ) ];
+    }
+
+    pGame->m_vEnemyFacing[ nEnemy ] = (uint8_t)nFacing;
+
+    int x = nOldX + c_vStepX[ nFacing ];
+    int y = nOldY + c_vStepY[ nFacing ];
+
+    if( (unsigned)x >= cnHopperSide || (unsigned)y >= cnHopperSide )
+    {
+      continue;
+    }
+
+    Bitboard nOld = BitboardCell( nOldX, nOldY );
+    Bitboard nDest = BitboardCell( x, y );
+
+    if( ( ~pGame->m_nLand | nEnemies ) & nDest )
+    {
+      continue;
+    }
+
+    if( RngBelow( &pGame->m_rng, 10 ) == 0 )
+    {
+      // Crumble the tile behind
+      pGame->m_nLand &= ~nOld;
+    }
+
+    // Skeletons walk off with any gem they stand on
+    pGame->m_nGems &= ~nDest;
+
+    nEnemies = ( nEnemies & ~nOld ) | nDest;
+
+    pGame->m_vEnemyX[ nEnemy ] = (uint8_t)x;
+    pGame->m_vEnemyY[ nEnemy ] = (uint8_t)y;
+
+    if(    x == pGame->m_nPlayerX
+        && y == pGame->m_nPlayerY )
+    {
+      pGame->m_fGameOver = true;
+    }
+  }
+}
+
+int HopperGameStep( struct HopperGame* pGame, EHopperAction eAction )
+{
+  int nReward = HopperGamePlayerAction( pGame, eAction );
+
+  HopperGameTickEnemies( pGame );
+
+  return nReward;
+}
@@ -0,0 +1,90 @@
+#ifndef HOPPER_GAME_H
+#define HOPPER_GAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../bitboard.h"
+#include "../rng.h"
+
+// -------------------------------------------------------------------
+// Hopper rules on a compact, self contained game record
+//
+// Host side twin of the logic in main.c ( GenerateNewMap,
+// HandlePlayerMove, TickEnemyUnits ... ) for bots, solvers and tools.
+// Levels are drawn from the game's Rng in the same order as
+// GenerateNewMap, so a seed gives the same board on both sides.
+//
+// One record is exactly 64 bytes, a single cache line, because a step
+// touches nearly every field of the game it advances.
+//
+
+#define cnHopperSide cnBitboardSide
+#define cnHopperMaxEnemies 4
+
+typedef enum
+{
+  eHopperActionRotateUp = 0,    // up button, anti clockwise
+  eHopperActionRotateDown = 1,  // down button, clockwise
+  eHopperActionHop = 2,         // select button
+  eHopperActionCount = 3
+} EHopperAction;
+
+// Facings match EEntityDirectionFacing in main.c
+typedef enum
+{
+  eHopperFacingNE = 0,
+  eHopperFacingNW = 1,
+  eHopperFacingSE = 2,
+  eHopperFacingSW = 3
+} EHopperFacing;
+
+static const int c_nHopperScoreStep = 10;
+static const int c_nHopperScoreTreasure = 100;
+static const int c_nHopperScoreLandCreationPenalty = 100;
+
+struct HopperGame
+{
+  Bitboard m_nLand;
+  Bitboard m_nGems;
+
+  struct Rng m_rng;
+
+  int32_t m_nScore;
+  uint32_t m_nTicks;
+
+  uint8_t m_nPlayerX;
+  uint8_t m_nPlayerY;
+  uint8_t m_nPlayerFacing;
+  uint8_t m_nExitX;
+  uint8_t m_nExitY;
+  uint8_t m_fCanLevelBeExited;
+  uint8_t m_fGameOver;
+  uint8_t m_nNumberOfEnemies;
+
+  uint8_t m_vEnemyX[ cnHopperMaxEnemies ];
+  uint8_t m_vEnemyY[ cnHopperMaxEnemies ];
+  uint8_t m_vEnemyFacing[ cnHopperMaxEnemies ];
+
+  // Bumped each time the exit is taken and a new level dealt
+  uint16_t m_nLevelsCleared;
+};
+
+// Seed the game's Rng and deal the first level, score zero
+void HopperGameReset( struct HopperGame* pGame, uint64_t nSeed );
+
+// New level from the game's Rng, the score carries over
+void HopperGameGenerateLevel( struct HopperGame* pGame );
+
+// Apply the player action then one enemy tick. Returns the score change.
+int HopperGameStep( struct HopperGame* pGame, EHopperAction eAction );
+
+// The player half of a step on its own, returns the score change
+int HopperGamePlayerAction( struct HopperGame* pGame, EHopperAction eAction );
+
+// The enemy half of a step on its own
+void HopperGameTickEnemies( struct HopperGame* pGame );
+
+Bitboard HopperGameEnemyBits( const struct HopperGame* pGame );
+
+#endif // HOPPER_GAME_H
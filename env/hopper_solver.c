@@ -0,0 +1,680 @@
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hopper_solver.h"
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+// Root tasks are every action sequence this long, 81 of them, so the
+// threads stay busy even when a few subtrees are much bigger than the rest
+#define cnSolverSplitPlies 4
+
+#define cnSolverCells ( cnHopperSide * cnHopperSide )
+
+// Manhattan radius past which a ball covers the whole board
+#define cnSolverMaxRadius ( 2 * ( cnHopperSide - 1 ) )
+
+struct SolverEntry
+{
+  uint64_t m_nCheck;
+  uint64_t m_nData;
+};
+
+// Entry data : value in the low 32 bits, then remaining depth, whether
+// the value is exact or an upper bound, the best action and a valid bit
+#define cnEntryDepthShift 32
+#define cnEntryExactBit ( (uint64_t)1 << 40 )
+#define cnEntryActionShift 41
+#define cnEntryValidBit ( (uint64_t)1 << 43 )
+
+struct SolverThread
+{
+  struct HopperSolver* m_pSolver;
+  pthread_t m_thread;
+
+  uint64_t m_nNodes;
+  uint64_t m_nTableProbes;
+  uint64_t m_nTableHits;
+  uint64_t m_nCutoffs;
+};
+
+struct HopperSolver
+{
+  int m_nThreads;
+
+  struct SolverEntry* m_pTable;
+  uint64_t m_nTableMask;
+
+  struct SolverThread* m_pThreads;
+
+  // Set up for each pass
+  const struct HopperGame* m_pStart;
+  uint64_t m_nStartKey;
+  int m_nHorizon;
+  int m_nSplitPlies;
+  int m_nTasks;
+
+  // Shared between the threads during a pass
+  int m_nNextTask;
+  int m_nBestGain;
+};
+
+static pthread_once_t g_zobristOnce = PTHREAD_ONCE_INIT;
+
+static uint64_t g_vZobristPlayer[ cnSolverCells * 4 ];
+static uint64_t g_vZobristLand[ cnSolverCells ];
+static uint64_t g_vZobristGem[ cnSolverCells ];
+static uint64_t g_vZobristEnemy[ cnHopperMaxEnemies ][ cnSolverCells * 4 ];
+static uint64_t g_vZobristPly[ cnHopperSolveMaxHorizon + 1 ];
+static uint64_t g_nZobristCanExit;
+
+// Cells within each Manhattan distance of each cell
+static Bitboard g_vManhattanBall[ cnSolverCells ][ cnSolverMaxRadius + 1 ];
+
+// -------------------------------------------------------------------
+// Keys
+//
+
+static void InitTables()
+{
+  uint64_t nCounter = 0x486F70706572ull;
+
+  for( int i = 0 ; i < cnSolverCells * 4 ; ++i ) g_vZobristPlayer[ i ] = RngMix64( ++nCounter );
+  for( int i = 0 ; i < cnSolverCells ; ++i ) g_vZobristLand[ i ] = RngMix64( ++nCounter );
+  for( int i = 0 ; i < cnSolverCells ; ++i ) g_vZobristGem[ i ] = RngMix64( ++nCounter );
+
+  for( int nEnemy = 0 ; nEnemy < cnHopperMaxEnemies ; ++nEnemy )
+  {
+    for( int i = 0 ; i < cnSolverCells * 4 ; ++i ) g_vZobristEnemy[ nEnemy ][ i ] = RngMix64( ++nCounter );
+  }
+
+  for( int i = 0 ; i <= cnHopperSolveMaxHorizon ; ++i ) g_vZobristPly[ i ] = RngMix64( ++nCounter );
+
+  g_nZobristCanExit = RngMix64( ++nCounter );
+
+  for( int nCell = 0 ; nCell < cnSolverCells ; ++nCell )
+  {
+    Bitboard nBall = (Bitboard)1 << nCell;
+
+    for( int nRadius = 0 ; nRadius <= cnSolverMaxRadius ; ++nRadius )
+    {
+      g_vManhattanBall[ nCell ][ nRadius ] = nBall;
+      nBall |= BitboardNeighbours( nBall );
+    }
+  }
+}
+
+// Score isn't bounded, so hash its value rather than look it up
+static uint64_t ZobristScore( int32_t nScore )
+{
+  return RngMix64( 0x53636F7265ull ^ (uint64_t)(uint32_t)nScore );
+}
+
+static uint64_t ZobristPlayer( const struct HopperGame* pGame )
+{
+  return g_vZobristPlayer[ BitboardIndex( pGame->m_nPlayerX, pGame->m_nPlayerY ) * 4 + pGame->m_nPlayerFacing ];
+}
+
+static uint64_t ZobristEnemy( const struct HopperGame* pGame, int nEnemy )
+{
+  return g_vZobristEnemy[ nEnemy ][   BitboardIndex( pGame->m_vEnemyX[ nEnemy ], pGame->m_vEnemyY[ nEnemy ] ) * 4
+                                    + pGame->m_vEnemyFacing[ nEnemy ] ];
+}
+
+static uint64_t ZobristCells( const uint64_t* pnTable, Bitboard nCells )
+{
+  uint64_t nKey = 0;
+
+  while( nCells )
+  {
+    nKey ^= pnTable[ BitboardLowestIndex( nCells ) ];
+    nCells &= nCells - 1;
+  }
+
+  return nKey;
+}
+
+// The Rng state, folded to one word and mixed once
+static uint64_t ZobristRng( const struct HopperGame* pGame )
+{
+  const uint32_t* pnState = pGame->m_rng.m_nState;
+
+  return RngMix64(   ( ( (uint64_t)pnState[ 0 ] << 32 ) | pnState[ 1 ] )
+                   ^ ( ( ( (uint64_t)pnState[ 2 ] << 32 ) | pnState[ 3 ] ) * 0x9E3779B97F4A7C15ull ) );
+}
+
+static uint64_t ZobristKey( const struct HopperGame* pGame, int nPly )
+{
+  uint64_t nKey =   ZobristPlayer( pGame )
+                  ^ ZobristCells( g_vZobristLand, pGame->m_nLand )
+                  ^ ZobristCells( g_vZobristGem, pGame->m_nGems )
+                  ^ ZobristScore( pGame->m_nScore )
+                  ^ ZobristRng( pGame )
+                  ^ g_vZobristPly[ nPly ];
+
+  for( int nEnemy = 0 ; nEnemy < pGame->m_nNumberOfEnemies ; ++nEnemy )
+  {
+    nKey ^= ZobristEnemy( pGame, nEnemy );
+  }
+
+  if( pGame->m_fCanLevelBeExited )
+  {
+    nKey ^= g_nZobristCanExit;
+  }
+
+  return nKey;
+}
+
+// Key of pAfter from the key of pBefore, one ply on, touching only what
+// the step changed
+static uint64_t ZobristUpdate( uint64_t nKey, const struct HopperGame* pBefore, const struct HopperGame* pAfter, int nPly )
+{
+  nKey ^= g_vZobristPly[ nPly ] ^ g_vZobristPly[ nPly + 1 ];
+  nKey ^= ZobristRng( pBefore ) ^ ZobristRng( pAfter );
+
+  if(    pBefore->m_nPlayerX != pAfter->m_nPlayerX
+      || pBefore->m_nPlayerY != pAfter->m_nPlayerY
+      || pBefore->m_nPlayerFacing != pAfter->m_nPlayerFacing )
+  {
+    nKey ^= ZobristPlayer( pBefore ) ^ ZobristPlayer( pAfter );
+  }
+
+  nKey ^= ZobristCells( g_vZobristLand, pBefore->m_nLand ^ pAfter->m_nLand );
+  nKey ^= ZobristCells( g_vZobristGem, pBefore->m_nGems ^ pAfter->m_nGems );
+
+  if( pBefore->m_nScore != pAfter->m_nScore )
+  {
+    nKey ^= ZobristScore( pBefore->m_nScore ) ^ ZobristScore( pAfter->m_nScore );
+  }
+
+  for( int nEnemy = 0 ; nEnemy < pAfter->m_nNumberOfEnemies ; ++nEnemy )
+  {
+    if(    pBefore->m_vEnemyX[ nEnemy ] != pAfter->m_vEnemyX[ nEnemy ]
+        || pBefore->m_vEnemyY[ nEnemy ] != pAfter->m_vEnemyY[ nEnemy ]
+        || pBefore->m_vEnemyFacing[ nEnemy ] != pAfter->m_vEnemyFacing[ nEnemy ] )
+    {
+      nKey ^= ZobristEnemy( pBefore, nEnemy ) ^ ZobristEnemy( pAfter, nEnemy );
+    }
+  }
+
+  if( pBefore->m_fCanLevelBeExited != pAfter->m_fCanLevelBeExited )
+  {
+    nKey ^= g_nZobristCanExit;
+  }
+
+  return nKey;
+}
+
+// -------------------------------------------------------------------
+// Transposition table
+//
+
+static bool Probe( struct SolverThread* pThread, uint64_t nKey, uint64_t* pnData )
+{
+  struct SolverEntry* pEntry = &pThread->m_pSolver->m_pTable[ nKey & pThread->m_pSolver->m_nTableMask ];
+
+  uint64_t nCheck = __atomic_load_n( &pEntry->m_nCheck, __ATOMIC_RELAXED );
+  uint64_t nData = __atomic_load_n( &pEntry->m_nData, __ATOMIC_RELAXED );
+
+  ++pThread->m_nTableProbes;
+
+  if(    ! ( nData & cnEntryValidBit )
+      || ( nCheck ^ nData ) != nKey )
+  {
+    return false;
+  }
+
+  ++pThread->m_nTableHits;
+  *pnData = nData;
+
+  return true;
+}
+
+static void Store( struct SolverThread* pThread, uint64_t nKey, int nValue, int nDepth, bool fExact, int nAction )
+{
+  struct SolverEntry* pEntry = &pThread->m_pSolver->m_pTable[ nKey & pThread->m_pSolver->m_nTableMask ];
+
+  uint64_t nData =   (uint64_t)(uint32_t)nValue
+                   | (uint64_t)nDepth << cnEntryDepthShift
+                   | ( fExact ? cnEntryExactBit : 0 )
+                   | (uint64_t)nAction << cnEntryActionShift
+                   | cnEntryValidBit;
+
+  __atomic_store_n( &pEntry->m_nCheck, nKey ^ nData, __ATOMIC_RELAXED );
+  __atomic_store_n( &pEntry->m_nData, nData, __ATOMIC_RELAXED );
+}
+
+// -------------------------------------------------------------------
+// Search
+//
+
+// Most a game could still gain in nDepth actions : a step's score for
+// every action and a gem's for every gem close enough to reach
+static int UpperBound( const struct HopperGame* pGame, int nDepth )
+{
+  int nRadius = nDepth < cnSolverMaxRadius ? nDepth : cnSolverMaxRadius;
+  Bitboard nBall = g_vManhattanBall[ BitboardIndex( pGame->m_nPlayerX, pGame->m_nPlayerY ) ][ nRadius ];
+  int nGems = BitboardCount( pGame->m_nGems & nBall );
+
+  if( nGems > nDepth )
+  {
+    nGems = nDepth;
+  }
+
+  return nDepth * c_nHopperScoreStep + nGems * c_nHopperScoreTreasure;
+}
+
+// Player action and enemy tick, false once the level is over either way
+static bool Advance( struct HopperGame* pGame, EHopperAction eAction, int* pnReward )
+{
+  uint16_t nLevelsCleared = pGame->m_nLevelsCleared;
+
+  *pnReward = HopperGamePlayerAction( pGame, eAction );
+
+  if( pGame->m_nLevelsCleared != nLevelsCleared )
+  {
+    return false;
+  }
+
+  HopperGameTickEnemies( pGame );
+
+  return ! pGame->m_fGameOver;
+}
+
+// Best score still to gain from pGame in nDepth actions. Exact when it
+// comes back above nAlpha, otherwise only an upper bound.
+static int Search( struct SolverThread* pThread,
+                   const struct HopperGame* pGame,
+                   uint64_t nKey,
+                   int nPly,
+                   int nDepth,
+                   int nGain,
+                   int nAlpha )
+{
+  struct HopperSolver* pSolver = pThread->m_pSolver;
+
+  ++pThread->m_nNodes;
+
+  if( nDepth == 0 )
+  {
+    return 0;
+  }
+
+  // Another thread may have found a better line since we were called
+  int nShared = __atomic_load_n( &pSolver->m_nBestGain, __ATOMIC_RELAXED ) - nGain;
+
+  if( nShared > nAlpha )
+  {
+    nAlpha = nShared;
+  }
+
+  int nBound = UpperBound( pGame, nDepth );
+
+  if( nBound <= nAlpha )
+  {
+    ++pThread->m_nCutoffs;
+    return nBound;
+  }
+
+  uint64_t nData;
+  int nFirstAction = eHopperActionHop;
+
+  if( Probe( pThread, nKey, &nData ) )
+  {
+    int nValue = (int32_t)(uint32_t)nData;
+
+    if( (int)( ( nData >> cnEntryDepthShift ) & 0xFF ) == nDepth )
+    {
+      if(    ( nData & cnEntryExactBit )
+          || nValue <= nAlpha )
+      {
+        return nValue;
+      }
+    }
+
+    // Best move from a shallower pass, or a bound that wasn't enough
+    nFirstAction = (int)( ( nData >> cnEntryActionShift ) & 3 );
+  }
+
+  // Hop first, it's the only action that scores
+  int vOrder[ eHopperActionCount ] = { nFirstAction, eHopperActionHop, eHopperActionRotateUp };
+
+  if( nFirstAction == eHopperActionHop )
+  {
+    vOrder[ 1 ] = eHopperActionRotateUp;
+    vOrder[ 2 ] = eHopperActionRotateDown;
+  }
+  else
+  {
+    vOrder[ 2 ] = nFirstAction == eHopperActionRotateUp ? eHopperActionRotateDown : eHopperActionRotateUp;
+  }
+
+  int nBest = INT_MIN;
+  int nBestAction = vOrder[ 0 ];
+
+  for( int nOrder = 0 ; nOrder < eHopperActionCount ; ++nOrder )
+  {
+    struct HopperGame next = *pGame;
+    int nReward;
+    int nValue = 0;
+
+    if( Advance( &next, (EHopperAction)vOrder[ nOrder ], &nReward ) )
+    {
+      int nChildAlpha = ( nBest > nAlpha ? nBest : nAlpha ) - nReward;
+
+      nValue = Search( pThread,
+                       &next,
+                       ZobristUpdate( nKey, pGame, &next, nPly ),
+                       nPly + 1,
+                       nDepth - 1,
+                       nGain + nReward,
+                       nChildAlpha );
+    }
+
+    nValue += nReward;
+
+    if( nValue > nBest )
+    {
+      nBest = nValue;
+      nBestAction = vOrder[ nOrder ];
+    }
+  }
+
+  // Children may have cut against a best found meanwhile, so only call
+  // the value exact if it beats that too
+  nShared = __atomic_load_n( &pSolver->m_nBestGain, __ATOMIC_RELAXED ) - nGain;
+
+  if( nShared > nAlpha )
+  {
+    nAlpha = nShared;
+  }
+
+  Store( pThread, nKey, nBest, nDepth, nBest > nAlpha, nBestAction );
+
+  return nBest;
+}
+
+static void RaiseBestGain( struct HopperSolver* pSolver, int nGain )
+{
+  int nBest = __atomic_load_n( &pSolver->m_nBestGain, __ATOMIC_RELAXED );
+
+  while(    nGain > nBest
+         && ! __atomic_compare_exchange_n( &pSolver->m_nBestGain, &nBest, nGain, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+  {
+  }
+}
+
+// Root task n plays the actions given by the base 3 digits of n, then
+// searches the rest of the horizon from there
+static void RunTask( struct SolverThread* pThread, int nTask )
+{
+  struct HopperSolver* pSolver = pThread->m_pSolver;
+  struct HopperGame game = *pSolver->m_pStart;
+  uint64_t nKey = pSolver->m_nStartKey;
+  int nGain = 0;
+
+  for( int nPly = 0 ; nPly < pSolver->m_nSplitPlies ; ++nPly )
+  {
+    struct HopperGame before = game;
+    int nReward;
+
+    ++pThread->m_nNodes;
+
+    bool fPlaying = Advance( &game, (EHopperAction)( nTask % eHopperActionCount ), &nReward );
+
+    nTask /= eHopperActionCount;
+    nGain += nReward;
+
+    if( ! fPlaying )
+    {
+      RaiseBestGain( pSolver, nGain );
+      return;
+    }
+
+    nKey = ZobristUpdate( nKey, &before, &game, nPly );
+  }
+
+  int nAlpha = __atomic_load_n( &pSolver->m_nBestGain, __ATOMIC_RELAXED ) - nGain;
+
+  int nValue = Search( pThread,
+                       &game,
+                       nKey,
+                       pSolver->m_nSplitPlies,
+                       pSolver->m_nHorizon - pSolver->m_nSplitPlies,
+                       nGain,
+                       nAlpha );
+
+  if( nValue > nAlpha )
+  {
+    RaiseBestGain( pSolver, nGain + nValue );
+  }
+}
+
+static void* WorkerMain( void* pContext )
+{
+  struct SolverThread* pThread = (struct SolverThread*)pContext;
+  struct HopperSolver* pSolver = pThread->m_pSolver;
+
+  for( ;; )
+  {
+    int nTask = __atomic_fetch_add( &pSolver->m_nNextTask, 1, __ATOMIC_RELAXED );
+
+    if( nTask >= pSolver->m_nTasks )
+    {
+      return NULL;
+    }
+
+    RunTask( pThread, nTask );
+  }
+}
+
+// Walk the best line from the root, asking the table ( and searching
+// again where it has been overwritten ) which action keeps the best gain
+static void ExtractLine( struct HopperSolver* pSolver, struct HopperSolveResult* pResult )
+{
+  struct SolverThread* pThread = &pSolver->m_pThreads[ 0 ];
+  struct HopperGame game = *pSolver->m_pStart;
+  uint64_t nKey = pSolver->m_nStartKey;
+  int nTarget = pSolver->m_nBestGain;
+
+  // Nothing shared to cut against while walking
+  pSolver->m_nBestGain = INT_MIN / 2;
+
+  pResult->m_nLineLength = 0;
+  pResult->m_fLevelCleared = false;
+  pResult->m_fCaught = false;
+
+  for( int nPly = 0 ; nPly < pSolver->m_nHorizon ; ++nPly )
+  {
+    for( int nAction = eHopperActionCount - 1 ; nAction >= 0 ; --nAction )
+    {
+      struct HopperGame next = game;
+      int nReward;
+      int nValue = 0;
+
+      bool fPlaying = Advance( &next, (EHopperAction)nAction, &nReward );
+
+      if( fPlaying )
+      {
+        nValue = Search( pThread,
+                         &next,
+                         ZobristUpdate( nKey, &game, &next, nPly ),
+                         nPly + 1,
+                         pSolver->m_nHorizon - nPly - 1,
+                         0,
+                         nTarget - nReward - 1 );
+      }
+
+      if( nValue + nReward < nTarget )
+      {
+        continue;
+      }
+
+      pResult->m_vLine[ pResult->m_nLineLength++ ] = (uint8_t)nAction;
+      nTarget -= nReward;
+
+      if( ! fPlaying )
+      {
+        pResult->m_fLevelCleared = next.m_nLevelsCleared != game.m_nLevelsCleared;
+        pResult->m_fCaught = ! pResult->m_fLevelCleared;
+        return;
+      }
+
+      nKey = ZobristUpdate( nKey, &game, &next, nPly );
+      game = next;
+      break;
+    }
+  }
+}
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+static double NowSeconds()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+struct HopperSolver* HopperSolverCreate( int nTableBits, int nThreads )
+{
+  pthread_once( &g_zobristOnce, InitTables );
+
+  if( nThreads <= 0 )
+  {
+    nThreads = (int)sysconf( _SC_NPROCESSORS_ONLN );
+
+    if( nThreads < 1 )
+    {
+      nThreads = 1;
+    }
+  }
+
+  struct HopperSolver* pSolver = (struct HopperSolver*)calloc( 1, sizeof( struct HopperSolver ) );
+
+  if( ! pSolver )
+  {
+    return NULL;
+  }
+
+  pSolver->m_nThreads = nThreads;
+  pSolver->m_nTableMask = ( (uint64_t)1 << nTableBits ) - 1;
+  pSolver->m_pTable = (struct SolverEntry*)calloc( (size_t)1 << nTableBits, sizeof( struct SolverEntry ) );
+  pSolver->m_pThreads = (struct SolverThread*)calloc( (size_t)nThreads, sizeof( struct SolverThread ) );
+
+  if(    ! pSolver->m_pTable
+      || ! pSolver->m_pThreads )
+  {
+    HopperSolverDestroy( pSolver );
+    return NULL;
+  }
+
+  for( int nThread = 0 ; nThread < nThreads ; ++nThread )
+  {
+    pSolver->m_pThreads[ nThread ].m_pSolver = pSolver;
+  }
+
+  return pSolver;
+}
+
+void HopperSolverDestroy( struct HopperSolver* pSolver )
+{
+  if( pSolver )
+  {
+    free( pSolver->m_pTable );
+    free( pSolver->m_pThreads );
+    free( pSolver );
+  }
+}
+
+int HopperSolverThreadCount( const struct HopperSolver* pSolver )
+{
+  return pSolver->m_nThreads;
+}
+
+void HopperSolverRun( struct HopperSolver* pSolver,
+                      const struct HopperGame* pStart,
+                      int nHorizon,
+                      HopperSolvePassFn pfnPass,
+                      struct HopperSolveResult* pResult )
+{
+  if( nHorizon > cnHopperSolveMaxHorizon )
+  {
+    nHorizon = cnHopperSolveMaxHorizon;
+  }
+
+  pSolver->m_pStart = pStart;
+  pSolver->m_nStartKey = ZobristKey( pStart, 0 );
+
+  // Gain of the best line so far, every longer horizon can match it
+  int nBestGain = INT_MIN / 2;
+
+  for( int nPass = 1 ; nPass <= nHorizon ; ++nPass )
+  {
+    double fStart = NowSeconds();
+
+    pSolver->m_nHorizon = nPass;
+    pSolver->m_nSplitPlies = nPass < cnSolverSplitPlies ? nPass : cnSolverSplitPlies;
+    pSolver->m_nTasks = 1;
+
+    for( int nPly = 0 ; nPly < pSolver->m_nSplitPlies ; ++nPly )
+    {
+      pSolver->m_nTasks *= eHopperActionCount;
+    }
+
+    pSolver->m_nNextTask = 0;
+    pSolver->m_nBestGain = nBestGain - 1;
+
+    for( int nThread = 0 ; nThread < pSolver->m_nThreads ; ++nThread )
+    {
+      struct SolverThread* pThread = &pSolver->m_pThreads[ nThread ];
+
+      pThread->m_nNodes = 0;
+      pThread->m_nTableProbes = 0;
+      pThread->m_nTableHits = 0;
+      pThread->m_nCutoffs = 0;
+
+      pthread_create( &pThread->m_thread, NULL, WorkerMain, pThread );
+    }
+
+    for( int nThread = 0 ; nThread < pSolver->m_nThreads ; ++nThread )
+    {
+      pthread_join( pSolver->m_pThreads[ nThread ].m_thread, NULL );
+    }
+
+    nBestGain = pSolver->m_nBestGain;
+
+    ExtractLine( pSolver, pResult );
+
+    pResult->m_nHorizon = nPass;
+    pResult->m_nBestScore = pStart->m_nScore + nBestGain;
+    pResult->m_nNodes = 0;
+    pResult->m_nTableProbes = 0;
+    pResult->m_nTableHits = 0;
+    pResult->m_nCutoffs = 0;
+
+    for( int nThread = 0 ; nThread < pSolver->m_nThreads ; ++nThread )
+    {
+      const struct SolverThread* pThread = &pSolver->m_pThreads[ nThread ];
+
+      pResult->m_nNodes += pThread->m_nNodes;
+      pResult->m_nTableProbes += pThread->m_nTableProbes;
+      pResult->m_nTableHits += pThread->m_nTableHits;
+      pResult->m_nCutoffs += pThread->m_nCutoffs;
+    }
+
+    pResult->m_fSeconds = NowSeconds() - fStart;
+
+    if( pfnPass )
+    {
+      pfnPass( pResult );
+    }
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef HOPPER_SOLVER_H
+#define HOPPER_SOLVER_H
+
+#include "hopper_game.h"
+
+// -------------------------------------------------------------------
+// Best score search over HopperGame states
+//
+// Finds the highest score reachable on the current board within a
+// number of actions, with enemies moving exactly as they would in play
+// ( their Rng is part of the state ). The level counts as finished when
+// the exit is taken or the penguin is caught; the score then is final.
+//
+// Depth first branch and bound with iterative deepening on the number
+// of actions. Each pass starts from the previous pass's best score,
+// which the longer horizon can only match or beat, and tries the
+// previous pass's best action first. Subtrees are cut when even a hop
+// every action plus every gem within reach can't beat the best so far.
+//
+// Positions go in a fixed size transposition table shared by all
+// threads, keyed by Zobrist hashes updated from what each action
+// changed. The table is lockless : each slot stores key ^ data next to
+// data, so a slot torn by two writers fails its check and is a miss.
+//
+// The root's first few plies are split into tasks that a pool of
+// threads pull from, sharing the best score so far for cut offs.
+//
+
+#define cnHopperSolveMaxHorizon 48
+
+struct HopperSolveResult
+{
+  int m_nHorizon;
+
+  // Final score along the best line, and the line itself
+  int m_nBestScore;
+  int m_nLineLength;
+  uint8_t m_vLine[ cnHopperSolveMaxHorizon ];
+
+  bool m_fLevelCleared;
+  bool m_fCaught;
+
+  uint64_t m_nNodes;
+  uint64_t m_nTableProbes;
+  uint64_t m_nTableHits;
+  uint64_t m_nCutoffs;
+  double m_fSeconds;
+};
+
+struct HopperSolver;
+
+// 2^nTableBits slots of 16 bytes, nThreads of 0 uses every online core
+struct HopperSolver* HopperSolverCreate( int nTableBits, int nThreads );
+void HopperSolverDestroy( struct HopperSolver* pSolver );
+
+int HopperSolverThreadCount( const struct HopperSolver* pSolver );
+
+// Deepens one action at a time up to nHorizon. The result holds the
+// last pass, pfnPass if not NULL is called after every pass.
+typedef void ( *HopperSolvePassFn )( const struct HopperSolveResult* pResult );
+
+void HopperSolverRun( struct HopperSolver* pSolver,
+                      const struct HopperGame* pStart,
+                      int nHorizon,
+                      HopperSolvePassFn pfnPass,
+                      struct HopperSolveResult* pResult );
+
+#endif // HOPPER_SOLVER_H
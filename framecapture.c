@@ -0,0 +1,762 @@
+#include "framecapture.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+static const uint8_t c_vFrameCaptureMagic[ 4 ] = { 'H', 'C', 'A', 'P' };
+
+#define cnFrameCaptureOutBytes 256
+
+struct FrameCaptureState
+{
+  FrameCaptureWriteFn m_pfnWrite;
+  void* m_pContext;
+
+  // The last frame written and the one before it, packed rows
+  uint8_t m_vFrames[ 2 ][ cnFrameCaptureFrameBytes ];
+  int m_nLast;
+
+  // Frames written since the last keyframe, -1 before the first
+  int m_nSinceKeyframe;
+
+  // Rows changed in each tile, against each of the two frames
+  uint8_t m_vMasks[ 2 ][ cnFrameCaptureTiles ];
+
+  uint8_t m_vOut[ cnFrameCaptureOutBytes ];
+  int m_nOut;
+
+  // Bytes in the stream so far, written or still in m_vOut
+  uint32_t m_nOffset;
+
+  uint32_t m_nStartMs;
+  uint32_t m_nLastMs;
+
+  // Keyframes not yet in an index record
+  uint32_t m_vIndexFrames[ cnFrameCaptureIndexEntries ];
+  uint32_t m_vIndexOffsets[ cnFrameCaptureIndexEntries ];
+  int m_nIndexEntries;
+
+  // Offset of the last index record plus one, 0 for none yet
+  uint32_t m_nLastIndex;
+
+  bool m_fFailed;
+};
+
+static struct FrameCaptureState* g_pFrameCapture = NULL;
+
+static int g_nFrameCaptureFrames = 0;
+static int g_nFrameCaptureKeyframes = 0;
+
+// Size of the last stream once it has ended
+static int g_nFrameCaptureBytes = 0;
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+static void Flush( struct FrameCaptureState* pState )
+{
+  if(    pState->m_nOut > 0
+      && ! pState->m_fFailed )
+  {
+    pState->m_fFailed = ! pState->m_pfnWrite( pState->m_vOut, pState->m_nOut, pState->m_pContext );
+  }
+
+  pState->m_nOut = 0;
+}
+
+static void PutByte( struct FrameCaptureState* pState, uint8_t nByte )
+{
+  if( pState->m_nOut == cnFrameCaptureOutBytes )
+  {
+    Flush( pState );
+  }
+
+  pState->m_vOut[ pState->m_nOut++ ] = nByte;
+  ++pState->m_nOffset;
+}
+
+static void PutVarint( struct FrameCaptureState* pState, uint32_t nValue )
+{
+  while( nValue >= 0x80 )
+  {
+    PutByte( pState, (uint8_t)( nValue | 0x80 ) );
+    nValue >>= 7;
+  }
+
+  PutByte( pState, (uint8_t)nValue );
+}
+
+static void PutLE( struct FrameCaptureState* pState, uint32_t nValue, int nBytes )
+{
+  for( int nByte = 0 ; nByte < nBytes ; ++nByte )
+  {
+    PutByte( pState, (uint8_t)( nValue >> ( nByte * 8 ) ) );
+  }
+}
+
+static void PutIndex( struct FrameCaptureState* pState )
+{
+  uint32_t nOffset = pState->m_nOffset;
+
+  PutByte( pState, eFrameCaptureIndex );
+  PutVarint( pState, pState->m_nLastIndex );
+  PutVarint( pState, (uint32_t)pState->m_nIndexEntries );
+
+  for( int nEntry = 0 ; nEntry < pState->m_nIndexEntries ; ++nEntry )
+  {
+    PutVarint( pState, pState->m_vIndexFrames[ nEntry ] );
+    PutVarint( pState, pState->m_vIndexOffsets[ nEntry ] );
+  }
+
+  pState->m_nLastIndex = nOffset + 1;
+  pState->m_nIndexEntries = 0;
+}
+
+// Row mask of every tile against a reference frame, NULL for black. The
+// count of changed bytes says which reference is cheaper.
+static int TileMasks( const uint8_t* pRows, int nBytesPerRow, const uint8_t* pReference, uint8_t* pMasks )
+{
+  int nChanged = 0;
+
+  for( int nTileY = 0 ; nTileY < cnFrameCaptureTilesDown ; ++nTileY )
+  {
+    for( int nTileX = 0 ; nTileX < cnFrameCaptureTilesAcross ; ++nTileX )
+    {
+      uint8_t nMask = 0;
+
+      for( int nRow = 0 ; nRow < cnFrameCaptureTileSize ; ++nRow )
+      {
+        int y = nTileY * cnFrameCaptureTileSize + nRow;
+        uint8_t nNew = pRows[ y * nBytesPerRow + nTileX ];
+        uint8_t nOld = pReference ? pReference[ y * cnFrameCaptureRowBytes + nTileX ] : 0;
+
+        nMask |= (uint8_t)( ( nNew != nOld ) << nRow );
+      }
+
+      pMasks[ nTileY * cnFrameCaptureTilesAcross + nTileX ] = nMask;
+      nChanged += __builtin_popcount( nMask );
+    }
+  }
+
+  return nChanged;
+}
+
+bool FrameCaptureBegin( FrameCaptureWriteFn pfnWrite, void* pContext )
+{
+  FrameCaptureEnd();
+
+  struct FrameCaptureState* pState = malloc( sizeof( struct FrameCaptureState ) );
+
+  if( ! pState )
+  {
+    return false;
+  }
+
+  memset( pState, 0, sizeof( struct FrameCaptureState ) );
+
+  pState->m_pfnWrite = pfnWrite;
+  pState->m_pContext = pContext;
+  pState->m_nSinceKeyframe = -1;
+
+  g_pFrameCapture = pState;
+  g_nFrameCaptureFrames = 0;
+  g_nFrameCaptureKeyframes = 0;
+
+  for( int nByte = 0 ; nByte < 4 ; ++nByte )
+  {
+    PutByte( pState, c_vFrameCaptureMagic[ nByte ] );
+  }
+
+  PutByte( pState, cnFrameCaptureVersion );
+  PutByte( pState, cnFrameCaptureTileSize );
+  PutLE( pState, cnFrameCaptureWidth, 2 );
+  PutLE( pState, cnFrameCaptureHeight, 2 );
+  PutLE( pState, cnFrameCaptureKeyframeInterval, 2 );
+
+  return true;
+}
+
+void FrameCaptureEnd()
+{
+  struct FrameCaptureState* pState = g_pFrameCapture;
+
+  if( ! pState )
+  {
+    return;
+  }
+
+  if( pState->m_nIndexEntries > 0 )
+  {
+    PutIndex( pState );
+  }
+
+  PutByte( pState, eFrameCaptureTrailer );
+  PutLE( pState, pState->m_nLastIndex ? pState->m_nLastIndex - 1 : 0xFFFFFFFFu, 4 );
+
+  for( int nByte = 0 ; nByte < 4 ; ++nByte )
+  {
+    PutByte( pState, c_vFrameCaptureMagic[ nByte ] );
+  }
+
+  Flush( pState );
+
+  g_nFrameCaptureBytes = (int)pState->m_nOffset;
+
+  free( pState );
+  g_pFrameCapture = NULL;
+}
+
+bool FrameCaptureActive()
+{
+  return g_pFrameCapture != NULL;
+}
+
+void FrameCaptureFrame( const uint8_t* pRows, int nBytesPerRow, uint32_t nTimeMs )
+{
+  struct FrameCaptureState* pState = g_pFrameCapture;
+
+  if(    ! pState
+      || pState->m_fFailed )
+  {
+    return;
+  }
+
+  uint8_t* pLast = pState->m_vFrames[ pState->m_nLast ];
+  uint8_t* pBefore = pState->m_vFrames[ pState->m_nLast ^ 1 ];
+
+  EFrameCaptureRecord eKind = eFrameCaptureKeyframe;
+  const uint8_t* pMasks = pState->m_vMasks[ 0 ];
+
+  if(    pState->m_nSinceKeyframe < 0
+      || pState->m_nSinceKeyframe + 1 >= cnFrameCaptureKeyframeInterval )
+  {
+    TileMasks( pRows, nBytesPerRow, NULL, pState->m_vMasks[ 0 ] );
+  }
+  else
+  {
+    // Against the frame before unless the one before that is closer,
+    // which it is for every idle frame, and never past a keyframe
+    int nChanged = TileMasks( pRows, nBytesPerRow, pLast, pState->m_vMasks[ 0 ] );
+
+    eKind = eFrameCaptureDelta;
+
+    if(    nChanged > 0
+        && pState->m_nSinceKeyframe >= 1
+        && TileMasks( pRows, nBytesPerRow, pBefore, pState->m_vMasks[ 1 ] ) < nChanged )
+    {
+      eKind = eFrameCaptureDeltaTwoBack;
+      pMasks = pState->m_vMasks[ 1 ];
+    }
+  }
+
+  if( eKind == eFrameCaptureKeyframe )
+  {
+    if( pState->m_nSinceKeyframe < 0 )
+    {
+      pState->m_nStartMs = nTimeMs;
+    }
+
+    pState->m_vIndexFrames[ pState->m_nIndexEntries ] = (uint32_t)g_nFrameCaptureFrames;
+    pState->m_vIndexOffsets[ pState->m_nIndexEntries ] = pState->m_nOffset;
+    ++pState->m_nIndexEntries;
+
+    PutByte( pState, eKind );
+    PutVarint( pState, nTimeMs - pState->m_nStartMs );
+
+    pState->m_nSinceKeyframe = 0;
+    ++g_nFrameCaptureKeyframes;
+  }
+  else
+  {
+    PutByte( pState, eKind );
+    PutVarint( pState, nTimeMs - pState->m_nLastMs );
+
+    ++pState->m_nSinceKeyframe;
+  }
+
+  pState->m_nLastMs = nTimeMs;
+
+  // Runs of changed tiles
+  int nTile = 0;
+  int nRunEnd = 0;
+
+  while( nTile < cnFrameCaptureTiles )
+  {
+    if( ! pMasks[ nTile ] )
+    {
+      ++nTile;
+      continue;
+    }
+
+    int nRunStart = nTile;
+
+    while(    nTile < cnFrameCaptureTiles
+           && pMasks[ nTile ] )
+    {
+      ++nTile;
+    }
+
+    PutVarint( pState, (uint32_t)( nRunStart - nRunEnd ) );
+    PutVarint( pState, (uint32_t)( nTile - nRunStart ) );
+
+    for( int nRunTile = nRunStart ; nRunTile < nTile ; ++nRunTile )
+    {
+      int nTileX = nRunTile % cnFrameCaptureTilesAcross;
+      int nTileY = nRunTile / cnFrameCaptureTilesAcross;
+      uint8_t nMask = pMasks[ nRunTile ];
+
+      PutByte( pState, nMask );
+
+      for( int nRow = 0 ; nRow < cnFrameCaptureTileSize ; ++nRow )
+      {
+        if( nMask & ( 1 << nRow ) )
+        {
+          PutByte( pState, pRows[ ( nTileY * cnFrameCaptureTileSize + nRow ) * nBytesPerRow + nTileX ] );
+        }
+      }
+    }
+
+    nRunEnd = nTile;
+  }
+
+  PutVarint( pState, 0 );
+  PutVarint( pState, 0 );
+
+  // This frame becomes the last one, the last one the one before
+  pState->m_nLast ^= 1;
+
+  for( int y = 0 ; y < cnFrameCaptureHeight ; ++y )
+  {
+    memcpy( &pBefore[ y * cnFrameCaptureRowBytes ], &pRows[ y * nBytesPerRow ], cnFrameCaptureRowBytes );
+  }
+
+  ++g_nFrameCaptureFrames;
+
+  if( pState->m_nIndexEntries == cnFrameCaptureIndexEntries )
+  {
+    PutIndex( pState );
+  }
+
+  // Whatever this frame made goes out now, not some frames later
+  Flush( pState );
+}
+
+int FrameCaptureFrames()
+{
+  return g_nFrameCaptureFrames;
+}
+
+int FrameCaptureKeyframes()
+{
+  return g_nFrameCaptureKeyframes;
+}
+
+int FrameCaptureBytes()
+{
+  return g_pFrameCapture ? (int)g_pFrameCapture->m_nOffset : g_nFrameCaptureBytes;
+}
+
+// -------------------------------------------------------------------
+// Reading
+//
+
+// Where a read is up to, so a scan doesn't need a whole reader
+struct FrameCaptureCursor
+{
+  const uint8_t* m_pData;
+  size_t m_nBytes;
+  size_t m_nPos;
+};
+
+static struct FrameCaptureCursor CursorAt( const struct FrameCaptureReader* pReader, size_t nPos )
+{
+  struct FrameCaptureCursor cursor = { pReader->m_pData, pReader->m_nBytes, nPos };
+
+  return cursor;
+}
+
+static bool GetByte( struct FrameCaptureCursor* pCursor, uint8_t* pnByte )
+{
+  if( pCursor->m_nPos >= pCursor->m_nBytes )
+  {
+    return false;
+  }
+
+  *pnByte = pCursor->m_pData[ pCursor->m_nPos++ ];
+
+  return true;
+}
+
+static bool GetVarint( struct FrameCaptureCursor* pCursor, uint32_t* pnValue )
+{
+  uint32_t nValue = 0;
+
+  for( int nShift = 0 ; nShift < 35 ; nShift += 7 )
+  {
+    uint8_t nByte;
+
+    if( ! GetByte( pCursor, &nByte ) )
+    {
+      return false;
+    }
+
+    nValue |= (uint32_t)( nByte & 0x7F ) << nShift;
+
+    if( ! ( nByte & 0x80 ) )
+    {
+      *pnValue = nValue;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static uint32_t ReadLE( const uint8_t* pIn, int nBytes )
+{
+  uint32_t nValue = 0;
+
+  for( int nByte = 0 ; nByte < nBytes ; ++nByte )
+  {
+    nValue |= (uint32_t)pIn[ nByte ] << ( nByte * 8 );
+  }
+
+  return nValue;
+}
+
+// Applies the runs of a frame record to pFrame, or just steps over them
+// when pFrame is NULL
+static bool ReadRuns( struct FrameCaptureCursor* pCursor, uint8_t* pFrame )
+{
+  int nTile = 0;
+
+  for( ;; )
+  {
+    uint32_t nSkip;
+    uint32_t nCount;
+
+    if(    ! GetVarint( pCursor, &nSkip )
+        || ! GetVarint( pCursor, &nCount ) )
+    {
+      return false;
+    }
+
+    if( nCount == 0 )
+    {
+      return true;
+    }
+
+    if(    nSkip > (uint32_t)( cnFrameCaptureTiles - nTile )
+        || nCount > (uint32_t)( cnFrameCaptureTiles - nTile ) - nSkip )
+    {
+      return false;
+    }
+
+    nTile += (int)nSkip;
+
+    for( uint32_t nRunTile = 0 ; nRunTile < nCount ; ++nRunTile, ++nTile )
+    {
+      int nTileX = nTile % cnFrameCaptureTilesAcross;
+      int nTileY = nTile / cnFrameCaptureTilesAcross;
+      uint8_t nMask;
+
+      if( ! GetByte( pCursor, &nMask ) )
+      {
+        return false;
+      }
+
+      for( int nRow = 0 ; nRow < cnFrameCaptureTileSize ; ++nRow )
+      {
+        uint8_t nByte;
+
+        if( ! ( nMask & ( 1 << nRow ) ) )
+        {
+          continue;
+        }
+
+        if( ! GetByte( pCursor, &nByte ) )
+        {
+          return false;
+        }
+
+        if( pFrame )
+        {
+          pFrame[ ( nTileY * cnFrameCaptureTileSize + nRow ) * cnFrameCaptureRowBytes + nTileX ] = nByte;
+        }
+      }
+    }
+  }
+}
+
+// Steps over any index records to the kind byte of the next frame,
+// *pnOffset is where that frame's record starts
+static bool GetFrameKind( struct FrameCaptureCursor* pCursor, uint8_t* pnKind, size_t* pnOffset )
+{
+  for( ;; )
+  {
+    *pnOffset = pCursor->m_nPos;
+
+    if( ! GetByte( pCursor, pnKind ) )
+    {
+      return false;
+    }
+
+    if( *pnKind != eFrameCaptureIndex )
+    {
+      return true;
+    }
+
+    uint32_t nPrevious;
+    uint32_t nEntries;
+
+    if(    ! GetVarint( pCursor, &nPrevious )
+        || ! GetVarint( pCursor, &nEntries ) )
+    {
+      return false;
+    }
+
+    for( uint32_t nValue = 0 ; nValue < nEntries * 2 ; ++nValue )
+    {
+      uint32_t nIgnored;
+
+      if( ! GetVarint( pCursor, &nIgnored ) )
+      {
+        return false;
+      }
+    }
+  }
+}
+
+bool FrameCaptureReaderOpen( struct FrameCaptureReader* pReader, const uint8_t* pData, size_t nBytes )
+{
+  if(    nBytes < cnFrameCaptureHeaderBytes
+      || memcmp( pData, c_vFrameCaptureMagic, 4 ) != 0
+      || pData[ 4 ] != cnFrameCaptureVersion
+      || pData[ 5 ] != cnFrameCaptureTileSize
+      || ReadLE( &pData[ 6 ], 2 ) != cnFrameCaptureWidth
+      || ReadLE( &pData[ 8 ], 2 ) != cnFrameCaptureHeight )
+  {
+    return false;
+  }
+
+  memset( pReader, 0, sizeof( struct FrameCaptureReader ) );
+
+  pReader->m_pData = pData;
+  pReader->m_nBytes = nBytes;
+  pReader->m_nPos = cnFrameCaptureHeaderBytes;
+  pReader->m_nKeyframeInterval = (uint16_t)ReadLE( &pData[ 10 ], 2 );
+  pReader->m_nSinceKeyframe = -1;
+
+  // A finished stream ends in a trailer, which is kept out of the way
+  // of the frames
+  if( nBytes >= cnFrameCaptureHeaderBytes + cnFrameCaptureTrailerBytes )
+  {
+    const uint8_t* pTrailer = &pData[ nBytes - cnFrameCaptureTrailerBytes ];
+
+    pReader->m_fIndexed =    pTrailer[ 0 ] == eFrameCaptureTrailer
+                          && memcmp( &pTrailer[ 5 ], c_vFrameCaptureMagic, 4 ) == 0;
+  }
+
+  if( pReader->m_fIndexed )
+  {
+    pReader->m_nBytes -= cnFrameCaptureTrailerBytes;
+  }
+
+  return true;
+}
+
+bool FrameCaptureReaderNext( struct FrameCaptureReader* pReader, const uint8_t** ppFrame )
+{
+  struct FrameCaptureCursor cursor = CursorAt( pReader, pReader->m_nPos );
+  uint8_t nKind;
+  size_t nOffset;
+  uint32_t nMs;
+
+  if( ! GetFrameKind( &cursor, &nKind, &nOffset ) )
+  {
+    // Past any index records at the very end is the end of the stream
+    if( nOffset == pReader->m_nBytes )
+    {
+      pReader->m_nPos = nOffset;
+    }
+
+    return false;
+  }
+
+  if( ! GetVarint( &cursor, &nMs ) )
+  {
+    return false;
+  }
+
+  uint8_t* pLast = pReader->m_vFrames[ pReader->m_nLast ];
+  uint8_t* pNext = pReader->m_vFrames[ pReader->m_nLast ^ 1 ];
+
+  // The frame before last is where the new one goes, so an 'E' frame is
+  // patched in place
+  switch( nKind )
+  {
+    case eFrameCaptureKeyframe:
+      memset( pNext, 0, cnFrameCaptureFrameBytes );
+      pReader->m_nTimeMs = nMs;
+      pReader->m_nSinceKeyframe = 0;
+      break;
+
+    case eFrameCaptureDelta:
+      if( pReader->m_nSinceKeyframe < 0 )
+      {
+        return false;
+      }
+
+      memcpy( pNext, pLast, cnFrameCaptureFrameBytes );
+      pReader->m_nTimeMs += nMs;
+      ++pReader->m_nSinceKeyframe;
+      break;
+
+    case eFrameCaptureDeltaTwoBack:
+      if( pReader->m_nSinceKeyframe < 1 )
+      {
+        return false;
+      }
+
+      pReader->m_nTimeMs += nMs;
+      ++pReader->m_nSinceKeyframe;
+      break;
+
+    default:
+      return false;
+  }
+
+  if( ! ReadRuns( &cursor, pNext ) )
+  {
+    return false;
+  }
+
+  pReader->m_nPos = cursor.m_nPos;
+  pReader->m_nLast ^= 1;
+  ++pReader->m_nFrame;
+
+  *ppFrame = pNext;
+
+  return true;
+}
+
+bool FrameCaptureReaderSeek( struct FrameCaptureReader* pReader, uint32_t nFrame )
+{
+  bool fFound = false;
+  uint32_t nBestFrame = 0;
+  size_t nBestOffset = 0;
+
+  if( pReader->m_fIndexed )
+  {
+    // Back along the chain of index records from the trailer
+    uint32_t nIndex = ReadLE( &pReader->m_pData[ pReader->m_nBytes + 1 ], 4 );
+
+    while( nIndex < pReader->m_nBytes )
+    {
+      struct FrameCaptureCursor cursor = CursorAt( pReader, nIndex );
+      uint8_t nKind;
+      uint32_t nPrevious;
+      uint32_t nEntries;
+
+      if(    ! GetByte( &cursor, &nKind )
+          || nKind != eFrameCaptureIndex
+          || ! GetVarint( &cursor, &nPrevious )
+          || ! GetVarint( &cursor, &nEntries ) )
+      {
+        return false;
+      }
+
+      for( uint32_t nEntry = 0 ; nEntry < nEntries ; ++nEntry )
+      {
+        uint32_t nEntryFrame;
+        uint32_t nEntryOffset;
+
+        if(    ! GetVarint( &cursor, &nEntryFrame )
+            || ! GetVarint( &cursor, &nEntryOffset ) )
+        {
+          return false;
+        }
+
+        if(    nEntryFrame <= nFrame
+            && ( ! fFound || nEntryFrame > nBestFrame ) )
+        {
+          fFound = true;
+          nBestFrame = nEntryFrame;
+          nBestOffset = nEntryOffset;
+        }
+      }
+
+      // Records only ever point back, anything else ends the chain
+      if(    nPrevious == 0
+          || nPrevious - 1 >= nIndex )
+      {
+        break;
+      }
+
+      nIndex = nPrevious - 1;
+    }
+  }
+  else
+  {
+    // No index, step over the records from the front
+    struct FrameCaptureCursor cursor = CursorAt( pReader, cnFrameCaptureHeaderBytes );
+    uint8_t nKind;
+    size_t nOffset;
+    uint32_t nMs;
+
+    for( uint32_t nWalkFrame = 0 ; nWalkFrame <= nFrame ; ++nWalkFrame )
+    {
+      if( ! GetFrameKind( &cursor, &nKind, &nOffset ) )
+      {
+        break;
+      }
+
+      if( nKind == eFrameCaptureKeyframe )
+      {
+        fFound = true;
+        nBestFrame = nWalkFrame;
+        nBestOffset = nOffset;
+      }
+
+      if(    ! GetVarint( &cursor, &nMs )
+          || ! ReadRuns( &cursor, NULL ) )
+      {
+        break;
+      }
+    }
+  }
+
+  if( ! fFound )
+  {
+    return false;
+  }
+
+  pReader->m_nPos = nBestOffset;
+  pReader->m_nFrame = nBestFrame;
+  pReader->m_nSinceKeyframe = -1;
+
+  return true;
+}
+
+uint32_t FrameCaptureReaderCount( const struct FrameCaptureReader* pReader )
+{
+  struct FrameCaptureCursor cursor = CursorAt( pReader, cnFrameCaptureHeaderBytes );
+  uint32_t nFrames = 0;
+  uint8_t nKind;
+  size_t nOffset;
+  uint32_t nMs;
+
+  while(    GetFrameKind( &cursor, &nKind, &nOffset )
+         && GetVarint( &cursor, &nMs )
+         && ReadRuns( &cursor, NULL ) )
+  {
+    ++nFrames;
+  }
+
+  return nFrames;
+}
@@ -0,0 +1,141 @@
+#ifndef HOPPER_FRAMECAPTURE_H
+#define HOPPER_FRAMECAPTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// -------------------------------------------------------------------
+// Frame capture stream
+//
+// Every frame shown, as 8 x 8 pixel tiles that changed against a frame
+// already in the stream. Frames are 144 x 168 1-bit, 18 bytes a row, bit
+// x % 8 of a byte is pixel x, 1 is white, as in the framebuffer less its
+// row padding. Numbers are little endian, "varint" is 7 bits a byte low
+// first with the top bit set on all but the last.
+//
+//   header, cnFrameCaptureHeaderBytes
+//     0  magic "HCAP"
+//     4  uint8 version
+//     5  uint8 tile size
+//     6  uint16 width, uint16 height
+//     10 uint16 keyframe interval
+//
+//   frame records
+//     uint8 kind, 'K' keyframe, 'D' against the frame before,
+//       'E' against the one before that
+//     varint ms since the frame before, or for a keyframe since the
+//       capture began
+//     runs of changed tiles, tiles numbered across then down :
+//       varint tiles skipped since the last run, varint run length,
+//       then per tile a uint8 mask of its rows that changed and the new
+//       byte for each. A run length of 0 ends the frame.
+//
+//   A keyframe is against a black frame, so its runs are every tile
+//   with anything white in it. An 'E' frame only ever looks back as
+//   far as the last keyframe, and decoding can start at any keyframe.
+//
+//   index records, one every cnFrameCaptureIndexEntries keyframes
+//     uint8 'I'
+//     varint offset of the index record before plus one, 0 for none
+//     varint entry count, then varint frame number and varint offset
+//       of the keyframe for each
+//
+//   trailer, cnFrameCaptureTrailerBytes, at the very end
+//     uint8 'T', uint32 offset of the last index record, magic "HCAP"
+//
+// A stream cut short has no trailer and is read from the front.
+//
+
+#define cnFrameCaptureVersion 1
+#define cnFrameCaptureHeaderBytes 12
+#define cnFrameCaptureTrailerBytes 9
+
+#define cnFrameCaptureWidth 144
+#define cnFrameCaptureHeight 168
+#define cnFrameCaptureRowBytes ( cnFrameCaptureWidth / 8 )
+#define cnFrameCaptureFrameBytes ( cnFrameCaptureRowBytes * cnFrameCaptureHeight )
+
+#define cnFrameCaptureTileSize 8
+#define cnFrameCaptureTilesAcross ( cnFrameCaptureWidth / cnFrameCaptureTileSize )
+#define cnFrameCaptureTilesDown ( cnFrameCaptureHeight / cnFrameCaptureTileSize )
+#define cnFrameCaptureTiles ( cnFrameCaptureTilesAcross * cnFrameCaptureTilesDown )
+
+#define cnFrameCaptureKeyframeInterval 256
+#define cnFrameCaptureIndexEntries 32
+
+typedef enum
+{
+  eFrameCaptureKeyframe = 'K',
+  eFrameCaptureDelta = 'D',
+  eFrameCaptureDeltaTwoBack = 'E',
+  eFrameCaptureIndex = 'I',
+  eFrameCaptureTrailer = 'T'
+} EFrameCaptureRecord;
+
+// -------------------------------------------------------------------
+// Writing
+//
+// Bytes go out through the write function in small pieces as they're
+// made. If it ever returns false the capture stops there, what was
+// written still reads as a stream cut short.
+//
+
+typedef bool ( *FrameCaptureWriteFn )( const uint8_t* pData, int nBytes, void* pContext );
+
+// Allocates the two reference frames and the rest, about 7k. False if
+// there wasn't the memory.
+bool FrameCaptureBegin( FrameCaptureWriteFn pfnWrite, void* pContext );
+
+// Writes the last index and the trailer and frees everything
+void FrameCaptureEnd();
+
+bool FrameCaptureActive();
+
+// Adds a frame laid out as the framebuffer, nBytesPerRow apart, shown
+// at nTimeMs on any clock that only goes forward
+void FrameCaptureFrame( const uint8_t* pRows, int nBytesPerRow, uint32_t nTimeMs );
+
+// Of the stream being written, or the last one once it has ended
+int FrameCaptureFrames();
+int FrameCaptureKeyframes();
+int FrameCaptureBytes();
+
+// -------------------------------------------------------------------
+// Reading, a whole stream in memory
+//
+
+struct FrameCaptureReader
+{
+  const uint8_t* m_pData;
+  size_t m_nBytes;
+  size_t m_nPos;
+
+  uint16_t m_nKeyframeInterval;
+  bool m_fIndexed;
+
+  // Number of the next frame to be read and the time of the last one
+  uint32_t m_nFrame;
+  uint32_t m_nTimeMs;
+
+  // The last frame read and the one before it
+  uint8_t m_vFrames[ 2 ][ cnFrameCaptureFrameBytes ];
+  int m_nLast;
+  int m_nSinceKeyframe;
+};
+
+// False if this isn't a stream this code can read
+bool FrameCaptureReaderOpen( struct FrameCaptureReader* pReader, const uint8_t* pData, size_t nBytes );
+
+// Decodes the next frame, *ppFrame is valid until the one after. False
+// at the end of the stream or on a record that doesn't make sense.
+bool FrameCaptureReaderNext( struct FrameCaptureReader* pReader, const uint8_t** ppFrame );
+
+// Moves to the keyframe at or before nFrame, through the index when the
+// stream has one. Reading on from there gets to nFrame.
+bool FrameCaptureReaderSeek( struct FrameCaptureReader* pReader, uint32_t nFrame );
+
+// Frames in the whole stream, read from the front
+uint32_t FrameCaptureReaderCount( const struct FrameCaptureReader* pReader );
+
+#endif // HOPPER_FRAMECAPTURE_H
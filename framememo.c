@@ -0,0 +1,220 @@
+#include "framememo.h"
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+#define cnFrameMemoSlots 2
+
+// A whole 144 x 168 1-bit screen, rows padded to 32 bits
+#define cnFrameMemoBytes ( 20 * 168 )
+
+struct FrameMemoSlot
+{
+  bool m_fValid;
+  uint64_t m_nKey;
+  uint32_t m_nLastUsed;
+
+  // Layout of the framebuffer it was taken from
+  uint16_t m_nBytesPerRow;
+  int16_t m_nRows;
+
+  uint8_t m_vData[ cnFrameMemoBytes ];
+};
+
+static struct FrameMemoSlot g_vFrameMemoSlots[ cnFrameMemoSlots ];
+static uint32_t g_nFrameMemoUses = 0;
+static bool g_fFrameMemoEnabled = true;
+
+static int g_nFrameMemoHits = 0;
+static int g_nFrameMemoMisses = 0;
+
+// Totals for the averages, only whole ms on the watch so there's no
+// point timing a single frame
+static uint32_t g_nFrameMemoHitMs = 0;
+static uint32_t g_nFrameMemoMissMs = 0;
+static uint32_t g_nFrameMemoMissStartMs = 0;
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+static uint32_t NowMs()
+{
+  time_t nSeconds;
+  uint16_t nMs;
+
+  time_ms( &nSeconds, &nMs );
+
+  // Wraps every 49 days, only ever used for differences
+  return (uint32_t)nSeconds * 1000u + nMs;
+}
+
+static struct FrameMemoSlot* FindSlot( uint64_t nKey )
+{
+  for( int nSlot = 0 ; nSlot < cnFrameMemoSlots ; ++nSlot )
+  {
+    if(    g_vFrameMemoSlots[ nSlot ].m_fValid
+        && g_vFrameMemoSlots[ nSlot ].m_nKey == nKey )
+    {
+      return &g_vFrameMemoSlots[ nSlot ];
+    }
+  }
+
+  return NULL;
+}
+
+static struct FrameMemoSlot* SlotToReplace()
+{
+  struct FrameMemoSlot* pOldest = &g_vFrameMemoSlots[ 0 ];
+
+  for( int nSlot = 0 ; nSlot < cnFrameMemoSlots ; ++nSlot )
+  {
+    struct FrameMemoSlot* pSlot = &g_vFrameMemoSlots[ nSlot ];
+
+    if( ! pSlot->m_fValid )
+    {
+      return pSlot;
+    }
+
+    if( pSlot->m_nLastUsed < pOldest->m_nLastUsed )
+    {
+      pOldest = pSlot;
+    }
+  }
+
+  return pOldest;
+}
+
+void FrameMemoSetEnabled( bool fEnabled )
+{
+  g_fFrameMemoEnabled = fEnabled;
+
+  FrameMemoInvalidate();
+}
+
+void FrameMemoInvalidate()
+{
+  for( int nSlot = 0 ; nSlot < cnFrameMemoSlots ; ++nSlot )
+  {
+    g_vFrameMemoSlots[ nSlot ].m_fValid = false;
+  }
+}
+
+bool FrameMemoRestore( GContext* ctx, uint64_t nKey )
+{
+  uint32_t nStartMs = NowMs();
+
+  struct FrameMemoSlot* pSlot = g_fFrameMemoEnabled ? FindSlot( nKey ) : NULL;
+  GBitmap* pFramebuffer = pSlot ? graphics_capture_frame_buffer( ctx ) : NULL;
+
+  if( pFramebuffer )
+  {
+    uint8_t* pData = gbitmap_get_data( pFramebuffer );
+    uint16_t nBytesPerRow = gbitmap_get_bytes_per_row( pFramebuffer );
+    GRect bounds = gbitmap_get_bounds( pFramebuffer );
+
+    bool fSameLayout =    nBytesPerRow == pSlot->m_nBytesPerRow
+                       && bounds.size.h == pSlot->m_nRows;
+
+    if( fSameLayout )
+    {
+      memcpy( pData, pSlot->m_vData, (size_t)nBytesPerRow * (size_t)bounds.size.h );
+    }
+
+    graphics_release_frame_buffer( ctx, pFramebuffer );
+
+    if( fSameLayout )
+    {
+      pSlot->m_nLastUsed = ++g_nFrameMemoUses;
+
+      ++g_nFrameMemoHits;
+      g_nFrameMemoHitMs += NowMs() - nStartMs;
+
+      return true;
+    }
+  }
+
+  ++g_nFrameMemoMisses;
+  g_nFrameMemoMissStartMs = nStartMs;
+
+  return false;
+}
+
+void FrameMemoStore( GContext* ctx, uint64_t nKey )
+{
+  g_nFrameMemoMissMs += NowMs() - g_nFrameMemoMissStartMs;
+
+  if( ! g_fFrameMemoEnabled )
+  {
+    return;
+  }
+
+  GBitmap* pFramebuffer = graphics_capture_frame_buffer( ctx );
+
+  if( ! pFramebuffer )
+  {
+    return;
+  }
+
+  uint16_t nBytesPerRow = gbitmap_get_bytes_per_row( pFramebuffer );
+  GRect bounds = gbitmap_get_bounds( pFramebuffer );
+  size_t nBytes = (size_t)nBytesPerRow * (size_t)bounds.size.h;
+
+  // Anything bigger than the screen we know just isn't kept
+  if( nBytes <= cnFrameMemoBytes )
+  {
+    struct FrameMemoSlot* pSlot = FindSlot( nKey );
+
+    if( ! pSlot )
+    {
+      pSlot = SlotToReplace();
+    }
+
+    memcpy( pSlot->m_vData, gbitmap_get_data( pFramebuffer ), nBytes );
+
+    pSlot->m_fValid = true;
+    pSlot->m_nKey = nKey;
+    pSlot->m_nLastUsed = ++g_nFrameMemoUses;
+    pSlot->m_nBytesPerRow = nBytesPerRow;
+    pSlot->m_nRows = bounds.size.h;
+  }
+
+  graphics_release_frame_buffer( ctx, pFramebuffer );
+}
+
+int FrameMemoHits()
+{
+  return g_nFrameMemoHits;
+}
+
+int FrameMemoMisses()
+{
+  return g_nFrameMemoMisses;
+}
+
+int FrameMemoSavedUsPerIdleSecond()
+{
+  if(    g_nFrameMemoHits == 0
+      || g_nFrameMemoMisses == 0 )
+  {
+    return 0;
+  }
+
+  int nMissUs = (int)( (uint64_t)g_nFrameMemoMissMs * 1000u / (uint32_t)g_nFrameMemoMisses );
+  int nHitUs = (int)( (uint64_t)g_nFrameMemoHitMs * 1000u / (uint32_t)g_nFrameMemoHits );
+
+  return nMissUs > nHitUs ? nMissUs - nHitUs : 0;
+}
+
+void FrameMemoLogSummary()
+{
+  int nFrames = g_nFrameMemoHits + g_nFrameMemoMisses;
+
+  APP_LOG( APP_LOG_LEVEL_INFO,
+           "frame memo : %d of %d frames copied ( %d%% ), saves ~%d us per idle second",
+           g_nFrameMemoHits,
+           nFrames,
+           nFrames ? g_nFrameMemoHits * 100 / nFrames : 0,
+           FrameMemoSavedUsPerIdleSecond() );
+}
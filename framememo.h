@@ -0,0 +1,42 @@
+#ifndef HOPPER_FRAMEMEMO_H
+#define HOPPER_FRAMEMEMO_H
+
+#include <pebble.h>
+
+// -------------------------------------------------------------------
+// Frame memo
+//
+// With nobody moving the play view flips between two pictures, one for
+// each state of the bounce. The caller hashes everything the frame shows
+// into a key and asks for it before drawing. On a hit the framebuffer is
+// filled from a kept copy and nothing is drawn. On a miss the caller
+// draws as usual and hands the finished frame back to be kept.
+//
+// Two frames are kept, the least recently used is replaced. Anything
+// that changes the picture has to change the key, that's the only
+// invalidation there is. Both frames are static, 6.5k between them.
+//
+
+// Off draws every frame, and forgets both kept ones
+void FrameMemoSetEnabled( bool fEnabled );
+
+// Forget both kept frames
+void FrameMemoInvalidate();
+
+// True, with the framebuffer filled in, if the frame for nKey is kept.
+// False starts timing the draw that has to follow.
+bool FrameMemoRestore( GContext* ctx, uint64_t nKey );
+
+// Keep the frame just drawn for nKey
+void FrameMemoStore( GContext* ctx, uint64_t nKey );
+
+int FrameMemoHits();
+int FrameMemoMisses();
+
+// Average ms a miss spent drawing less what a hit spent copying, times
+// one frame a second : what memoing saves in each second nothing moved
+int FrameMemoSavedUsPerIdleSecond();
+
+void FrameMemoLogSummary();
+
+#endif // HOPPER_FRAMEMEMO_H
@@ -0,0 +1,242 @@
+#include "haptics.h"
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+struct HapticPattern
+{
+  const uint32_t* m_pDurations;
+  int m_nSegments;
+
+  // Shortest gap between two buzzes of this kind
+  uint32_t m_nCooldownMs;
+};
+
+static const uint32_t c_vHapticHopBlocked[] = { 80 };
+static const uint32_t c_vHapticTileCrumbled[] = { 200, 100, 50, 50 };
+static const uint32_t c_vHapticDeath[] = { 600 };
+
+static const struct HapticPattern c_vHapticPatterns[ eHapticCount ] = {
+  { c_vHapticHopBlocked, ARRAY_LENGTH( c_vHapticHopBlocked ), 400 },
+  { c_vHapticTileCrumbled, ARRAY_LENGTH( c_vHapticTileCrumbled ), 1500 },
+  { c_vHapticDeath, ARRAY_LENGTH( c_vHapticDeath ), 0 }
+};
+
+static const char* const c_szHapticNames[ eHapticCount ] = {
+  "blocked",
+  "crumbled",
+  "death"
+};
+
+// Bit n set when event n has been asked for since the last flush
+static uint8_t g_nHapticPending = 0;
+
+static bool g_fHapticPlaying = false;
+static EHapticEvent g_eHapticPlaying = eHapticHopBlocked;
+static uint32_t g_nHapticPlayStartMs = 0;
+
+static bool g_vHapticEverPlayed[ eHapticCount ];
+static uint32_t g_vHapticLastPlayedMs[ eHapticCount ];
+
+static int g_vHapticRequested[ eHapticCount ];
+static int g_vHapticPlayed[ eHapticCount ];
+static int g_nHapticPreempted = 0;
+
+static uint32_t g_nHapticStartMs = 0;
+static uint32_t g_nHapticMotorMs = 0;
+static uint32_t g_nHapticUnscheduledMs = 0;
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+static uint32_t NowMs()
+{
+  time_t nSeconds;
+  uint16_t nMs;
+
+  time_ms( &nSeconds, &nMs );
+
+  // Wraps every 49 days, only ever used for differences
+  return (uint32_t)nSeconds * 1000u + nMs;
+}
+
+static uint32_t PatternLengthMs( const struct HapticPattern* pPattern )
+{
+  uint32_t nMs = 0;
+
+  for( int nSegment = 0 ; nSegment < pPattern->m_nSegments ; ++nSegment )
+  {
+    nMs += pPattern->m_pDurations[ nSegment ];
+  }
+
+  return nMs;
+}
+
+// Motor-on time in the first nElapsedMs of a pattern, segments alternate
+// on and off starting with on
+static uint32_t PatternOnMs( const struct HapticPattern* pPattern, uint32_t nElapsedMs )
+{
+  uint32_t nOnMs = 0;
+
+  for( int nSegment = 0 ; nSegment < pPattern->m_nSegments && nElapsedMs > 0 ; ++nSegment )
+  {
+    uint32_t nSegmentMs = pPattern->m_pDurations[ nSegment ];
+
+    if( nSegmentMs > nElapsedMs )
+    {
+      nSegmentMs = nElapsedMs;
+    }
+
+    if( ( nSegment & 1 ) == 0 )
+    {
+      nOnMs += nSegmentMs;
+    }
+
+    nElapsedMs -= nSegmentMs;
+  }
+
+  return nOnMs;
+}
+
+static bool IsCoolingDown( EHapticEvent eEvent, uint32_t nNowMs )
+{
+  return    g_vHapticEverPlayed[ eEvent ]
+         && nNowMs - g_vHapticLastPlayedMs[ eEvent ] < c_vHapticPatterns[ eEvent ].m_nCooldownMs;
+}
+
+static int ScaleToMinute( uint32_t nMs )
+{
+  uint32_t nElapsedMs = NowMs() - g_nHapticStartMs;
+
+  if( nElapsedMs < 1000 )
+  {
+    return (int)nMs;
+  }
+
+  return (int)( (uint64_t)nMs * 60000u / nElapsedMs );
+}
+
+void HapticsInit()
+{
+  g_nHapticPending = 0;
+  g_fHapticPlaying = false;
+  g_nHapticPreempted = 0;
+  g_nHapticMotorMs = 0;
+  g_nHapticUnscheduledMs = 0;
+
+  for( int nEvent = 0 ; nEvent < eHapticCount ; ++nEvent )
+  {
+    g_vHapticEverPlayed[ nEvent ] = false;
+    g_vHapticRequested[ nEvent ] = 0;
+    g_vHapticPlayed[ nEvent ] = 0;
+  }
+
+  g_nHapticStartMs = NowMs();
+}
+
+void HapticsRequest( EHapticEvent eEvent )
+{
+  g_nHapticPending |= (uint8_t)( 1 << eEvent );
+
+  ++g_vHapticRequested[ eEvent ];
+  g_nHapticUnscheduledMs += PatternOnMs( &c_vHapticPatterns[ eEvent ], UINT32_MAX );
+}
+
+void HapticsFlush()
+{
+  if( ! g_nHapticPending )
+  {
+    return;
+  }
+
+  uint32_t nNowMs = NowMs();
+  uint8_t nPending = g_nHapticPending;
+
+  g_nHapticPending = 0;
+
+  if(    g_fHapticPlaying
+      && nNowMs - g_nHapticPlayStartMs >= PatternLengthMs( &c_vHapticPatterns[ g_eHapticPlaying ] ) )
+  {
+    g_fHapticPlaying = false;
+  }
+
+  for( int nEvent = eHapticCount - 1 ; nEvent >= 0 ; --nEvent )
+  {
+    EHapticEvent eEvent = (EHapticEvent)nEvent;
+
+    if(    ! ( nPending & ( 1 << nEvent ) )
+        || IsCoolingDown( eEvent, nNowMs ) )
+    {
+      continue;
+    }
+
+    if( g_fHapticPlaying )
+    {
+      if( eEvent <= g_eHapticPlaying )
+      {
+        // Something as important is still buzzing, let it finish
+        return;
+      }
+
+      // Cut it short and only charge the part that actually played
+      const struct HapticPattern* pPlaying = &c_vHapticPatterns[ g_eHapticPlaying ];
+
+      vibes_cancel();
+
+      g_nHapticMotorMs -=   PatternOnMs( pPlaying, UINT32_MAX )
+                          - PatternOnMs( pPlaying, nNowMs - g_nHapticPlayStartMs );
+      ++g_nHapticPreempted;
+    }
+
+    const struct HapticPattern* pPattern = &c_vHapticPatterns[ eEvent ];
+
+    VibePattern pattern = {
+      .durations = pPattern->m_pDurations,
+      .num_segments = (uint32_t)pPattern->m_nSegments,
+    };
+
+    vibes_enqueue_custom_pattern( pattern );
+
+    g_fHapticPlaying = true;
+    g_eHapticPlaying = eEvent;
+    g_nHapticPlayStartMs = nNowMs;
+
+    g_vHapticEverPlayed[ eEvent ] = true;
+    g_vHapticLastPlayedMs[ eEvent ] = nNowMs;
+
+    ++g_vHapticPlayed[ eEvent ];
+    g_nHapticMotorMs += PatternOnMs( pPattern, UINT32_MAX );
+
+    return;
+  }
+}
+
+int HapticsMotorMsPerMinute()
+{
+  return ScaleToMinute( g_nHapticMotorMs );
+}
+
+int HapticsUnscheduledMsPerMinute()
+{
+  return ScaleToMinute( g_nHapticUnscheduledMs );
+}
+
+void HapticsLogSummary()
+{
+  for( int nEvent = 0 ; nEvent < eHapticCount ; ++nEvent )
+  {
+    APP_LOG( APP_LOG_LEVEL_INFO,
+             "haptics %s : %d requested, %d played",
+             c_szHapticNames[ nEvent ],
+             g_vHapticRequested[ nEvent ],
+             g_vHapticPlayed[ nEvent ] );
+  }
+
+  APP_LOG( APP_LOG_LEVEL_INFO,
+           "haptics motor on %d ms / min ( %d ms / min unscheduled ), %d preempted",
+           HapticsMotorMsPerMinute(),
+           HapticsUnscheduledMsPerMinute(),
+           g_nHapticPreempted );
+}
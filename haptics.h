@@ -0,0 +1,45 @@
+#ifndef HOPPER_HAPTICS_H
+#define HOPPER_HAPTICS_H
+
+#include <pebble.h>
+
+// -------------------------------------------------------------------
+// Haptic scheduler
+//
+// Gameplay asks for a buzz with HapticsRequest, which only marks the
+// event pending. HapticsFlush, called once at the end of a tick or an
+// input frame, plays at most one pattern: the highest priority pending
+// event whose category is off cooldown. So three skeletons crumbling
+// tiles in one tick is one buzz, and a death cuts off whatever is
+// already playing.
+//
+// Every pattern is a custom one with known durations so the motor-on
+// time can be counted, next to what the same requests would have cost
+// played one by one.
+//
+
+// In priority order, lowest first
+typedef enum
+{
+  eHapticHopBlocked = 0,
+  eHapticTileCrumbled = 1,
+  eHapticDeath = 2,
+  eHapticCount = 3
+} EHapticEvent;
+
+void HapticsInit();
+
+void HapticsRequest( EHapticEvent eEvent );
+
+// Play the best pending event, if any, and clear the rest
+void HapticsFlush();
+
+// Motor-on time since HapticsInit, scaled to a minute of play
+int HapticsMotorMsPerMinute();
+
+// The same figure had every request buzzed on its own
+int HapticsUnscheduledMsPerMinute();
+
+void HapticsLogSummary();
+
+#endif // HOPPER_HAPTICS_H
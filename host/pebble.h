@@ -0,0 +1,387 @@
+#ifndef HOPPER_HOST_PEBBLE_H
+#define HOPPER_HOST_PEBBLE_H
+
+// -------------------------------------------------------------------
+// Host stand-in for the parts of the Pebble SDK the game code uses
+//
+// Only enough to build and measure game code on a desktop. Graphics
+// calls draw into a 144x168 1-bit framebuffer laid out like the aplite
+// one, with a simple software rasterizer in pebble_gfx.c. Windows,
+// input, timers, storage and resources are in pebble_app.c, where the
+// host drives the app by hand : nothing fires until it asks.
+//
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ARRAY_LENGTH( array ) ( sizeof( array ) / sizeof( ( array )[ 0 ] ) )
+
+#define APP_LOG_LEVEL_ERROR 1
+#define APP_LOG_LEVEL_WARNING 50
+#define APP_LOG_LEVEL_INFO 100
+#define APP_LOG_LEVEL_DEBUG 200
+
+// Logging is off unless a host build asks for it. Off, the arguments
+// still sit in an unevaluated sizeof so what only feeds logs counts as used.
+#ifdef HOPPER_HOST_LOG
+#define APP_LOG( level, ... ) ( (void)( level ), printf( __VA_ARGS__ ), printf( "\n" ) )
+#else
+#define APP_LOG( level, ... ) ( (void)( level ), (void)sizeof( printf( __VA_ARGS__ ) ) )
+#endif
+
+// -------------------------------------------------------------------
+// Geometry
+//
+
+typedef struct GPoint
+{
+  int16_t x;
+  int16_t y;
+} GPoint;
+
+typedef struct GSize
+{
+  int16_t w;
+  int16_t h;
+} GSize;
+
+typedef struct GRect
+{
+  GPoint origin;
+  GSize size;
+} GRect;
+
+#define GPoint( x, y ) ( (GPoint){ (int16_t)( x ), (int16_t)( y ) } )
+#define GSize( w, h ) ( (GSize){ (int16_t)( w ), (int16_t)( h ) } )
+#define GRect( x, y, w, h ) ( (GRect){ { (int16_t)( x ), (int16_t)( y ) }, { (int16_t)( w ), (int16_t)( h ) } } )
+
+// -------------------------------------------------------------------
+// Graphics
+//
+
+typedef enum
+{
+  GColorClear = -1,
+  GColorBlack = 0,
+  GColorWhite = 1
+} GColor;
+
+typedef enum
+{
+  GCompOpAssign,
+  GCompOpAssignInverted,
+  GCompOpOr,
+  GCompOpAnd,
+  GCompOpClear,
+  GCompOpSet
+} GCompOp;
+
+typedef enum
+{
+  GCornerNone = 0
+} GCornerMask;
+
+typedef enum
+{
+  GBitmapFormat1Bit = 0
+} GBitmapFormat;
+
+typedef struct GPathInfo
+{
+  uint32_t num_points;
+  GPoint* points;
+} GPathInfo;
+
+typedef struct GPath GPath;
+typedef struct GBitmap GBitmap;
+typedef struct GContext GContext;
+
+GPath* gpath_create( const GPathInfo* pInfo );
+void gpath_destroy( GPath* pPath );
+void gpath_move_to( GPath* pPath, GPoint point );
+void gpath_draw_filled( GContext* ctx, GPath* pPath );
+void gpath_draw_outline( GContext* ctx, GPath* pPath );
+
+GBitmap* gbitmap_create_blank( GSize size, GBitmapFormat format );
+void gbitmap_destroy( GBitmap* pBitmap );
+uint8_t* gbitmap_get_data( const GBitmap* pBitmap );
+uint16_t gbitmap_get_bytes_per_row( const GBitmap* pBitmap );
+GBitmapFormat gbitmap_get_format( const GBitmap* pBitmap );
+GRect gbitmap_get_bounds( const GBitmap* pBitmap );
+
+void graphics_context_set_fill_color( GContext* ctx, GColor color );
+void graphics_context_set_stroke_color( GContext* ctx, GColor color );
+void graphics_context_set_compositing_mode( GContext* ctx, GCompOp eCompOp );
+
+void graphics_draw_pixel( GContext* ctx, GPoint point );
+void graphics_draw_line( GContext* ctx, GPoint from, GPoint to );
+void graphics_fill_rect( GContext* ctx, GRect rect, uint16_t nCornerRadius, GCornerMask eCorners );
+void graphics_draw_bitmap_in_rect( GContext* ctx, const GBitmap* pBitmap, GRect rect );
+
+GBitmap* graphics_capture_frame_buffer( GContext* ctx );
+bool graphics_release_frame_buffer( GContext* ctx, GBitmap* pBitmap );
+
+// -------------------------------------------------------------------
+// Text
+//
+// Fonts are names only, text isn't rasterized on the host
+//
+
+typedef const char* GFont;
+
+typedef enum
+{
+  GTextOverflowModeWordWrap,
+  GTextOverflowModeTrailingEllipsis,
+  GTextOverflowModeFill
+} GTextOverflowMode;
+
+typedef enum
+{
+  GTextAlignmentLeft,
+  GTextAlignmentCenter,
+  GTextAlignmentRight
+} GTextAlignment;
+
+typedef struct GTextAttributes GTextAttributes;
+
+#define FONT_KEY_GOTHIC_14 "GOTHIC_14"
+#define FONT_KEY_GOTHIC_18 "GOTHIC_18"
+
+GFont fonts_get_system_font( const char* szFontKey );
+
+void graphics_context_set_text_color( GContext* ctx, GColor color );
+void graphics_draw_text( GContext* ctx,
+                         const char* szText,
+                         GFont font,
+                         GRect box,
+                         GTextOverflowMode eOverflowMode,
+                         GTextAlignment eAlignment,
+                         GTextAttributes* pAttributes );
+
+// -------------------------------------------------------------------
+// Resources
+//
+// Image resources come back as blank sprite sized bitmaps with a block
+// in the middle, raw resources are read from files under res/
+//
+
+typedef enum
+{
+  RESOURCE_ID_img_penguin_ne_sprite = 1,
+  RESOURCE_ID_img_penguin_ne_mask,
+  RESOURCE_ID_img_penguin_nw_sprite,
+  RESOURCE_ID_img_penguin_nw_mask,
+  RESOURCE_ID_img_penguin_se_sprite,
+  RESOURCE_ID_img_penguin_se_mask,
+  RESOURCE_ID_img_penguin_sw_sprite,
+  RESOURCE_ID_img_penguin_sw_mask,
+  RESOURCE_ID_enemy_skeleton_se_sprite_1,
+  RESOURCE_ID_enemy_skeleton_se_mask_1,
+  RESOURCE_ID_enemy_skeleton_se_sprite_2,
+  RESOURCE_ID_enemy_skeleton_se_mask_2,
+  RESOURCE_ID_enemy_skeleton_sw_sprite_1,
+  RESOURCE_ID_enemy_skeleton_sw_mask_1,
+  RESOURCE_ID_enemy_skeleton_sw_sprite_2,
+  RESOURCE_ID_enemy_skeleton_sw_mask_2,
+  RESOURCE_ID_img_treasuregem_sprite,
+  RESOURCE_ID_img_treasuregem_mask,
+  RESOURCE_ID_LEVEL_PACK
+} HostResourceId;
+
+typedef const struct HostResource* ResHandle;
+
+ResHandle resource_get_handle( uint32_t nResourceId );
+size_t resource_size( ResHandle hResource );
+size_t resource_load_byte_range( ResHandle hResource, uint32_t nStartOffset, uint8_t* pBuffer, size_t nBytes );
+
+GBitmap* gbitmap_create_with_resource( uint32_t nResourceId );
+
+// -------------------------------------------------------------------
+// Windows and layers
+//
+
+typedef struct Window Window;
+typedef struct Layer Layer;
+
+typedef void ( *LayerUpdateProc )( Layer* pLayer, GContext* ctx );
+
+Window* window_create();
+void window_destroy( Window* pWindow );
+void window_set_background_color( Window* pWindow, GColor color );
+Layer* window_get_root_layer( const Window* pWindow );
+void window_stack_push( Window* pWindow, bool fAnimated );
+Window* window_stack_pop( bool fAnimated );
+
+Layer* layer_create( GRect frame );
+void layer_destroy( Layer* pLayer );
+GRect layer_get_frame( const Layer* pLayer );
+void layer_set_update_proc( Layer* pLayer, LayerUpdateProc pfnUpdate );
+void layer_add_child( Layer* pParent, Layer* pChild );
+void layer_mark_dirty( Layer* pLayer );
+
+// -------------------------------------------------------------------
+// Input
+//
+
+typedef enum
+{
+  BUTTON_ID_BACK = 0,
+  BUTTON_ID_UP,
+  BUTTON_ID_SELECT,
+  BUTTON_ID_DOWN,
+  NUM_BUTTONS
+} ButtonId;
+
+typedef void* ClickRecognizerRef;
+typedef void ( *ClickHandler )( ClickRecognizerRef recognizer, void* pContext );
+typedef void ( *ClickConfigProvider )( void* pContext );
+
+void window_set_click_config_provider( Window* pWindow, ClickConfigProvider pfnProvider );
+void window_single_click_subscribe( ButtonId eButton, ClickHandler pfnHandler );
+void window_single_repeating_click_subscribe( ButtonId eButton, uint16_t nRepeatMs, ClickHandler pfnHandler );
+void window_long_click_subscribe( ButtonId eButton, uint16_t nDelayMs, ClickHandler pfnDown, ClickHandler pfnUp );
+
+typedef enum
+{
+  ACCEL_AXIS_X = 0,
+  ACCEL_AXIS_Y = 1,
+  ACCEL_AXIS_Z = 2
+} AccelAxisType;
+
+typedef void ( *AccelTapHandler )( AccelAxisType axis, int32_t direction );
+
+void accel_tap_service_subscribe( AccelTapHandler pfnHandler );
+void accel_tap_service_unsubscribe();
+
+// -------------------------------------------------------------------
+// Time and timers
+//
+
+typedef enum
+{
+  SECOND_UNIT = 1 << 0,
+  MINUTE_UNIT = 1 << 1
+} TimeUnits;
+
+typedef void ( *TickHandler )( struct tm* pTickTime, TimeUnits eUnitsChanged );
+
+void tick_timer_service_subscribe( TimeUnits eUnits, TickHandler pfnHandler );
+void tick_timer_service_unsubscribe();
+
+typedef struct AppTimer AppTimer;
+typedef void ( *AppTimerCallback )( void* pData );
+
+AppTimer* app_timer_register( uint32_t nTimeoutMs, AppTimerCallback pfnCallback, void* pData );
+void app_timer_cancel( AppTimer* pTimer );
+
+// Host time, moved on only by host_advance_ms()
+uint16_t time_ms( time_t* pnSeconds, uint16_t* pnMs );
+
+// -------------------------------------------------------------------
+// Storage
+//
+// In memory, gone when the process exits
+//
+
+#define PERSIST_DATA_MAX_LENGTH 256
+
+bool persist_exists( uint32_t nKey );
+int persist_get_size( uint32_t nKey );
+int32_t persist_read_int( uint32_t nKey );
+int persist_write_int( uint32_t nKey, int32_t nValue );
+int persist_read_data( uint32_t nKey, void* pBuffer, size_t nBytes );
+int persist_write_data( uint32_t nKey, const void* pData, size_t nBytes );
+
+// -------------------------------------------------------------------
+// Data logging
+//
+// Counted and dropped, see host_data_log_bytes()
+//
+
+typedef void* DataLoggingSessionRef;
+
+typedef enum
+{
+  DATA_LOGGING_BYTE_ARRAY = 0,
+  DATA_LOGGING_UINT = 2,
+  DATA_LOGGING_INT = 3
+} DataLoggingItemType;
+
+typedef enum
+{
+  DATA_LOGGING_SUCCESS = 0,
+  DATA_LOGGING_BUSY = 1,
+  DATA_LOGGING_FULL = 2,
+  DATA_LOGGING_NOT_FOUND = 3,
+  DATA_LOGGING_CLOSED = 4,
+  DATA_LOGGING_INVALID_PARAMS = 5
+} DataLoggingResult;
+
+DataLoggingSessionRef data_logging_create( uint32_t nTag, DataLoggingItemType eItemType, uint16_t nItemLength, bool fResume );
+DataLoggingResult data_logging_log( DataLoggingSessionRef pSession, const void* pData, uint32_t nItems );
+void data_logging_finish( DataLoggingSessionRef pSession );
+
+// -------------------------------------------------------------------
+// Vibes and heap
+//
+
+typedef struct VibePattern
+{
+  const uint32_t* durations;
+  uint32_t num_segments;
+} VibePattern;
+
+void vibes_enqueue_custom_pattern( VibePattern pattern );
+void vibes_cancel();
+
+size_t heap_bytes_used();
+size_t heap_bytes_free();
+
+void app_event_loop();
+
+// -------------------------------------------------------------------
+// Host only
+//
+
+#define cnHostScreenWidth 144
+#define cnHostScreenHeight 168
+
+// The context for the host screen, and the screen itself
+GContext* host_graphics_context();
+GBitmap* host_screen_bitmap();
+
+// Pixels the drawing calls have stored so far, into any bitmap, with
+// the ones clipped off left out. Writes straight into a captured
+// framebuffer aren't drawing calls and aren't counted.
+long host_pixel_writes();
+
+// Directory raw resources are read from, res by default
+void host_set_resource_dir( const char* szDirectory );
+
+// Moves host time on, firing due app timers and the tick handler once
+// for each second boundary crossed
+void host_advance_ms( uint32_t nMs );
+
+// Calls the handlers the click config provider subscribed for a button
+void host_click( ButtonId eButton );
+void host_long_click( ButtonId eButton );
+void host_accel_tap();
+
+// Redraws the top window's layers into the host screen if any are dirty,
+// true if it drew. host_render_count() is the number of redraws so far.
+bool host_render();
+int host_render_count();
+
+// Number of vibes patterns started so far
+int host_vibe_count();
+
+// Bytes handed to data_logging_log() so far, over every session
+int host_data_log_bytes();
+
+#endif // HOPPER_HOST_PEBBLE_H
@@ -0,0 +1,706 @@
+#include "pebble.h"
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+#ifndef HOPPER_HOST_RESOURCE_DIR
+#define HOPPER_HOST_RESOURCE_DIR "res"
+#endif
+
+struct Layer
+{
+  GRect m_frame;
+  LayerUpdateProc m_pfnUpdate;
+
+  Layer* m_pFirstChild;
+  Layer* m_pNextSibling;
+};
+
+struct Window
+{
+  Layer m_rootLayer;
+  GColor m_eBackgroundColour;
+  ClickConfigProvider m_pfnClickConfigProvider;
+};
+
+struct AppTimer
+{
+  bool m_fActive;
+  uint64_t m_nDueMs;
+  AppTimerCallback m_pfnCallback;
+  void* m_pData;
+};
+
+struct HostResource
+{
+  uint32_t m_nResourceId;
+  const char* m_szFileName;
+  uint8_t* m_pData;
+  size_t m_nBytes;
+  bool m_fLoaded;
+};
+
+struct HostPersistEntry
+{
+  uint32_t m_nKey;
+  int m_nBytes;
+  uint8_t m_vData[ PERSIST_DATA_MAX_LENGTH ];
+};
+
+#define cnHostWindowStackSize 4
+#define cnHostTimers 8
+#define cnHostPersistEntries 32
+
+// Sprites in res/ are all 16x16
+#define cnHostSpriteSize 16
+
+static Window* g_vHostWindowStack[ cnHostWindowStackSize ];
+static int g_nHostWindowCount = 0;
+static bool g_fHostDirty = false;
+static int g_nHostRenderCount = 0;
+
+static ClickHandler g_vHostSingleClick[ NUM_BUTTONS ];
+static ClickHandler g_vHostLongClick[ NUM_BUTTONS ];
+static AccelTapHandler g_pfnHostAccelTap = NULL;
+
+static TickHandler g_pfnHostTick = NULL;
+static struct AppTimer g_vHostTimers[ cnHostTimers ];
+
+// Starts on a fixed date so runs are repeatable
+static uint64_t g_nHostNowMs = 1500000000ull * 1000;
+
+static char g_szHostResourceDir[ 256 ] = HOPPER_HOST_RESOURCE_DIR;
+
+static struct HostResource g_vHostResources[] = {
+  { RESOURCE_ID_LEVEL_PACK, "levels.pack", NULL, 0, false }
+};
+
+static struct HostPersistEntry g_vHostPersist[ cnHostPersistEntries ];
+static int g_nHostPersistCount = 0;
+
+static int g_nHostVibeCount = 0;
+
+struct DataLoggingSession
+{
+  uint32_t m_nTag;
+  uint16_t m_nItemLength;
+  bool m_fOpen;
+};
+
+static struct DataLoggingSession g_hostDataLog;
+static int g_nHostDataLogBytes = 0;
+
+// -------------------------------------------------------------------
+// Resources
+//
+
+void host_set_resource_dir( const char* szDirectory )
+{
+  snprintf( g_szHostResourceDir, sizeof( g_szHostResourceDir ), "%s", szDirectory );
+}
+
+static void LoadResourceFile( struct HostResource* pResource )
+{
+  char szPath[ 512 ];
+  snprintf( szPath, sizeof( szPath ), "%s/%s", g_szHostResourceDir, pResource->m_szFileName );
+
+  pResource->m_fLoaded = true;
+
+  FILE* pFile = fopen( szPath, "rb" );
+
+  if( ! pFile )
+  {
+    return;
+  }
+
+  fseek( pFile, 0, SEEK_END );
+  long nBytes = ftell( pFile );
+  fseek( pFile, 0, SEEK_SET );
+
+  if( nBytes > 0 )
+  {
+    pResource->m_pData = (uint8_t*)malloc( (size_t)nBytes );
+
+    if(    pResource->m_pData
+        && fread( pResource->m_pData, 1, (size_t)nBytes, pFile ) == (size_t)nBytes )
+    {
+      pResource->m_nBytes = (size_t)nBytes;
+    }
+  }
+
+  fclose( pFile );
+}
+
+ResHandle resource_get_handle( uint32_t nResourceId )
+{
+  for( size_t nResource = 0 ; nResource < ARRAY_LENGTH( g_vHostResources ) ; ++nResource )
+  {
+    struct HostResource* pResource = &g_vHostResources[ nResource ];
+
+    if( pResource->m_nResourceId != nResourceId )
+    {
+      continue;
+    }
+
+    if( ! pResource->m_fLoaded )
+    {
+      LoadResourceFile( pResource );
+    }
+
+    return pResource->m_nBytes ? pResource : NULL;
+  }
+
+  return NULL;
+}
+
+size_t resource_size( ResHandle hResource )
+{
+  return hResource ? hResource->m_nBytes : 0;
+}
+
+size_t resource_load_byte_range( ResHandle hResource, uint32_t nStartOffset, uint8_t* pBuffer, size_t nBytes )
+{
+  if(    ! hResource
+      || nStartOffset >= hResource->m_nBytes )
+  {
+    return 0;
+  }
+
+  if( nBytes > hResource->m_nBytes - nStartOffset )
+  {
+    nBytes = hResource->m_nBytes - nStartOffset;
+  }
+
+  memcpy( pBuffer, hResource->m_pData + nStartOffset, nBytes );
+
+  return nBytes;
+}
+
+// Stand-in sprite : a solid block in the middle, so sprites still show
+// up and cover what's behind them in host frames
+GBitmap* gbitmap_create_with_resource( uint32_t nResourceId )
+{
+  (void)nResourceId;
+
+  GBitmap* pBitmap = gbitmap_create_blank( GSize( cnHostSpriteSize, cnHostSpriteSize ), GBitmapFormat1Bit );
+  uint8_t* pData = gbitmap_get_data( pBitmap );
+  uint16_t nBytesPerRow = gbitmap_get_bytes_per_row( pBitmap );
+
+  for( int y = 4 ; y < cnHostSpriteSize ; ++y )
+  {
+    pData[ y * nBytesPerRow ] = 0xF0;
+    pData[ y * nBytesPerRow + 1 ] = 0x0F;
+  }
+
+  return pBitmap;
+}
+
+// -------------------------------------------------------------------
+// Windows and layers
+//
+
+Window* window_create()
+{
+  Window* pWindow = (Window*)calloc( 1, sizeof( Window ) );
+
+  pWindow->m_rootLayer.m_frame = GRect( 0, 0, cnHostScreenWidth, cnHostScreenHeight );
+  pWindow->m_eBackgroundColour = GColorWhite;
+
+  return pWindow;
+}
+
+void window_destroy( Window* pWindow )
+{
+  free( pWindow );
+}
+
+void window_set_background_color( Window* pWindow, GColor color )
+{
+  pWindow->m_eBackgroundColour = color;
+  g_fHostDirty = true;
+}
+
+Layer* window_get_root_layer( const Window* pWindow )
+{
+  return (Layer*)&pWindow->m_rootLayer;
+}
+
+void window_stack_push( Window* pWindow, bool fAnimated )
+{
+  (void)fAnimated;
+
+  if( g_nHostWindowCount < cnHostWindowStackSize )
+  {
+    g_vHostWindowStack[ g_nHostWindowCount++ ] = pWindow;
+    g_fHostDirty = true;
+  }
+}
+
+Window* window_stack_pop( bool fAnimated )
+{
+  (void)fAnimated;
+
+  if( g_nHostWindowCount == 0 )
+  {
+    return NULL;
+  }
+
+  g_fHostDirty = true;
+
+  return g_vHostWindowStack[ --g_nHostWindowCount ];
+}
+
+Layer* layer_create( GRect frame )
+{
+  Layer* pLayer = (Layer*)calloc( 1, sizeof( Layer ) );
+
+  pLayer->m_frame = frame;
+
+  return pLayer;
+}
+
+void layer_destroy( Layer* pLayer )
+{
+  free( pLayer );
+}
+
+GRect layer_get_frame( const Layer* pLayer )
+{
+  return pLayer->m_frame;
+}
+
+void layer_set_update_proc( Layer* pLayer, LayerUpdateProc pfnUpdate )
+{
+  pLayer->m_pfnUpdate = pfnUpdate;
+}
+
+void layer_add_child( Layer* pParent, Layer* pChild )
+{
+  Layer** ppLast = &pParent->m_pFirstChild;
+
+  while( *ppLast )
+  {
+    ppLast = &( *ppLast )->m_pNextSibling;
+  }
+
+  *ppLast = pChild;
+  pChild->m_pNextSibling = NULL;
+}
+
+void layer_mark_dirty( Layer* pLayer )
+{
+  (void)pLayer;
+  g_fHostDirty = true;
+}
+
+// Layers all fill the screen in this app, so frames aren't used to
+// offset or clip the drawing
+static void RenderLayer( Layer* pLayer, GContext* ctx )
+{
+  if( pLayer->m_pfnUpdate )
+  {
+    pLayer->m_pfnUpdate( pLayer, ctx );
+  }
+
+  for( Layer* pChild = pLayer->m_pFirstChild ; pChild ; pChild = pChild->m_pNextSibling )
+  {
+    RenderLayer( pChild, ctx );
+  }
+}
+
+bool host_render()
+{
+  if(    ! g_fHostDirty
+      || g_nHostWindowCount == 0 )
+  {
+    return false;
+  }
+
+  Window* pWindow = g_vHostWindowStack[ g_nHostWindowCount - 1 ];
+  GBitmap* pScreen = host_screen_bitmap();
+
+  memset( gbitmap_get_data( pScreen ),
+          pWindow->m_eBackgroundColour == GColorWhite ? 0xFF : 0x00,
+          (size_t)gbitmap_get_bytes_per_row( pScreen ) * cnHostScreenHeight );
+
+  RenderLayer( &pWindow->m_rootLayer, host_graphics_context() );
+
+  g_fHostDirty = false;
+  ++g_nHostRenderCount;
+
+  return true;
+}
+
+int host_render_count()
+{
+  return g_nHostRenderCount;
+}
+
+// -------------------------------------------------------------------
+// Input
+//
+
+// The provider is run straight away, there's only ever the one window
+void window_set_click_config_provider( Window* pWindow, ClickConfigProvider pfnProvider )
+{
+  pWindow->m_pfnClickConfigProvider = pfnProvider;
+
+  memset( g_vHostSingleClick, 0, sizeof( g_vHostSingleClick ) );
+  memset( g_vHostLongClick, 0, sizeof( g_vHostLongClick ) );
+
+  if( pfnProvider )
+  {
+    pfnProvider( pWindow );
+  }
+}
+
+void window_single_click_subscribe( ButtonId eButton, ClickHandler pfnHandler )
+{
+  g_vHostSingleClick[ eButton ] = pfnHandler;
+}
+
+void window_single_repeating_click_subscribe( ButtonId eButton, uint16_t nRepeatMs, ClickHandler pfnHandler )
+{
+  (void)nRepeatMs;
+  g_vHostSingleClick[ eButton ] = pfnHandler;
+}
+
+void window_long_click_subscribe( ButtonId eButton, uint16_t nDelayMs, ClickHandler pfnDown, ClickHandler pfnUp )
+{
+  (void)nDelayMs;
+  (void)pfnUp;
+  g_vHostLongClick[ eButton ] = pfnDown;
+}
+
+void host_click( ButtonId eButton )
+{
+  if( g_vHostSingleClick[ eButton ] )
+  {
+    g_vHostSingleClick[ eButton ]( NULL, NULL );
+  }
+}
+
+void host_long_click( ButtonId eButton )
+{
+  if( g_vHostLongClick[ eButton ] )
+  {
+    g_vHostLongClick[ eButton ]( NULL, NULL );
+  }
+}
+
+void accel_tap_service_subscribe( AccelTapHandler pfnHandler )
+{
+  g_pfnHostAccelTap = pfnHandler;
+}
+
+void accel_tap_service_unsubscribe()
+{
+  g_pfnHostAccelTap = NULL;
+}
+
+void host_accel_tap()
+{
+  if( g_pfnHostAccelTap )
+  {
+    g_pfnHostAccelTap( ACCEL_AXIS_X, 1 );
+  }
+}
+
+// -------------------------------------------------------------------
+// Time and timers
+//
+
+void tick_timer_service_subscribe( TimeUnits eUnits, TickHandler pfnHandler )
+{
+  (void)eUnits;
+  g_pfnHostTick = pfnHandler;
+}
+
+void tick_timer_service_unsubscribe()
+{
+  g_pfnHostTick = NULL;
+}
+
+AppTimer* app_timer_register( uint32_t nTimeoutMs, AppTimerCallback pfnCallback, void* pData )
+{
+  for( int nTimer = 0 ; nTimer < cnHostTimers ; ++nTimer )
+  {
+    struct AppTimer* pTimer = &g_vHostTimers[ nTimer ];
+
+    if( ! pTimer->m_fActive )
+    {
+      pTimer->m_fActive = true;
+      pTimer->m_nDueMs = g_nHostNowMs + nTimeoutMs;
+      pTimer->m_pfnCallback = pfnCallback;
+      pTimer->m_pData = pData;
+
+      return pTimer;
+    }
+  }
+
+  return NULL;
+}
+
+void app_timer_cancel( AppTimer* pTimer )
+{
+  if( pTimer )
+  {
+    pTimer->m_fActive = false;
+  }
+}
+
+uint16_t time_ms( time_t* pnSeconds, uint16_t* pnMs )
+{
+  uint16_t nMs = (uint16_t)( g_nHostNowMs % 1000 );
+
+  if( pnSeconds )
+  {
+    *pnSeconds = (time_t)( g_nHostNowMs / 1000 );
+  }
+
+  if( pnMs )
+  {
+    *pnMs = nMs;
+  }
+
+  return nMs;
+}
+
+// Fires everything due up to nTargetMs in time order, timers before the
+// tick when they fall due on the same ms
+void host_advance_ms( uint32_t nMs )
+{
+  uint64_t nTargetMs = g_nHostNowMs + nMs;
+
+  for( ;; )
+  {
+    struct AppTimer* pNextTimer = NULL;
+
+    for( int nTimer = 0 ; nTimer < cnHostTimers ; ++nTimer )
+    {
+      struct AppTimer* pTimer = &g_vHostTimers[ nTimer ];
+
+      if(    pTimer->m_fActive
+          && ( ! pNextTimer || pTimer->m_nDueMs < pNextTimer->m_nDueMs ) )
+      {
+        pNextTimer = pTimer;
+      }
+    }
+
+    uint64_t nNextTickMs = ( g_nHostNowMs / 1000 + 1 ) * 1000;
+
+    if(    pNextTimer
+        && pNextTimer->m_nDueMs <= nTargetMs
+        && pNextTimer->m_nDueMs <= nNextTickMs )
+    {
+      if( pNextTimer->m_nDueMs > g_nHostNowMs )
+      {
+        g_nHostNowMs = pNextTimer->m_nDueMs;
+      }
+
+      // Free the slot first, the callback may well register again
+      pNextTimer->m_fActive = false;
+      pNextTimer->m_pfnCallback( pNextTimer->m_pData );
+      continue;
+    }
+
+    if( nNextTickMs > nTargetMs )
+    {
+      break;
+    }
+
+    g_nHostNowMs = nNextTickMs;
+
+    if( g_pfnHostTick )
+    {
+      time_t nSeconds = (time_t)( g_nHostNowMs / 1000 );
+      struct tm tickTime = *gmtime( &nSeconds );
+
+      g_pfnHostTick( &tickTime, SECOND_UNIT );
+    }
+  }
+
+  g_nHostNowMs = nTargetMs;
+}
+
+// -------------------------------------------------------------------
+// Storage
+//
+
+static struct HostPersistEntry* FindPersistEntry( uint32_t nKey )
+{
+  for( int nEntry = 0 ; nEntry < g_nHostPersistCount ; ++nEntry )
+  {
+    if( g_vHostPersist[ nEntry ].m_nKey == nKey )
+    {
+      return &g_vHostPersist[ nEntry ];
+    }
+  }
+
+  return NULL;
+}
+
+bool persist_exists( uint32_t nKey )
+{
+  return FindPersistEntry( nKey ) != NULL;
+}
+
+int persist_get_size( uint32_t nKey )
+{
+  struct HostPersistEntry* pEntry = FindPersistEntry( nKey );
+
+  return pEntry ? pEntry->m_nBytes : -1;
+}
+
+int32_t persist_read_int( uint32_t nKey )
+{
+  int32_t nValue = 0;
+
+  persist_read_data( nKey, &nValue, sizeof( nValue ) );
+
+  return nValue;
+}
+
+int persist_write_int( uint32_t nKey, int32_t nValue )
+{
+  return persist_write_data( nKey, &nValue, sizeof( nValue ) );
+}
+
+int persist_read_data( uint32_t nKey, void* pBuffer, size_t nBytes )
+{
+  struct HostPersistEntry* pEntry = FindPersistEntry( nKey );
+
+  if( ! pEntry )
+  {
+    return -1;
+  }
+
+  if( nBytes > (size_t)pEntry->m_nBytes )
+  {
+    nBytes = (size_t)pEntry->m_nBytes;
+  }
+
+  memcpy( pBuffer, pEntry->m_vData, nBytes );
+
+  return (int)nBytes;
+}
+
+int persist_write_data( uint32_t nKey, const void* pData, size_t nBytes )
+{
+  struct HostPersistEntry* pEntry = FindPersistEntry( nKey );
+
+  if( ! pEntry )
+  {
+    if( g_nHostPersistCount == cnHostPersistEntries )
+    {
+      return -1;
+    }
+
+    pEntry = &g_vHostPersist[ g_nHostPersistCount++ ];
+    pEntry->m_nKey = nKey;
+  }
+
+  if( nBytes > PERSIST_DATA_MAX_LENGTH )
+  {
+    nBytes = PERSIST_DATA_MAX_LENGTH;
+  }
+
+  memcpy( pEntry->m_vData, pData, nBytes );
+  pEntry->m_nBytes = (int)nBytes;
+
+  return (int)nBytes;
+}
+
+// -------------------------------------------------------------------
+// Data logging
+//
+
+// Just the one session at a time
+DataLoggingSessionRef data_logging_create( uint32_t nTag, DataLoggingItemType eItemType, uint16_t nItemLength, bool fResume )
+{
+  (void)eItemType;
+  (void)fResume;
+
+  if(    g_hostDataLog.m_fOpen
+      || nItemLength == 0 )
+  {
+    return NULL;
+  }
+
+  g_hostDataLog.m_nTag = nTag;
+  g_hostDataLog.m_nItemLength = nItemLength;
+  g_hostDataLog.m_fOpen = true;
+
+  return &g_hostDataLog;
+}
+
+DataLoggingResult data_logging_log( DataLoggingSessionRef pSession, const void* pData, uint32_t nItems )
+{
+  struct DataLoggingSession* pHostSession = pSession;
+
+  if(    ! pHostSession
+      || ! pData )
+  {
+    return DATA_LOGGING_INVALID_PARAMS;
+  }
+
+  if( ! pHostSession->m_fOpen )
+  {
+    return DATA_LOGGING_CLOSED;
+  }
+
+  g_nHostDataLogBytes += (int)( nItems * pHostSession->m_nItemLength );
+
+  return DATA_LOGGING_SUCCESS;
+}
+
+void data_logging_finish( DataLoggingSessionRef pSession )
+{
+  struct DataLoggingSession* pHostSession = pSession;
+
+  if( pHostSession )
+  {
+    pHostSession->m_fOpen = false;
+  }
+}
+
+int host_data_log_bytes()
+{
+  return g_nHostDataLogBytes;
+}
+
+// -------------------------------------------------------------------
+// Vibes, heap and the event loop
+//
+
+void vibes_enqueue_custom_pattern( VibePattern pattern )
+{
+  (void)pattern;
+  ++g_nHostVibeCount;
+}
+
+void vibes_cancel()
+{
+}
+
+int host_vibe_count()
+{
+  return g_nHostVibeCount;
+}
+
+// No heap to speak of on the host, memtrack just sees zeros
+size_t heap_bytes_used()
+{
+  return 0;
+}
+
+size_t heap_bytes_free()
+{
+  return 0;
+}
+
+// The host drives the app itself, see host_advance_ms() and friends
+void app_event_loop()
+{
+}
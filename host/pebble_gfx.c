@@ -0,0 +1,436 @@
+#include <stdlib.h>
+
+#include "pebble.h"
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+struct GPath
+{
+  uint32_t m_nPoints;
+  GPoint* m_pPoints;
+  GPoint m_offset;
+};
+
+struct GBitmap
+{
+  uint8_t* m_pData;
+  uint16_t m_nBytesPerRow;
+  GRect m_bounds;
+  GBitmapFormat m_eFormat;
+  bool m_fOwnsData;
+};
+
+struct GContext
+{
+  GBitmap* m_pTarget;
+  GColor m_eFillColour;
+  GColor m_eStrokeColour;
+  GCompOp m_eCompOp;
+  bool m_fCaptured;
+};
+
+// aplite rows are padded out to a whole number of words
+#define cnHostScreenBytesPerRow 20
+
+static uint8_t g_vHostScreen[ cnHostScreenHeight * cnHostScreenBytesPerRow ];
+
+static GBitmap g_hostScreenBitmap = {
+  g_vHostScreen,
+  cnHostScreenBytesPerRow,
+  { { 0, 0 }, { cnHostScreenWidth, cnHostScreenHeight } },
+  GBitmapFormat1Bit,
+  false
+};
+
+// Every pixel stored by a drawing call, see host_pixel_writes()
+static long g_nHostPixelWrites = 0;
+
+static GContext g_hostContext = {
+  &g_hostScreenBitmap,
+  GColorBlack,
+  GColorBlack,
+  GCompOpAssign,
+  false
+};
+
+// -------------------------------------------------------------------
+// Pixels
+//
+
+static bool GetPixel( const GBitmap* pBitmap, int x, int y )
+{
+  return ( pBitmap->m_pData[ y * pBitmap->m_nBytesPerRow + x / 8 ] >> ( x % 8 ) ) & 1;
+}
+
+static void PutPixel( GBitmap* pBitmap, int x, int y, bool fWhite )
+{
+  if(    x < 0
+      || y < 0
+      || x >= pBitmap->m_bounds.size.w
+      || y >= pBitmap->m_bounds.size.h )
+  {
+    return;
+  }
+
+  uint8_t* pByte = &pBitmap->m_pData[ y * pBitmap->m_nBytesPerRow + x / 8 ];
+
+  ++g_nHostPixelWrites;
+
+  if( fWhite )
+  {
+    *pByte |= (uint8_t)( 1 << ( x % 8 ) );
+  }
+  else
+  {
+    *pByte &= (uint8_t)~( 1 << ( x % 8 ) );
+  }
+}
+
+static void PutColour( GContext* ctx, int x, int y, GColor eColour )
+{
+  if( eColour != GColorClear )
+  {
+    PutPixel( ctx->m_pTarget, x, y, eColour == GColorWhite );
+  }
+}
+
+// -------------------------------------------------------------------
+// Paths
+//
+
+GPath* gpath_create( const GPathInfo* pInfo )
+{
+  GPath* pPath = (GPath*)calloc( 1, sizeof( GPath ) );
+
+  pPath->m_nPoints = pInfo->num_points;
+  pPath->m_pPoints = (GPoint*)malloc( sizeof( GPoint ) * pInfo->num_points );
+  memcpy( pPath->m_pPoints, pInfo->points, sizeof( GPoint ) * pInfo->num_points );
+
+  return pPath;
+}
+
+void gpath_destroy( GPath* pPath )
+{
+  if( pPath )
+  {
+    free( pPath->m_pPoints );
+    free( pPath );
+  }
+}
+
+void gpath_move_to( GPath* pPath, GPoint point )
+{
+  pPath->m_offset = point;
+}
+
+void gpath_draw_filled( GContext* ctx, GPath* pPath )
+{
+  if( pPath->m_nPoints < 3 )
+  {
+    return;
+  }
+
+  int nMinY = pPath->m_pPoints[ 0 ].y;
+  int nMaxY = nMinY;
+
+  for( uint32_t nPoint = 1 ; nPoint < pPath->m_nPoints ; ++nPoint )
+  {
+    if( pPath->m_pPoints[ nPoint ].y < nMinY ) nMinY = pPath->m_pPoints[ nPoint ].y;
+    if( pPath->m_pPoints[ nPoint ].y > nMaxY ) nMaxY = pPath->m_pPoints[ nPoint ].y;
+  }
+
+  // Even-odd scanline fill in path space, then offset, so a path fills
+  // the same pixels wherever it is moved to
+  int vCrossings[ 32 ];
+
+  for( int y = nMinY ; y <= nMaxY ; ++y )
+  {
+    int nCrossings = 0;
+
+    for( uint32_t nPoint = 0 ; nPoint < pPath->m_nPoints ; ++nPoint )
+    {
+      GPoint a = pPath->m_pPoints[ nPoint ];
+      GPoint b = pPath->m_pPoints[ ( nPoint + 1 ) % pPath->m_nPoints ];
+
+      if(    ( a.y <= y && b.y > y )
+          || ( b.y <= y && a.y > y ) )
+      {
+        if( nCrossings < (int)ARRAY_LENGTH( vCrossings ) )
+        {
+          vCrossings[ nCrossings++ ] = a.x + ( y - a.y ) * ( b.x - a.x ) / ( b.y - a.y );
+        }
+      }
+    }
+
+    // Few crossings per row, insertion sort
+    for( int i = 1 ; i < nCrossings ; ++i )
+    {
+      int nValue = vCrossings[ i ];
+      int j = i - 1;
+
+      while( j >= 0 && vCrossings[ j ] > nValue )
+      {
+        vCrossings[ j + 1 ] = vCrossings[ j ];
+        --j;
+      }
+
+      vCrossings[ j + 1 ] = nValue;
+    }
+
+    for( int i = 0 ; i + 1 < nCrossings ; i += 2 )
+    {
+      for( int x = vCrossings[ i ] ; x <= vCrossings[ i + 1 ] ; ++x )
+      {
+        PutColour( ctx, x + pPath->m_offset.x, y + pPath->m_offset.y, ctx->m_eFillColour );
+      }
+    }
+  }
+}
+
+void gpath_draw_outline( GContext* ctx, GPath* pPath )
+{
+  for( uint32_t nPoint = 0 ; nPoint < pPath->m_nPoints ; ++nPoint )
+  {
+    GPoint a = pPath->m_pPoints[ nPoint ];
+    GPoint b = pPath->m_pPoints[ ( nPoint + 1 ) % pPath->m_nPoints ];
+
+    graphics_draw_line( ctx,
+                        GPoint( a.x + pPath->m_offset.x, a.y + pPath->m_offset.y ),
+                        GPoint( b.x + pPath->m_offset.x, b.y + pPath->m_offset.y ) );
+  }
+}
+
+// -------------------------------------------------------------------
+// Bitmaps
+//
+
+GBitmap* gbitmap_create_blank( GSize size, GBitmapFormat format )
+{
+  GBitmap* pBitmap = (GBitmap*)calloc( 1, sizeof( GBitmap ) );
+
+  pBitmap->m_nBytesPerRow = (uint16_t)( ( ( size.w + 31 ) / 32 ) * 4 );
+  pBitmap->m_pData = (uint8_t*)calloc( (size_t)size.h, pBitmap->m_nBytesPerRow );
+  pBitmap->m_bounds = GRect( 0, 0, size.w, size.h );
+  pBitmap->m_eFormat = format;
+  pBitmap->m_fOwnsData = true;
+
+  return pBitmap;
+}
+
+void gbitmap_destroy( GBitmap* pBitmap )
+{
+  if( pBitmap && pBitmap->m_fOwnsData )
+  {
+    free( pBitmap->m_pData );
+    free( pBitmap );
+  }
+}
+
+uint8_t* gbitmap_get_data( const GBitmap* pBitmap )
+{
+  return pBitmap->m_pData;
+}
+
+uint16_t gbitmap_get_bytes_per_row( const GBitmap* pBitmap )
+{
+  return pBitmap->m_nBytesPerRow;
+}
+
+GBitmapFormat gbitmap_get_format( const GBitmap* pBitmap )
+{
+  return pBitmap->m_eFormat;
+}
+
+GRect gbitmap_get_bounds( const GBitmap* pBitmap )
+{
+  return pBitmap->m_bounds;
+}
+
+// -------------------------------------------------------------------
+// Drawing
+//
+
+void graphics_context_set_fill_color( GContext* ctx, GColor color )
+{
+  ctx->m_eFillColour = color;
+}
+
+void graphics_context_set_stroke_color( GContext* ctx, GColor color )
+{
+  ctx->m_eStrokeColour = color;
+}
+
+void graphics_context_set_compositing_mode( GContext* ctx, GCompOp eCompOp )
+{
+  ctx->m_eCompOp = eCompOp;
+}
+
+void graphics_draw_pixel( GContext* ctx, GPoint point )
+{
+  PutColour( ctx, point.x, point.y, ctx->m_eStrokeColour );
+}
+
+void graphics_draw_line( GContext* ctx, GPoint from, GPoint to )
+{
+  // Bresenham, both ends included
+  int x = from.x;
+  int y = from.y;
+  int nDeltaX = abs( to.x - from.x );
+  int nDeltaY = -abs( to.y - from.y );
+  int nStepX = from.x < to.x ? 1 : -1;
+  int nStepY = from.y < to.y ? 1 : -1;
+  int nError = nDeltaX + nDeltaY;
+
+  for( ;; )
+  {
+    PutColour( ctx, x, y, ctx->m_eStrokeColour );
+
+    if( x == to.x && y == to.y )
+    {
+      break;
+    }
+
+    int nError2 = 2 * nError;
+
+    if( nError2 >= nDeltaY )
+    {
+      nError += nDeltaY;
+      x += nStepX;
+    }
+
+    if( nError2 <= nDeltaX )
+    {
+      nError += nDeltaX;
+      y += nStepY;
+    }
+  }
+}
+
+void graphics_fill_rect( GContext* ctx, GRect rect, uint16_t nCornerRadius, GCornerMask eCorners )
+{
+  (void)nCornerRadius;
+  (void)eCorners;
+
+  for( int y = rect.origin.y ; y < rect.origin.y + rect.size.h ; ++y )
+  {
+    for( int x = rect.origin.x ; x < rect.origin.x + rect.size.w ; ++x )
+    {
+      PutColour( ctx, x, y, ctx->m_eFillColour );
+    }
+  }
+}
+
+void graphics_draw_bitmap_in_rect( GContext* ctx, const GBitmap* pBitmap, GRect rect )
+{
+  int nWidth = rect.size.w < pBitmap->m_bounds.size.w ? rect.size.w : pBitmap->m_bounds.size.w;
+  int nHeight = rect.size.h < pBitmap->m_bounds.size.h ? rect.size.h : pBitmap->m_bounds.size.h;
+
+  for( int y = 0 ; y < nHeight ; ++y )
+  {
+    for( int x = 0 ; x < nWidth ; ++x )
+    {
+      int nDestX = rect.origin.x + x;
+      int nDestY = rect.origin.y + y;
+
+      if(    nDestX < 0
+          || nDestY < 0
+          || nDestX >= ctx->m_pTarget->m_bounds.size.w
+          || nDestY >= ctx->m_pTarget->m_bounds.size.h )
+      {
+        continue;
+      }
+
+      bool fSource = GetPixel( pBitmap, x, y );
+      bool fDest = GetPixel( ctx->m_pTarget, nDestX, nDestY );
+
+      switch( ctx->m_eCompOp )
+      {
+        case GCompOpAssign:         fDest = fSource;           break;
+        case GCompOpAssignInverted: fDest = ! fSource;         break;
+        case GCompOpOr:             fDest = fDest || fSource;  break;
+        case GCompOpAnd:            fDest = fDest && fSource;  break;
+        case GCompOpClear:          fDest = fDest && ! fSource; break;
+        case GCompOpSet:            fDest = fDest || ! fSource; break;
+      }
+
+      PutPixel( ctx->m_pTarget, nDestX, nDestY, fDest );
+    }
+  }
+}
+
+GBitmap* graphics_capture_frame_buffer( GContext* ctx )
+{
+  if( ctx->m_fCaptured )
+  {
+    return NULL;
+  }
+
+  ctx->m_fCaptured = true;
+
+  return ctx->m_pTarget;
+}
+
+bool graphics_release_frame_buffer( GContext* ctx, GBitmap* pBitmap )
+{
+  if( ! ctx->m_fCaptured || pBitmap != ctx->m_pTarget )
+  {
+    return false;
+  }
+
+  ctx->m_fCaptured = false;
+
+  return true;
+}
+
+// -------------------------------------------------------------------
+// Text
+//
+
+GFont fonts_get_system_font( const char* szFontKey )
+{
+  return szFontKey;
+}
+
+void graphics_context_set_text_color( GContext* ctx, GColor color )
+{
+  (void)ctx;
+  (void)color;
+}
+
+void graphics_draw_text( GContext* ctx,
+                         const char* szText,
+                         GFont font,
+                         GRect box,
+                         GTextOverflowMode eOverflowMode,
+                         GTextAlignment eAlignment,
+                         GTextAttributes* pAttributes )
+{
+  (void)ctx;
+  (void)szText;
+  (void)font;
+  (void)box;
+  (void)eOverflowMode;
+  (void)eAlignment;
+  (void)pAttributes;
+}
+
+// -------------------------------------------------------------------
+// Host only
+//
+
+GContext* host_graphics_context()
+{
+  return &g_hostContext;
+}
+
+GBitmap* host_screen_bitmap()
+{
+  return &g_hostScreenBitmap;
+}
+
+long host_pixel_writes()
+{
+  return g_nHostPixelWrites;
+}
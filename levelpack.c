@@ -0,0 +1,106 @@
+#include "levelpack.h"
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+static const uint8_t c_vLevelPackMagic[ 4 ] = { 'H', 'P', 'K', '1' };
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+static void WriteLE( uint8_t* pOut, uint64_t nValue, int nBytes )
+{
+  for( int nByte = 0 ; nByte < nBytes ; ++nByte )
+  {
+    pOut[ nByte ] = (uint8_t)( nValue >> ( nByte * 8 ) );
+  }
+}
+
+static uint64_t ReadLE( const uint8_t* pIn, int nBytes )
+{
+  uint64_t nValue = 0;
+
+  for( int nByte = 0 ; nByte < nBytes ; ++nByte )
+  {
+    nValue |= (uint64_t)pIn[ nByte ] << ( nByte * 8 );
+  }
+
+  return nValue;
+}
+
+void LevelPackWriteHeader( uint8_t* pHeader, uint32_t nLevels, uint32_t nSeed )
+{
+  for( int nByte = 0 ; nByte < 4 ; ++nByte )
+  {
+    pHeader[ nByte ] = c_vLevelPackMagic[ nByte ];
+  }
+
+  WriteLE( pHeader + 4, cnLevelPackVersion, 2 );
+  WriteLE( pHeader + 6, cnLevelPackRecordBytes, 2 );
+  WriteLE( pHeader + 8, nLevels, 4 );
+  WriteLE( pHeader + 12, nSeed, 4 );
+}
+
+bool LevelPackReadHeader( const uint8_t* pHeader, uint32_t* pnLevels )
+{
+  for( int nByte = 0 ; nByte < 4 ; ++nByte )
+  {
+    if( pHeader[ nByte ] != c_vLevelPackMagic[ nByte ] )
+    {
+      return false;
+    }
+  }
+
+  if(    ReadLE( pHeader + 4, 2 ) != cnLevelPackVersion
+      || ReadLE( pHeader + 6, 2 ) != cnLevelPackRecordBytes )
+  {
+    return false;
+  }
+
+  *pnLevels = (uint32_t)ReadLE( pHeader + 8, 4 );
+
+  return true;
+}
+
+void LevelPackWriteRecord( uint8_t* pRecord, const struct PackedLevel* pLevel )
+{
+  uint32_t nPositions =   ( pLevel->m_nPlayerX & 7u )
+                        | ( pLevel->m_nPlayerY & 7u ) << 3
+                        | ( pLevel->m_nExitX & 7u ) << 6
+                        | ( pLevel->m_nExitY & 7u ) << 9
+                        | ( pLevel->m_nNumberOfEnemies & 3u ) << 12;
+
+  for( int nEnemy = 0 ; nEnemy < pLevel->m_nNumberOfEnemies && nEnemy < cnLevelPackMaxEnemies ; ++nEnemy )
+  {
+    nPositions |= (   ( pLevel->m_vEnemyX[ nEnemy ] & 7u )
+                    | ( pLevel->m_vEnemyY[ nEnemy ] & 7u ) << 3 ) << ( 14 + nEnemy * 6 );
+  }
+
+  WriteLE( pRecord, pLevel->m_nLand, 8 );
+  WriteLE( pRecord + 8, pLevel->m_nGems, 8 );
+  WriteLE( pRecord + 16, nPositions, 4 );
+}
+
+void LevelPackReadRecord( const uint8_t* pRecord, struct PackedLevel* pLevel )
+{
+  uint32_t nPositions = (uint32_t)ReadLE( pRecord + 16, 4 );
+
+  pLevel->m_nLand = ReadLE( pRecord, 8 );
+  pLevel->m_nGems = ReadLE( pRecord + 8, 8 );
+
+  pLevel->m_nPlayerX = nPositions & 7;
+  pLevel->m_nPlayerY = ( nPositions >> 3 ) & 7;
+  pLevel->m_nExitX = ( nPositions >> 6 ) & 7;
+  pLevel->m_nExitY = ( nPositions >> 9 ) & 7;
+  pLevel->m_nNumberOfEnemies = ( nPositions >> 12 ) & 3;
+
+  for( int nEnemy = 0 ; nEnemy < cnLevelPackMaxEnemies ; ++nEnemy )
+  {
+    uint32_t nEnemyBits = nPositions >> ( 14 + nEnemy * 6 );
+
+    pLevel->m_vEnemyX[ nEnemy ] = nEnemyBits & 7;
+    pLevel->m_vEnemyY[ nEnemy ] = ( nEnemyBits >> 3 ) & 7;
+  }
+}
@@ -0,0 +1,62 @@
+#ifndef HOPPER_LEVELPACK_H
+#define HOPPER_LEVELPACK_H
+
+#include "bitboard.h"
+
+// -------------------------------------------------------------------
+// Level pack format
+//
+// Boards picked offline by tools/levelpack_gen.c and shipped as a raw
+// resource. All little endian :
+//
+//   header, cnLevelPackHeaderBytes
+//     0  magic "HPK1"
+//     4  uint16 version
+//     6  uint16 record size in bytes
+//     8  uint32 level count
+//     12 uint32 generator seed
+//
+//   records, cnLevelPackRecordBytes each, best board first
+//     0  uint64 land, bit x * 8 + y as in bitboard.h
+//     8  uint64 gems
+//     16 uint32 positions, 3 bits a coordinate : player x y, exit x y,
+//        then 2 bits of enemy count and x y for up to three enemies
+//
+// Records are all the same size so the record number is the index :
+// level n is one read of cnLevelPackRecordBytes at LevelPackOffset( n ).
+//
+
+#define cnLevelPackHeaderBytes 16
+#define cnLevelPackRecordBytes 20
+#define cnLevelPackVersion 1
+#define cnLevelPackMaxEnemies 3
+
+struct PackedLevel
+{
+  Bitboard m_nLand;
+  Bitboard m_nGems;
+
+  uint8_t m_nPlayerX;
+  uint8_t m_nPlayerY;
+  uint8_t m_nExitX;
+  uint8_t m_nExitY;
+
+  uint8_t m_nNumberOfEnemies;
+  uint8_t m_vEnemyX[ cnLevelPackMaxEnemies ];
+  uint8_t m_vEnemyY[ cnLevelPackMaxEnemies ];
+};
+
+static inline uint32_t LevelPackOffset( uint32_t nLevel )
+{
+  return cnLevelPackHeaderBytes + nLevel * cnLevelPackRecordBytes;
+}
+
+void LevelPackWriteHeader( uint8_t* pHeader, uint32_t nLevels, uint32_t nSeed );
+
+// False if this isn't a pack this code can read
+bool LevelPackReadHeader( const uint8_t* pHeader, uint32_t* pnLevels );
+
+void LevelPackWriteRecord( uint8_t* pRecord, const struct PackedLevel* pLevel );
+void LevelPackReadRecord( const uint8_t* pRecord, struct PackedLevel* pLevel );
+
+#endif // HOPPER_LEVELPACK_H
@@ -1,4 +1,18 @@
 #include <pebble.h>
+#include "bitboard.h"
+#include "pathing.h"
+#include "connectivity.h"
+#include "memtrack.h"
+#include "world_stream.h"
+#include "rng.h"
+#include "drawlist.h"
+#include "levelpack.h"
+#include "haptics.h"
+#include "analytics.h"
+#include "undo.h"
+#include "entitystore.h"
+#include "framememo.h"
+#include "framecapture.h"
 
 // -------------------------------------------------------------------// Globals
 //
@@ -6,7 +20,11 @@
 Window *my_window;
 Layer* g_pDrawingLayer;
 GPath* g_pIsometricBlock;
+GPath* g_pIsometricBlockTop;
+GPath* g_pIsometricBlockTopLeft;
+GPath* g_pIsometricBlockTopRight;
 GPath* g_pExitMarker;
+GPath* g_pDangerMarker;
 
 GBitmap* g_pBitmapPlayerNE_Sprite;
 GBitmap* g_pBitmapPlayerNW_Sprite;
@@ -31,9 +49,25 @@ GBitmap* g_pBitmapTreasureGem_Sprite;
 
 static const int c_nTileWidth = 16;
 static const int c_nTileHeight = 10;
-static const int c_nSpriteDimensionPx = 16;
+
+// Sprite ids registered with the draw list
+typedef enum
+{
+  eSpritePlayerNE = 0,
+  eSpritePlayerNW,
+  eSpritePlayerSE,
+  eSpritePlayerSW,
+  eSpriteEnemyUnit1,
+  eSpriteEnemyUnit2,
+  eSpriteEnemyUnit3,
+  eSpriteEnemyUnit4,
+  eSpriteTreasureGem
+} ESprite;
 
 static const uint32_t c_nHighScoreKey = 1009966;
+static const uint32_t c_nLevelPackKey = 1009967;
+static const uint32_t c_nAnalyticsRunKey = 1009968;
+static const uint32_t c_nAnalyticsLevelKey = 1009969;
 
 static const GPathInfo ISOBLOCK = {
   .num_points = 6,
@@ -45,6 +79,37 @@ static const GPathInfo ISOBLOCK = {
                           { 0, 9} }
 };
 
+// Cut down blocks for when the blocks in front hide one or both side
+// faces. Only ever filled, the draw list draws the edges still showing
+// a line at a time.
+static const GPathInfo ISOBLOCKTOP = {
+  .num_points = 4,
+  .points = (GPoint []) { { 0, 5 }, 
+                          { 8, 0}, 
+                          { 16, 5 }, 
+                          { 8, 10 } }
+};
+
+static const GPathInfo ISOBLOCKTOPLEFT = {
+  .num_points = 6,
+  .points = (GPoint []) { { 0, 5 }, 
+                          { 8, 0}, 
+                          { 16, 5 }, 
+                          { 8, 10 }, 
+                          { 8, 14 }, 
+                          { 0, 9} }
+};
+
+static const GPathInfo ISOBLOCKTOPRIGHT = {
+  .num_points = 6,
+  .points = (GPoint []) { { 0, 5 }, 
+                          { 8, 0}, 
+                          { 16, 5 }, 
+                          { 16, 9}, 
+                          { 8, 14 }, 
+                          { 8, 10 } }
+};
+
 static const GPathInfo EXITMARKER = {
   .num_points = 7,
   .points = (GPoint []) { { 1, 2 }, 
@@ -56,11 +121,13 @@ static const GPathInfo EXITMARKER = {
                           { 0, 4 } }
 };
 
-static const uint32_t const g_vibePatternBlockRemoved[] = { 200, 100, 50, 50 };
-
-VibePattern g_vibPatternBlockRemovedStruct = {
-  .durations = g_vibePatternBlockRemoved,
-  .num_segments = ARRAY_LENGTH(g_vibePatternBlockRemoved),
+// Inset diamond on the top face of a block, used to shade danger tiles
+static const GPathInfo DANGERMARKER = {
+  .num_points = 4,
+  .points = (GPoint []) { { 3, 5 }, 
+                          { 8, 2 }, 
+                          { 13, 5 }, 
+                          { 8, 8 } }
 };
 
 #define cnArrayWidth 8
@@ -74,8 +141,8 @@ typedef enum
   eTreasureGem = 3
 } EEntityType;
   
+// Gems and skeletons on each tile live in the entity store
 static bool g_nMap[ cnArrayWidth ][ cnArrayHeight ];
-static EEntityType g_nNonPlayerEntities[ cnArrayWidth ][ cnArrayHeight ];
 
 static const int c_nScoreStep = 10;
 static const int c_nScoreTreasure = 100;
@@ -83,6 +150,98 @@ static const int c_nScoreLandCreationPenalty = 100;
 
 static bool g_fBounceSpritesThisSecond = false;
 
+// Draw the map straight into the framebuffer with the blit kernels
+// instead of the SDK's path and bitmap calls. Off until it has been
+// checked against the SDK on a watch, so far the pixels have only been
+// matched against the host rasterizer ( bench/bench_blit.c ).
+static const bool c_fFramebufferBlit = false;
+
+// Keep the last two play view frames and copy one back when nothing on
+// screen has changed but the bounce
+static const bool c_fFrameMemo = true;
+
+// Record every frame shown as a capture stream ( see framecapture.h ),
+// sent to the phone through data logging under the tag "HCAP". Costs
+// about 7k of heap while it runs.
+static const bool c_fFrameCapture = false;
+static const uint32_t c_nFrameCaptureLogTag = 0x48434150;
+static DataLoggingSessionRef g_pFrameCaptureLog = NULL;
+
+// Top left pixel of each tile's block, worked out once at start up
+static GPoint g_vTileOriginPx[ cnArrayWidth ][ cnArrayHeight ];
+
+// Land mirrored as a bitboard so whole-map queries are a few shifts
+static Bitboard g_nLandBits = 0;
+
+// Danger overlay : tiles a skeleton could stand on within the next
+// c_nDangerLookaheadTicks ticks. Only rebuilt when enemies or land change.
+// Toggled with a flick of the wrist.
+static const int c_nDangerLookaheadTicks = 2;
+
+static bool g_fShowDangerMap = false;
+static bool g_fDangerMapDirty = true;
+static Bitboard g_nDangerBits = 0;
+
+// Auto hop : long press select walks the penguin to the nearest gem,
+// one hop per tick, using the precomputed next hop tables
+static const uint16_t c_nAutoHopHoldMs = 700;
+
+static bool g_fAutoHopActive = false;
+
+// Input : click handlers only queue commands, the queue is drained once
+// per frame so a burst of presses costs one repaint and at most one
+// buzz. Up and down repeat while held for fast rotation.
+typedef enum
+{
+  eCommandRotateUp = 0,
+  eCommandRotateDown = 1,
+  eCommandHop = 2,
+  eCommandUndo = 3
+} ECommand;
+
+#define cnCommandQueueSize 16
+
+static const uint32_t c_nCommandFrameMs = 33;
+static const uint16_t c_nRotateRepeatMs = 150;
+
+static ECommand g_vCommandQueue[ cnCommandQueueSize ];
+static int g_nCommandCount = 0;
+static AppTimer* g_pCommandDrainTimer = NULL;
+
+// Input burst stats, commands in versus repaints out
+static int g_nInputCommands = 0;
+static int g_nInputRepaints = 0;
+
+// Cut off detection : when a gem or the exit can no longer be reached we
+// either mark the tiles to build to get there or offer a reshuffle
+
+static bool g_fReachabilityDirty = true;
+static bool g_fLevelCutOff = false;
+static bool g_fCanAffordBridge = false;
+static Bitboard g_nBridgeHintBits = 0;
+
+// Endless mode : the 8x8 map becomes a view onto an unbounded world of
+// seeded chunks and scrolls to keep the penguin away from the edges
+static const int c_nEndlessEdgeMargin = 1;
+static const int c_nEndlessViewCentre = cnArrayWidth / 2;
+static const int c_nEndlessEnemies = 3;
+static const int c_nEndlessEnemyMinDistance = 3;
+
+static bool g_fEndlessMode = false;
+static int g_nViewOriginX = 0;
+static int g_nViewOriginY = 0;
+
+// Level pack : boards picked offline by tools/levelpack_gen.c. Every
+// c_nLevelPackEvery-th level comes from the pack, 0 deals every level
+// live and 1 plays the pack only. Live levels take the same draws from
+// the game's Rng either way, so a seed still deals the same live boards.
+static const int c_nLevelPackEvery = 2;
+
+static ResHandle g_hLevelPack = NULL;
+static uint32_t g_nLevelPackLevels = 0;
+static uint32_t g_nLevelPackNext = 0;
+static int g_nLevelsDealt = 0;
+
 typedef enum 
 {
   eEntityFacingNE = 0,
@@ -111,6 +270,9 @@ struct GameOptions
   bool m_fCanLevelBeExited;
   int m_nHighScore;
   bool m_fGameOver;
+  
+  // Every random decision in a game comes from here
+  struct Rng m_rng;
 };
 
 static struct GameOptions g_gameOptions;
@@ -122,22 +284,25 @@ static struct GameOptions g_gameOptions;
 void DrawIsoTiles( GContext* ctx );
 void display_layer_update_callback(Layer* pLayer, GContext* ctx);
 void GenerateNewMap();
+void LoadLevelPack();
+bool LoadPackedLevel();
+void GenerateLiveLevel();
 static void tick_handler(struct tm *tick_time, TimeUnits units_changed);
 void config_provider(Window* pWindow) ;
-void select_single_click_handler( ClickRecognizerRef recognizer, void *context );
 void down_single_click_handler( ClickRecognizerRef recognizer, void *context );
 void middle_single_click_handler( ClickRecognizerRef recognizer, void *context );
 void up_single_click_handler( ClickRecognizerRef recognizer, void *context );
 void UpdatePlayerDirectionFacing( bool fUp );
-void DrawTileEntity( EEntityType eType, 
-                     int nXPx, 
-                     int nYPx, 
+int GetEntitySprite( EEntityType eType, 
                      EEntityDirectionFacing eDirectionFacing, 
-                     GContext* ctx );
-void HandlePlayerMove();
+                     int* pnYBounceMassage );
+void InitProjection();
+bool HandlePlayerMove();
 void DrawHUD( GContext* ctx );
+uint64_t FrameStateKey();
+void StartFrameCapture();
+void CaptureFrame( GContext* ctx );
 bool CheckIfLevelIsComplete();
-bool IsTreasure( EEntityType eEntityType );
 void HandleEnemyUnitMove( int* nXPos, 
                           int* nYPos, 
                          EEntityDirectionFacing* peDirectionFacing );
@@ -151,6 +316,25 @@ bool HandleEntityMove( int nEntityXCoord,
 void TickEnemyUnits();
 void DrawGameOverScreen( GContext* ctx );
 void ResetGame();
+void SetLandTile( int x, int y, bool fLand );
+void UpdateDangerMap();
+void accel_tap_handler( AccelAxisType axis, int32_t direction );
+void EnqueueCommand( ECommand eCommand );
+void DrainCommandQueue( void* pData );
+void InputLogSummary();
+void middle_long_click_handler( ClickRecognizerRef recognizer, void *context );
+Bitboard GetTreasureBits();
+void AutoHopStep();
+void UpdateReachability();
+void StartEndlessGame();
+void LoadEndlessView();
+void ScrollEndlessView();
+void SpawnEndlessEnemies();
+void GetDisanceAndDirectionToPlayer( int nXPx, int nYPx, EEntityDirectionFacing* peDirection, int* pnDistance );
+void back_single_click_handler( ClickRecognizerRef recognizer, void *context );
+void TakeUndoSnapshot( bool fAfterHop );
+bool UndoLastHop();
+void PlaceEnemyEntities();
 
 // -------------------------------------------------------------------
 // Functions
@@ -162,7 +346,7 @@ void handle_init(void)
   // Create window
   //
   
-  my_window = window_create();
+  my_window = MemTrackWindowCreate();
   window_set_background_color(my_window, GColorBlack);
   window_stack_push(my_window, true);
   
@@ -173,7 +357,7 @@ void handle_init(void)
   Layer *root_layer = window_get_root_layer(my_window);
   GRect frame = layer_get_frame(root_layer);
 
-  g_pDrawingLayer = layer_create(frame);
+  g_pDrawingLayer = MemTrackLayerCreate(frame);
   layer_set_update_proc(g_pDrawingLayer, &display_layer_update_callback);
   layer_add_child(root_layer, g_pDrawingLayer);
   
@@ -181,14 +365,36 @@ void handle_init(void)
   //  Create polygon definition
   //
   
-  g_pIsometricBlock = gpath_create( &ISOBLOCK );
-  g_pExitMarker = gpath_create( &EXITMARKER );
+  g_pIsometricBlock = MemTrackPathCreate( &ISOBLOCK );
+  g_pIsometricBlockTop = MemTrackPathCreate( &ISOBLOCKTOP );
+  g_pIsometricBlockTopLeft = MemTrackPathCreate( &ISOBLOCKTOPLEFT );
+  g_pIsometricBlockTopRight = MemTrackPathCreate( &ISOBLOCKTOPRIGHT );
+  g_pExitMarker = MemTrackPathCreate( &EXITMARKER );
+  g_pDangerMarker = MemTrackPathCreate( &DANGERMARKER );
+  
+  DrawListInit( g_pIsometricBlock, 
+                g_pIsometricBlockTop,
+                g_pIsometricBlockTopLeft,
+                g_pIsometricBlockTopRight,
+                g_pExitMarker, 
+                g_pDangerMarker );
+  DrawListSetFramebufferBlit( c_fFramebufferBlit );
+  FrameMemoSetEnabled( c_fFrameMemo );
+  
+  if( c_fFrameCapture )
+  {
+    StartFrameCapture();
+  }
+  
+  InitProjection();
+  HapticsInit();
   
   //
   //  Initialise contents of map
   //
   
-  srand( time( NULL ) );
+  LoadLevelPack();
+  RngSeed( &g_gameOptions.m_rng, (uint64_t)time( NULL ) );
   GenerateNewMap();
   
   //
@@ -201,30 +407,40 @@ void handle_init(void)
   //  Register graphics resources
   //
   
-  g_pBitmapPlayerNE_Sprite = gbitmap_create_with_resource( RESOURCE_ID_img_penguin_ne_sprite );
-  g_pBitmapPlayerNE_Mask = gbitmap_create_with_resource( RESOURCE_ID_img_penguin_ne_mask );
+  g_pBitmapPlayerNE_Sprite = MemTrackBitmapCreateWithResource( RESOURCE_ID_img_penguin_ne_sprite );
+  g_pBitmapPlayerNE_Mask = MemTrackBitmapCreateWithResource( RESOURCE_ID_img_penguin_ne_mask );
   
-  g_pBitmapPlayerNW_Sprite = gbitmap_create_with_resource( RESOURCE_ID_img_penguin_nw_sprite );
-  g_pBitmapPlayerNW_Mask = gbitmap_create_with_resource( RESOURCE_ID_img_penguin_nw_mask );
+  g_pBitmapPlayerNW_Sprite = MemTrackBitmapCreateWithResource( RESOURCE_ID_img_penguin_nw_sprite );
+  g_pBitmapPlayerNW_Mask = MemTrackBitmapCreateWithResource( RESOURCE_ID_img_penguin_nw_mask );
    
-  g_pBitmapPlayerSW_Sprite = gbitmap_create_with_resource( RESOURCE_ID_img_penguin_sw_sprite );
-  g_pBitmapPlayerSW_Mask = gbitmap_create_with_resource( RESOURCE_ID_img_penguin_sw_mask );
+  g_pBitmapPlayerSW_Sprite = MemTrackBitmapCreateWithResource( RESOURCE_ID_img_penguin_sw_sprite );
+  g_pBitmapPlayerSW_Mask = MemTrackBitmapCreateWithResource( RESOURCE_ID_img_penguin_sw_mask );
  
-  g_pBitmapPlayerSE_Sprite = gbitmap_create_with_resource( RESOURCE_ID_img_penguin_se_sprite );
-  g_pBitmapPlayerSE_Mask = gbitmap_create_with_resource( RESOURCE_ID_img_penguin_se_mask );
-  
-  g_pBitmapEnemyUnit1_Sprite = gbitmap_create_with_resource( RESOURCE_ID_enemy_skeleton_se_sprite_1 );
-  g_pBitmapEnemyUnit1_Mask = gbitmap_create_with_resource( RESOURCE_ID_enemy_skeleton_se_mask_1 );
-  g_pBitmapEnemyUnit2_Sprite = gbitmap_create_with_resource( RESOURCE_ID_enemy_skeleton_se_sprite_2 );
-  g_pBitmapEnemyUnit2_Mask = gbitmap_create_with_resource( RESOURCE_ID_enemy_skeleton_se_mask_2 );
-  
-  g_pBitmapEnemyUnit3_Sprite = gbitmap_create_with_resource( RESOURCE_ID_enemy_skeleton_sw_sprite_1 );
-  g_pBitmapEnemyUnit3_Mask = gbitmap_create_with_resource( RESOURCE_ID_enemy_skeleton_sw_mask_1 );
-  g_pBitmapEnemyUnit4_Sprite = gbitmap_create_with_resource( RESOURCE_ID_enemy_skeleton_sw_sprite_2 );
-  g_pBitmapEnemyUnit4_Mask = gbitmap_create_with_resource( RESOURCE_ID_enemy_skeleton_sw_mask_2 );
+  g_pBitmapPlayerSE_Sprite = MemTrackBitmapCreateWithResource( RESOURCE_ID_img_penguin_se_sprite );
+  g_pBitmapPlayerSE_Mask = MemTrackBitmapCreateWithResource( RESOURCE_ID_img_penguin_se_mask );
+  
+  g_pBitmapEnemyUnit1_Sprite = MemTrackBitmapCreateWithResource( RESOURCE_ID_enemy_skeleton_se_sprite_1 );
+  g_pBitmapEnemyUnit1_Mask = MemTrackBitmapCreateWithResource( RESOURCE_ID_enemy_skeleton_se_mask_1 );
+  g_pBitmapEnemyUnit2_Sprite = MemTrackBitmapCreateWithResource( RESOURCE_ID_enemy_skeleton_se_sprite_2 );
+  g_pBitmapEnemyUnit2_Mask = MemTrackBitmapCreateWithResource( RESOURCE_ID_enemy_skeleton_se_mask_2 );
+  
+  g_pBitmapEnemyUnit3_Sprite = MemTrackBitmapCreateWithResource( RESOURCE_ID_enemy_skeleton_sw_sprite_1 );
+  g_pBitmapEnemyUnit3_Mask = MemTrackBitmapCreateWithResource( RESOURCE_ID_enemy_skeleton_sw_mask_1 );
+  g_pBitmapEnemyUnit4_Sprite = MemTrackBitmapCreateWithResource( RESOURCE_ID_enemy_skeleton_sw_sprite_2 );
+  g_pBitmapEnemyUnit4_Mask = MemTrackBitmapCreateWithResource( RESOURCE_ID_enemy_skeleton_sw_mask_2 );
     
-  g_pBitmapTreasureGem_Mask = gbitmap_create_with_resource( RESOURCE_ID_img_treasuregem_mask );
-  g_pBitmapTreasureGem_Sprite = gbitmap_create_with_resource( RESOURCE_ID_img_treasuregem_sprite );
+  g_pBitmapTreasureGem_Mask = MemTrackBitmapCreateWithResource( RESOURCE_ID_img_treasuregem_mask );
+  g_pBitmapTreasureGem_Sprite = MemTrackBitmapCreateWithResource( RESOURCE_ID_img_treasuregem_sprite );
+  
+  DrawListSetSprite( eSpritePlayerNE, g_pBitmapPlayerNE_Mask, g_pBitmapPlayerNE_Sprite );
+  DrawListSetSprite( eSpritePlayerNW, g_pBitmapPlayerNW_Mask, g_pBitmapPlayerNW_Sprite );
+  DrawListSetSprite( eSpritePlayerSE, g_pBitmapPlayerSE_Mask, g_pBitmapPlayerSE_Sprite );
+  DrawListSetSprite( eSpritePlayerSW, g_pBitmapPlayerSW_Mask, g_pBitmapPlayerSW_Sprite );
+  DrawListSetSprite( eSpriteEnemyUnit1, g_pBitmapEnemyUnit1_Mask, g_pBitmapEnemyUnit1_Sprite );
+  DrawListSetSprite( eSpriteEnemyUnit2, g_pBitmapEnemyUnit2_Mask, g_pBitmapEnemyUnit2_Sprite );
+  DrawListSetSprite( eSpriteEnemyUnit3, g_pBitmapEnemyUnit3_Mask, g_pBitmapEnemyUnit3_Sprite );
+  DrawListSetSprite( eSpriteEnemyUnit4, g_pBitmapEnemyUnit4_Mask, g_pBitmapEnemyUnit4_Sprite );
+  DrawListSetSprite( eSpriteTreasureGem, g_pBitmapTreasureGem_Mask, g_pBitmapTreasureGem_Sprite );
       
   //
   // Register with the click handler
@@ -232,6 +448,9 @@ void handle_init(void)
   
   window_set_click_config_provider( my_window, (ClickConfigProvider) config_provider);
   
+  // A wrist flick toggles the danger overlay
+  accel_tap_service_subscribe( accel_tap_handler );
+  
   //
   // Grab high score
   //
@@ -245,6 +464,8 @@ void handle_init(void)
     g_gameOptions.m_nHighScore = 0;
   }
   
+  AnalyticsLoad( c_nAnalyticsRunKey, c_nAnalyticsLevelKey );
+  
   ResetGame();
 }
 
@@ -259,59 +480,482 @@ void ResetGame()
   }
   
   g_gameOptions.m_nScore = 0;
+  g_fEndlessMode = false;
+  
+  AnalyticsStartRun( g_gameOptions.m_nScore );
   
   GenerateNewMap();
 }
 
+void StartEndlessGame()
+{
+  ResetGame();
+  
+  g_fEndlessMode = true;
+  
+  // The streamed world isn't in the snapshots, no undo in endless mode
+  UndoClear();
+  
+  WorldStreamInit( RngNext( &g_gameOptions.m_rng ) );
+  
+  // World cell ( 0, 0 ) starts in the middle of the view
+  g_nViewOriginX = -c_nEndlessViewCentre;
+  g_nViewOriginY = -c_nEndlessViewCentre;
+  
+  g_gameOptions.m_playerObj.m_nX = c_nEndlessViewCentre;
+  g_gameOptions.m_playerObj.m_nY = c_nEndlessViewCentre;
+  g_gameOptions.m_playerObj.m_eDirectionFacing = eEntityFacingSE;
+  
+  g_gameOptions.m_nNumberOfEnemies = 0;
+  
+  LoadEndlessView();
+  
+  // Never start in the sea
+  if( ! g_nMap[ c_nEndlessViewCentre ][ c_nEndlessViewCentre ] )
+  {
+    SetLandTile( c_nEndlessViewCentre, c_nEndlessViewCentre, true );
+  }
+  
+  SpawnEndlessEnemies();
+}
+
+void LoadEndlessView()
+{
+  Bitboard nGemBits = 0;
+  
+  WorldStreamReadView( g_nViewOriginX, g_nViewOriginY, &g_nLandBits, &nGemBits );
+  
+  for( int x = 0 ; x < cnArrayWidth ; ++x )  
+  {
+    for( int y = 0 ; y < cnArrayHeight ; ++y )  
+    {
+      g_nMap[ x ][ y ] = BitboardTest( g_nLandBits, x, y );
+    }
+  }
+  
+  EntityStoreSetKindCells( eEntityKindGem, nGemBits, 0 );
+  PlaceEnemyEntities();
+  
+  PathingRebuild( g_nLandBits );
+  ConnectivityRebuild( g_nLandBits );
+  
+  g_fAutoHopActive = false;
+  g_fDangerMapDirty = true;
+  g_fReachabilityDirty = true;
+}
+
+void ScrollEndlessView()
+{
+  int nPlayerX = g_gameOptions.m_playerObj.m_nX;
+  int nPlayerY = g_gameOptions.m_playerObj.m_nY;
+  
+  if(    nPlayerX >= c_nEndlessEdgeMargin
+      && nPlayerX < cnArrayWidth - c_nEndlessEdgeMargin
+      && nPlayerY >= c_nEndlessEdgeMargin
+      && nPlayerY < cnArrayHeight - c_nEndlessEdgeMargin )
+  {
+    return;
+  }
+  
+  // Hand the current view back to the world before moving
+  WorldStreamWriteView( g_nViewOriginX, g_nViewOriginY, g_nLandBits, GetTreasureBits() );
+  
+  int nShiftX = nPlayerX - c_nEndlessViewCentre;
+  int nShiftY = nPlayerY - c_nEndlessViewCentre;
+  
+  g_nViewOriginX += nShiftX;
+  g_nViewOriginY += nShiftY;
+  
+  g_gameOptions.m_playerObj.m_nX -= nShiftX;
+  g_gameOptions.m_playerObj.m_nY -= nShiftY;
+  
+  // Skeletons that scroll out of view are left behind
+  int nKept = 0;
+  
+  for( int nEnemy = 0 ; nEnemy < g_gameOptions.m_nNumberOfEnemies ; ++nEnemy )
+  {
+    struct EntityPos enemy = g_gameOptions.m_enemiesArray[ nEnemy ];
+    
+    enemy.m_nX -= nShiftX;
+    enemy.m_nY -= nShiftY;
+    
+    if(    enemy.m_nX >= 0
+        && enemy.m_nX < cnArrayWidth
+        && enemy.m_nY >= 0
+        && enemy.m_nY < cnArrayHeight )
+    {
+      g_gameOptions.m_enemiesArray[ nKept++ ] = enemy;
+    }
+  }
+  
+  g_gameOptions.m_nNumberOfEnemies = nKept;
+  
+  LoadEndlessView();
+  SpawnEndlessEnemies();
+}
+
+void SpawnEndlessEnemies()
+{
+  // A few goes at finding empty land a safe distance from the player
+  for( int nAttempt = 0 ; nAttempt < 16 && g_gameOptions.m_nNumberOfEnemies < c_nEndlessEnemies ; ++nAttempt )
+  {
+    int nEnemyXPos = RngBelow( &g_gameOptions.m_rng, cnArrayWidth );
+    int nEnemyYPos = RngBelow( &g_gameOptions.m_rng, cnArrayHeight );
+    
+    EEntityDirectionFacing eDirection = eEntityFacingNE;
+    int nDistanceToPlayer = 0;
+    
+    GetDisanceAndDirectionToPlayer( nEnemyXPos, nEnemyYPos, &eDirection, &nDistanceToPlayer );
+    
+    if(    ! g_nMap[ nEnemyXPos ][ nEnemyYPos ]
+        || EntityStoreCellMask( nEnemyXPos, nEnemyYPos ) != 0
+        || nDistanceToPlayer < c_nEndlessEnemyMinDistance )
+    {
+      continue;
+    }
+    
+    struct EntityPos* pEnemy = &g_gameOptions.m_enemiesArray[ g_gameOptions.m_nNumberOfEnemies++ ];
+    
+    pEnemy->m_nX = nEnemyXPos;
+    pEnemy->m_nY = nEnemyYPos;
+    pEnemy->m_eDirectionFacing = eDirection;
+    
+    EntityStoreAdd( eEntityKindEnemy, nEnemyXPos, nEnemyYPos, (uint8_t)eDirection );
+  }
+  
+  g_fDangerMapDirty = true;
+}
+
 void config_provider(Window* pWindow) 
 {
   // single click registrations for callback
   
-  window_single_click_subscribe(BUTTON_ID_DOWN, down_single_click_handler);
+  // up and down repeat while held so the penguin can spin quickly
+  window_single_repeating_click_subscribe(BUTTON_ID_DOWN, c_nRotateRepeatMs, down_single_click_handler);
   window_single_click_subscribe(BUTTON_ID_SELECT, middle_single_click_handler);
-  window_single_click_subscribe(BUTTON_ID_UP, up_single_click_handler);
+  window_single_repeating_click_subscribe(BUTTON_ID_UP, c_nRotateRepeatMs, up_single_click_handler);
+  
+  // long press select auto hops towards the nearest gem, or reshuffles
+  // a level that has been cut off
+  window_long_click_subscribe(BUTTON_ID_SELECT, c_nAutoHopHoldMs, middle_long_click_handler, NULL);
+  
+  // back undoes the last hop, and quits as usual once there's nothing
+  // left to undo
+  window_single_click_subscribe(BUTTON_ID_BACK, back_single_click_handler);
 }
 
 void down_single_click_handler( ClickRecognizerRef recognizer, void *context ) 
 {
-  Window *window = (Window *)context;
+  g_fAutoHopActive = false;
+  
+  EnqueueCommand( eCommandRotateDown );
+}
+
+void middle_single_click_handler( ClickRecognizerRef recognizer, void *context ) 
+{
+  g_fAutoHopActive = false;
+  
+  EnqueueCommand( eCommandHop );
+}
+
+void up_single_click_handler( ClickRecognizerRef recognizer, void *context ) 
+{
+  g_fAutoHopActive = false;
+  
+  EnqueueCommand( eCommandRotateUp );
+}
+
+void back_single_click_handler( ClickRecognizerRef recognizer, void *context ) 
+{
+  if(    g_gameOptions.m_fGameOver
+      || ( UndoHopsAvailable() == 0 && g_nCommandCount == 0 ) )
+  {
+    window_stack_pop( true );
+    return;
+  }
   
+  EnqueueCommand( eCommandUndo );
+}
+
+void accel_tap_handler( AccelAxisType axis, int32_t direction )
+{
   if( ! g_gameOptions.m_fGameOver )
   {
-    UpdatePlayerDirectionFacing( false );
+    g_fShowDangerMap = ! g_fShowDangerMap;
+    layer_mark_dirty( g_pDrawingLayer );
   }
-  else
+}
+
+void EnqueueCommand( ECommand eCommand )
+{
+  if( g_nCommandCount < cnCommandQueueSize )
   {
-    ResetGame();
+    g_vCommandQueue[ g_nCommandCount++ ] = eCommand;
+    ++g_nInputCommands;
+  }
+  
+  if( ! g_pCommandDrainTimer )
+  {
+    g_pCommandDrainTimer = app_timer_register( c_nCommandFrameMs, DrainCommandQueue, NULL );
   }
 }
 
-void middle_single_click_handler( ClickRecognizerRef recognizer, void *context ) 
+void DrainCommandQueue( void* pData )
 {
-  Window *window = (Window *)context;
+  g_pCommandDrainTimer = NULL;
   
-  if( ! g_gameOptions.m_fGameOver )
+  if( g_nCommandCount == 0 )
   {
-    HandlePlayerMove();
+    return;
   }
-  else
+  
+  if( g_gameOptions.m_fGameOver )
   {
+    // Any key plays again, however many were pressed
     ResetGame();
   }
+  else
+  {
+    // Rotations in a row collapse to a net turn, applied just before the
+    // next hop so each hop still goes the way the player was facing
+    int nNetTurns = 0;
+    bool fHopBlocked = false;
+    
+    for( int nCommand = 0 ; nCommand < g_nCommandCount && ! g_gameOptions.m_fGameOver ; ++nCommand )
+    {
+      switch( g_vCommandQueue[ nCommand ] )
+      {
+        case eCommandRotateUp:
+          ++nNetTurns;
+          break;
+        
+        case eCommandRotateDown:
+          --nNetTurns;
+          break;
+        
+        case eCommandHop:
+          nNetTurns %= 4;
+          
+          for( ; nNetTurns > 0 ; --nNetTurns )
+          {
+            UpdatePlayerDirectionFacing( true );
+          }
+          
+          for( ; nNetTurns < 0 ; ++nNetTurns )
+          {
+            UpdatePlayerDirectionFacing( false );
+          }
+          
+          if( ! HandlePlayerMove() )
+          {
+            fHopBlocked = true;
+          }
+          break;
+        
+        case eCommandUndo:
+          // The snapshot has the facing, turns queued before the undo are moot
+          nNetTurns = 0;
+          g_fAutoHopActive = false;
+          UndoLastHop();
+          break;
+      }
+    }
+    
+    nNetTurns %= 4;
+    
+    for( ; nNetTurns > 0 ; --nNetTurns )
+    {
+      UpdatePlayerDirectionFacing( true );
+    }
+    
+    for( ; nNetTurns < 0 ; ++nNetTurns )
+    {
+      UpdatePlayerDirectionFacing( false );
+    }
+    
+    if( fHopBlocked )
+    {
+      HapticsRequest( eHapticHopBlocked );
+    }
+  }
+  
+  ++g_nInputRepaints;
+  
+  g_nCommandCount = 0;
+  
+  HapticsFlush();
+  layer_mark_dirty( g_pDrawingLayer );
 }
 
-void up_single_click_handler( ClickRecognizerRef recognizer, void *context ) 
+void InputLogSummary()
 {
-  Window *window = (Window *)context;
-  
-  if( ! g_gameOptions.m_fGameOver )
+  // Hundredths, there's no float formatting on the watch
+  int nPerRepaint = g_nInputRepaints ? g_nInputCommands * 100 / g_nInputRepaints : 0;
+  
+  APP_LOG( APP_LOG_LEVEL_INFO,
+           "input : %d commands in %d bursts, one repaint each, %d.%02d commands per repaint",
+           g_nInputCommands,
+           g_nInputRepaints,
+           nPerRepaint / 100,
+           nPerRepaint % 100 );
+}
+
+void middle_long_click_handler( ClickRecognizerRef recognizer, void *context ) 
+{
+  if( g_gameOptions.m_fGameOver )
   {
-    UpdatePlayerDirectionFacing( true );
+    StartEndlessGame();
+    layer_mark_dirty( g_pDrawingLayer );
   }
   else
   {
-    ResetGame();
+    UpdateReachability();
+    
+    if(    g_fLevelCutOff
+        && ! g_fCanAffordBridge )
+    {
+      // Level can't be finished, deal a new one but keep the score
+      AnalyticsEndLevel( g_gameOptions.m_nScore );
+      GenerateNewMap();
+      layer_mark_dirty( g_pDrawingLayer );
+      return;
+    }
+    
+    g_fAutoHopActive = true;
+    
+    // Take the first hop straight away, the rest follow on the tick
+    AutoHopStep();
+    HapticsFlush();
+  }
+}
+
+void SetLandTile( int x, int y, bool fLand )
+{
+  g_nMap[ x ][ y ] = fLand;
+  g_nLandBits = BitboardSet( g_nLandBits, x, y, fLand );
+  
+  PathingOnTileChanged( g_nLandBits, x, y, fLand );
+  ConnectivitySetTile( g_nLandBits, x, y, fLand );
+  
+  g_fDangerMapDirty = true;
+  g_fReachabilityDirty = true;
+}
+
+void UpdateReachability()
+{
+  if( ! g_fReachabilityDirty )
+  {
+    return;
+  }
+  
+  if( g_fEndlessMode )
+  {
+    // There is always more world past the edge of the view
+    g_fLevelCutOff = false;
+    g_nBridgeHintBits = 0;
+    g_fReachabilityDirty = false;
+    return;
+  }
+  
+  Bitboard nReachable = ConnectivityReachableFrom( g_nLandBits,
+                                                   g_gameOptions.m_playerObj.m_nX,
+                                                   g_gameOptions.m_playerObj.m_nY );
+  
+  Bitboard nTargets = GetTreasureBits() 
+                    | BitboardCell( g_gameOptions.m_exitObj.m_nX, g_gameOptions.m_exitObj.m_nY );
+  
+  Bitboard nCutOff = nTargets & ~nReachable;
+  
+  g_fLevelCutOff = ( nCutOff != 0 );
+  g_nBridgeHintBits = ConnectivityFindBridge( g_nLandBits, nReachable, nCutOff );
+  
+  // Land costs score, only point at a bridge the player can pay for
+  g_fCanAffordBridge =    g_nBridgeHintBits
+                       && g_gameOptions.m_nScore >= BitboardCount( g_nBridgeHintBits ) * c_nScoreLandCreationPenalty;
+  
+  if( ! g_fCanAffordBridge )
+  {
+    g_nBridgeHintBits = 0;
+  }
+  
+  g_fReachabilityDirty = false;
+}
+
+Bitboard GetTreasureBits()
+{
+  return EntityStoreCells( eEntityKindGem );
+}
+
+void AutoHopStep()
+{
+  int nTargetX = 0;
+  int nTargetY = 0;
+  int nDirection = 0;
+  
+  bool fFound = PathingFindNearest( g_nLandBits,
+                                    g_gameOptions.m_playerObj.m_nX,
+                                    g_gameOptions.m_playerObj.m_nY,
+                                    GetTreasureBits(),
+                                    &nTargetX,
+                                    &nTargetY );
+  
+  if(    ! fFound 
+      || ! PathingNextHop( g_gameOptions.m_playerObj.m_nX,
+                           g_gameOptions.m_playerObj.m_nY,
+                           nTargetX,
+                           nTargetY,
+                           &nDirection ) )
+  {
+    // Nothing left we can get to
+    g_fAutoHopActive = false;
+    HapticsRequest( eHapticHopBlocked );
+    return;
+  }
+  
+  g_gameOptions.m_playerObj.m_eDirectionFacing = (EEntityDirectionFacing)nDirection;
+  
+  if( ! HandlePlayerMove() )
+  {
+    // Something is standing on the next tile, stop rather than buzz every tick
+    g_fAutoHopActive = false;
+    HapticsRequest( eHapticHopBlocked );
+  }
+  
+  if(    g_gameOptions.m_playerObj.m_nX == nTargetX
+      && g_gameOptions.m_playerObj.m_nY == nTargetY )
+  {
+    // Arrived, hand control back to the player
+    g_fAutoHopActive = false;
+  }
+  
+  layer_mark_dirty( g_pDrawingLayer );
+}
+
+void UpdateDangerMap()
+{
+  if( ! g_fDangerMapDirty )
+  {
+    return;
+  }
+  
+  Bitboard nEnemyBits = 0;
+  
+  for( int nEnemy = 0 ; nEnemy < g_gameOptions.m_nNumberOfEnemies ; ++nEnemy )
+  {
+    nEnemyBits |= BitboardCell( g_gameOptions.m_enemiesArray[ nEnemy ].m_nX,
+                                g_gameOptions.m_enemiesArray[ nEnemy ].m_nY );
   }
+  
+  // Each tick a skeleton may stay put or hop once onto land
+  Bitboard nReach = nEnemyBits;
+  
+  for( int nTick = 0 ; nTick < c_nDangerLookaheadTicks ; ++nTick )
+  {
+    nReach = BitboardDilate( nReach, g_nLandBits );
+  }
+  
+  g_nDangerBits = nReach | nEnemyBits;
+  g_fDangerMapDirty = false;
 }
 
 bool HandleEntityMove( int nEntityXCoord, 
@@ -342,8 +986,6 @@ bool HandleEntityMove( int nEntityXCoord,
       break;
   }
   
-  bool fMoveLegal = g_nMap[ nEntityXCoord ][ nEntityYCoord ];
-  
   if(    nEntityXCoord < 0
       || nEntityXCoord == cnArrayWidth
       || nEntityYCoord < 0
@@ -353,6 +995,8 @@ bool HandleEntityMove( int nEntityXCoord,
     return false;
   }
   
+  bool fMoveLegal = g_nMap[ nEntityXCoord ][ nEntityYCoord ];
+  
   if(    ! fMoveLegal 
       && nEntityXCoord >= 0
       && nEntityXCoord < cnArrayWidth
@@ -361,19 +1005,18 @@ bool HandleEntityMove( int nEntityXCoord,
       && fCreateNewLandIfInvalidMove )
   {
     // Create new land
-    g_nMap[ nEntityXCoord ][ nEntityYCoord ] = true;
+    SetLandTile( nEntityXCoord, nEntityYCoord, true );
     fMoveLegal = true;
     
     g_gameOptions.m_nScore -= c_nScoreLandCreationPenalty;
+    AnalyticsCount( eAnalyticsLandCreated );
   }
   
   if( fMoveLegal )
   {
     // Move legal because position exisits
     
-    EEntityType eEntityAtDestination = g_nNonPlayerEntities[ nEntityXCoord ][ nEntityYCoord ];
-    
-    if( eEntityAtDestination == eEntityEnemy )
+    if( EntityStoreHas( eEntityKindEnemy, nEntityXCoord, nEntityYCoord ) )
     {
       // Stop enemies merging and players walking in to enemies
       return false;
@@ -399,7 +1042,7 @@ void TickEnemyUnits()
 {
   for( int nEnemy = 0 ; nEnemy < g_gameOptions.m_nNumberOfEnemies ; ++nEnemy )
   {
-    bool fMove = ( rand() % 2 == 0 );
+    bool fMove = ( RngNext( &g_gameOptions.m_rng ) & 1 ) == 0;
     
     if( fMove )
     {
@@ -410,6 +1053,12 @@ void TickEnemyUnits()
                            &g_gameOptions.m_enemiesArray[ nEnemy ].m_eDirectionFacing );
     }
   }
+  
+  if(    ! g_fEndlessMode
+      && ! g_gameOptions.m_fGameOver )
+  {
+    TakeUndoSnapshot( false );
+  }
 }
 
 void GetDisanceAndDirectionToPlayer( int nXPx, int nYPx, EEntityDirectionFacing* peDirection, int* pnDistance )
@@ -449,11 +1098,11 @@ void HandleEnemyUnitMove( int* pnXPos, int* pnYPos, EEntityDirectionFacing* peDi
   int nOldPosX = *pnXPos;
   int nOldPosY = *pnYPos;
   
-  bool fChangeDirection = rand() % 3 == 0;
+  bool fChangeDirection = RngBelow( &g_gameOptions.m_rng, 3 ) == 0;
   
   if( fChangeDirection )
   {
-    *peDirectionFacing = (EEntityDirectionFacing)( rand() & (int)eEntityFacingSW );
+    *peDirectionFacing = (EEntityDirectionFacing)( RngNext( &g_gameOptions.m_rng ) & (int)eEntityFacingSW );
   }
   
   // See if the player is nearby
@@ -479,22 +1128,29 @@ void HandleEnemyUnitMove( int* pnXPos, int* pnYPos, EEntityDirectionFacing* peDi
   
   if( ! fResult )
   {
-    // Not a valid move
+    // Not a valid move, but it may have turned
+    EntityStoreSetPayload( eEntityKindEnemy, nOldPosX, nOldPosY, (uint8_t)*peDirectionFacing );
     return;
   }
   
-  if( rand() % 10 == 0 )
+  if( RngBelow( &g_gameOptions.m_rng, 10 ) == 0 )
   {
     // Every 10 steps destroy a tile
-    g_nMap[ nOldPosX ][ nOldPosY ] = false;
+    SetLandTile( nOldPosX, nOldPosY, false );
+    AnalyticsCount( eAnalyticsTilesDestroyed );
     
-    vibes_enqueue_custom_pattern( g_vibPatternBlockRemovedStruct );
+    HapticsRequest( eHapticTileCrumbled );
   }
   
   // Update enemy position
   
-  g_nNonPlayerEntities[ nOldPosX ][ nOldPosY ] = eEntityNone;
-  g_nNonPlayerEntities[ *pnXPos ][ *pnYPos ] = eEntityEnemy;
+  EntityStoreMove( eEntityKindEnemy, nOldPosX, nOldPosY, *pnXPos, *pnYPos, (uint8_t)*peDirectionFacing );
+  
+  // Skeletons walk off with any gem they stand on
+  EntityStoreRemove( eEntityKindGem, *pnXPos, *pnYPos );
+  
+  g_fDangerMapDirty = true;
+  g_fReachabilityDirty = true;
   
   // Check if we have caught the player
   
@@ -504,11 +1160,12 @@ void HandleEnemyUnitMove( int* pnXPos, int* pnYPos, EEntityDirectionFacing* peDi
     // The player has been killed
       
     g_gameOptions.m_fGameOver = true;
-    vibes_long_pulse();
+    HapticsRequest( eHapticDeath );
+    AnalyticsEndRun( g_gameOptions.m_nScore );
   }
 }
 
-void HandlePlayerMove()
+bool HandlePlayerMove()
 {
   // Create new land at cost to score
   bool fCanCreateNewLand = ( g_gameOptions.m_nScore >= c_nScoreLandCreationPenalty );
@@ -529,17 +1186,19 @@ void HandlePlayerMove()
     // Add step score!  
     g_gameOptions.m_nScore += c_nScoreStep;
     
+    g_fReachabilityDirty = true;
+    
     // Check and retreieve treasure if required
-    if( IsTreasure( g_nNonPlayerEntities[ g_gameOptions.m_playerObj.m_nX ][ g_gameOptions.m_playerObj.m_nY ] ) )
+    if( EntityStoreRemove( eEntityKindGem, g_gameOptions.m_playerObj.m_nX, g_gameOptions.m_playerObj.m_nY ) )
     {
       // Collect treasure!  
       g_gameOptions.m_nScore += c_nScoreTreasure;
-      
-      g_nNonPlayerEntities[ g_gameOptions.m_playerObj.m_nX ][ g_gameOptions.m_playerObj.m_nY ] = eEntityNone;
+      AnalyticsCount( eAnalyticsGems );
       
       // Check to see if there are any more gems in the world, if not, mark level
       // as being exit-able 
-      if( CheckIfLevelIsComplete() )
+      if(    ! g_fEndlessMode 
+          && CheckIfLevelIsComplete() )
       {
         g_gameOptions.m_fCanLevelBeExited = true;
       }
@@ -550,61 +1209,288 @@ void HandlePlayerMove()
         && g_gameOptions.m_playerObj.m_nX == g_gameOptions.m_exitObj.m_nX 
         && g_gameOptions.m_playerObj.m_nY == g_gameOptions.m_exitObj.m_nY )
     {
-      // We have finished this level, jolly good show  
-      GenerateNewMap();
+      // We have finished this level, jolly good show  
+      AnalyticsEndLevel( g_gameOptions.m_nScore );
+      GenerateNewMap();
+    }
+    else if( ! g_fEndlessMode )
+    {
+      TakeUndoSnapshot( true );
+    }
+    
+    if( g_fEndlessMode )
+    {
+      ScrollEndlessView();
+    }
+  }
+  
+  // Caller repaints and buzzes, so bursts of input can share one of each
+  return fResult;
+}
+
+void LoadLevelPack()
+{
+  uint8_t vHeader[ cnLevelPackHeaderBytes ];
+  
+  g_hLevelPack = resource_get_handle( RESOURCE_ID_LEVEL_PACK );
+  g_nLevelPackLevels = 0;
+  
+  if(    ! g_hLevelPack
+      || resource_load_byte_range( g_hLevelPack, 0, vHeader, sizeof( vHeader ) ) != sizeof( vHeader )
+      || ! LevelPackReadHeader( vHeader, &g_nLevelPackLevels ) )
+  {
+    // No usable pack, every level is dealt live
+    g_nLevelPackLevels = 0;
+    return;
+  }
+  
+  if( persist_exists( c_nLevelPackKey ) )
+  {
+    g_nLevelPackNext = (uint32_t)persist_read_int( c_nLevelPackKey ) % g_nLevelPackLevels;
+  }
+  
+  APP_LOG( APP_LOG_LEVEL_INFO, "Level pack : %d levels, next %d", (int)g_nLevelPackLevels, (int)g_nLevelPackNext );
+}
+
+// One record read straight into the map, false if the read failed
+bool LoadPackedLevel()
+{
+  uint8_t vRecord[ cnLevelPackRecordBytes ];
+  struct PackedLevel level;
+  
+  if( resource_load_byte_range( g_hLevelPack, 
+                                LevelPackOffset( g_nLevelPackNext ), 
+                                vRecord, 
+                                sizeof( vRecord ) ) != sizeof( vRecord ) )
+  {
+    return false;
+  }
+  
+  LevelPackReadRecord( vRecord, &level );
+  g_nLevelPackNext = ( g_nLevelPackNext + 1 ) % g_nLevelPackLevels;
+  
+  g_nLandBits = level.m_nLand;
+  
+  for( int x = 0 ; x < cnArrayWidth ; ++x )  
+  {
+    for( int y = 0 ; y < cnArrayHeight ; ++y )  
+    {
+      g_nMap[ x ][ y ] = BitboardTest( level.m_nLand, x, y );
+    }
+  }
+  
+  EntityStoreSetKindCells( eEntityKindGem, level.m_nGems, 0 );
+  
+  g_gameOptions.m_playerObj.m_nX = level.m_nPlayerX;
+  g_gameOptions.m_playerObj.m_nY = level.m_nPlayerY;
+  g_gameOptions.m_playerObj.m_eDirectionFacing = eEntityFacingSE;
+  
+  g_gameOptions.m_exitObj.m_nX = level.m_nExitX;
+  g_gameOptions.m_exitObj.m_nY = level.m_nExitY;
+  
+  g_gameOptions.m_nNumberOfEnemies = level.m_nNumberOfEnemies;
+  
+  for( int nEnemy = 0 ; nEnemy < level.m_nNumberOfEnemies ; ++nEnemy )
+  {
+    g_gameOptions.m_enemiesArray[ nEnemy ].m_nX = level.m_vEnemyX[ nEnemy ];
+    g_gameOptions.m_enemiesArray[ nEnemy ].m_nY = level.m_vEnemyY[ nEnemy ];
+    g_gameOptions.m_enemiesArray[ nEnemy ].m_eDirectionFacing = eEntityFacingNE;
+  }
+  
+  return true;
+}
+
+void GenerateNewMap()
+{
+  ++g_nLevelsDealt;
+  
+  bool fFromPack =    g_nLevelPackLevels > 0
+                   && c_nLevelPackEvery > 0
+                   && g_nLevelsDealt % c_nLevelPackEvery == 0;
+  
+  if(    ! fFromPack
+      || ! LoadPackedLevel() )
+  {
+    GenerateLiveLevel();
+  }
+  
+  g_gameOptions.m_fCanLevelBeExited = false;
+  
+  PlaceEnemyEntities();
+  
+  PathingRebuild( g_nLandBits );
+  ConnectivityRebuild( g_nLandBits );
+  
+  g_fAutoHopActive = false;
+  g_fDangerMapDirty = true;
+  g_fReachabilityDirty = true;
+  
+  // Each level starts its own history, undo never crosses into the last one
+  UndoClear();
+  TakeUndoSnapshot( false );
+}
+
+void TakeUndoSnapshot( bool fAfterHop )
+{
+  struct UndoSnapshot snapshot;
+  
+  snapshot.m_nLand = g_nLandBits;
+  snapshot.m_nGems = GetTreasureBits();
+  snapshot.m_rng = g_gameOptions.m_rng;
+  snapshot.m_nScore = g_gameOptions.m_nScore;
+  
+  snapshot.m_nPlayerX = (uint8_t)g_gameOptions.m_playerObj.m_nX;
+  snapshot.m_nPlayerY = (uint8_t)g_gameOptions.m_playerObj.m_nY;
+  snapshot.m_nPlayerFacing = (uint8_t)g_gameOptions.m_playerObj.m_eDirectionFacing;
+  snapshot.m_fCanLevelBeExited = g_gameOptions.m_fCanLevelBeExited;
+  snapshot.m_fAfterHop = fAfterHop;
+  
+  snapshot.m_nNumberOfEnemies = (uint8_t)g_gameOptions.m_nNumberOfEnemies;
+  
+  for( int nEnemy = 0 ; nEnemy < g_gameOptions.m_nNumberOfEnemies ; ++nEnemy )
+  {
+    snapshot.m_vEnemyX[ nEnemy ] = (uint8_t)g_gameOptions.m_enemiesArray[ nEnemy ].m_nX;
+    snapshot.m_vEnemyY[ nEnemy ] = (uint8_t)g_gameOptions.m_enemiesArray[ nEnemy ].m_nY;
+    snapshot.m_vEnemyFacing[ nEnemy ] = (uint8_t)g_gameOptions.m_enemiesArray[ nEnemy ].m_eDirectionFacing;
+  }
+  
+  AnalyticsGetCounts( &snapshot.m_analytics );
+  
+  UndoPush( &snapshot );
+}
+
+// Skeletons back into the entity store from the enemies array. Levels
+// are dealt with each on a tile of its own and they never step onto
+// one another, so every skeleton gets an entry.
+void PlaceEnemyEntities()
+{
+  EntityStoreClearKind( eEntityKindEnemy );
+  
+  for( int nEnemy = 0 ; nEnemy < g_gameOptions.m_nNumberOfEnemies ; ++nEnemy )
+  {
+    EntityStoreAdd( eEntityKindEnemy,
+                    g_gameOptions.m_enemiesArray[ nEnemy ].m_nX,
+                    g_gameOptions.m_enemiesArray[ nEnemy ].m_nY,
+                    (uint8_t)g_gameOptions.m_enemiesArray[ nEnemy ].m_eDirectionFacing );
+  }
+}
+
+// Back to just before the last hop, false if there is nothing to undo
+bool UndoLastHop()
+{
+  struct UndoSnapshot snapshot;
+  
+  if( ! UndoPopHop( &snapshot ) )
+  {
+    return false;
+  }
+  
+  g_nLandBits = snapshot.m_nLand;
+  g_gameOptions.m_rng = snapshot.m_rng;
+  g_gameOptions.m_nScore = snapshot.m_nScore;
+  
+  g_gameOptions.m_playerObj.m_nX = snapshot.m_nPlayerX;
+  g_gameOptions.m_playerObj.m_nY = snapshot.m_nPlayerY;
+  g_gameOptions.m_playerObj.m_eDirectionFacing = (EEntityDirectionFacing)snapshot.m_nPlayerFacing;
+  g_gameOptions.m_fCanLevelBeExited = snapshot.m_fCanLevelBeExited;
+  
+  for( int x = 0 ; x < cnArrayWidth ; ++x )  
+  {
+    for( int y = 0 ; y < cnArrayHeight ; ++y )  
+    {
+      g_nMap[ x ][ y ] = BitboardTest( snapshot.m_nLand, x, y );
     }
-    
-    layer_mark_dirty( g_pDrawingLayer );
   }
-  else
+  
+  EntityStoreSetKindCells( eEntityKindGem, snapshot.m_nGems, 0 );
+  
+  g_gameOptions.m_nNumberOfEnemies = snapshot.m_nNumberOfEnemies;
+  
+  for( int nEnemy = 0 ; nEnemy < snapshot.m_nNumberOfEnemies ; ++nEnemy )
   {
-    vibes_short_pulse();
+    g_gameOptions.m_enemiesArray[ nEnemy ].m_nX = snapshot.m_vEnemyX[ nEnemy ];
+    g_gameOptions.m_enemiesArray[ nEnemy ].m_nY = snapshot.m_vEnemyY[ nEnemy ];
+    g_gameOptions.m_enemiesArray[ nEnemy ].m_eDirectionFacing = (EEntityDirectionFacing)snapshot.m_vEnemyFacing[ nEnemy ];
   }
+  
+  PlaceEnemyEntities();
+  
+  AnalyticsSetCounts( &snapshot.m_analytics );
+  
+  PathingRebuild( g_nLandBits );
+  ConnectivityRebuild( g_nLandBits );
+  
+  g_fDangerMapDirty = true;
+  g_fReachabilityDirty = true;
+  
+  return true;
 }
 
-void GenerateNewMap()
+void GenerateLiveLevel()
 { 
+  // One draw per cell, low half decides land and high half treasure
+  uint32_t vCellDraws[ cnArrayWidth * cnArrayHeight ];
+  
+  RngFill( &g_gameOptions.m_rng, vCellDraws, cnArrayWidth * cnArrayHeight );
+  
+  Bitboard nGemBits = 0;
+  
   for( int x = 0 ; x < cnArrayWidth ; ++x )  
   {
     for( int y = 0 ; y < cnArrayHeight ; ++y )  
     {
-        bool fValidPosition = rand() % 6 != 0;
+        uint32_t nDraw = vCellDraws[ x * cnArrayHeight + y ];
+        
+        bool fValidPosition = RngScale16( nDraw, 6 ) != 0;
         g_nMap[ x ][ y ] = fValidPosition;
-      
-        g_nNonPlayerEntities[ x ][ y ] = eEntityNone;
+        g_nLandBits = BitboardSet( g_nLandBits, x, y, fValidPosition );
       
         if(    fValidPosition        // don't spawn treasure on invalid positions
-            && rand() % 5 == 0 ) 
+            && RngScale16( nDraw >> 16, 5 ) == 0 ) 
         {
-          g_nNonPlayerEntities[ x ][ y ] = eTreasureGem;
+          nGemBits |= BitboardCell( x, y );
         }
     }   
   }
   
+  EntityStoreSetKindCells( eEntityKindGem, nGemBits, 0 );
+  
   // TODO check player start is in valid place
-  g_gameOptions.m_playerObj.m_nX = rand() % (int)cnArrayWidth;
-  g_gameOptions.m_playerObj.m_nY = rand() % (int)cnArrayHeight;
+  g_gameOptions.m_playerObj.m_nX = RngBelow( &g_gameOptions.m_rng, cnArrayWidth );
+  g_gameOptions.m_playerObj.m_nY = RngBelow( &g_gameOptions.m_rng, cnArrayHeight );
   
   g_gameOptions.m_playerObj.m_eDirectionFacing = eEntityFacingSE;
   
   // TODO check exit is in valid place
-  g_gameOptions.m_exitObj.m_nX = rand() % (int)cnArrayWidth;
-  g_gameOptions.m_exitObj.m_nY = rand() % (int)cnArrayHeight;
-  
-  g_gameOptions.m_fCanLevelBeExited = false;
+  g_gameOptions.m_exitObj.m_nX = RngBelow( &g_gameOptions.m_rng, cnArrayWidth );
+  g_gameOptions.m_exitObj.m_nY = RngBelow( &g_gameOptions.m_rng, cnArrayHeight );
   
   // Generate a few enemies
   g_gameOptions.m_nNumberOfEnemies = 0;
   
-  int nNumEnemiesToGenerate = 2 + rand() % 2;
+  int nNumEnemiesToGenerate = 2 + RngBelow( &g_gameOptions.m_rng, 2 );
+  
+  Bitboard nEnemyBits = 0;
   
   for( int nEnemy = 0 ; nEnemy < nNumEnemiesToGenerate ; ++nEnemy )
   {
-    int nEnemyXPos = rand() % cnArrayWidth;
-    int nEnemyYPos = rand() % cnArrayHeight;
+    int nEnemyXPos;
+    int nEnemyYPos;
+    
+    // The entity store holds one skeleton a tile, so draw again until
+    // this one has a tile to itself
+    do
+    {
+      nEnemyXPos = RngBelow( &g_gameOptions.m_rng, cnArrayWidth );
+      nEnemyYPos = RngBelow( &g_gameOptions.m_rng, cnArrayHeight );
+    }
+    while( nEnemyBits & BitboardCell( nEnemyXPos, nEnemyYPos ) );
+    
+    nEnemyBits |= BitboardCell( nEnemyXPos, nEnemyYPos );
     
     g_gameOptions.m_enemiesArray[ nEnemy ].m_nX = nEnemyXPos;
     g_gameOptions.m_enemiesArray[ nEnemy ].m_nY = nEnemyYPos;
+    g_gameOptions.m_enemiesArray[ nEnemy ].m_eDirectionFacing = eEntityFacingNE;
     
     ++g_gameOptions.m_nNumberOfEnemies;
   }
@@ -620,21 +1506,128 @@ void display_layer_update_callback(Layer* pLayer, GContext* ctx)
     }
     else
     {
-      // Repaint the isometric view
-      DrawIsoTiles( ctx );
+      // The overlays go into the key, so bring them up to date first
+      if( g_fShowDangerMap )
+      {
+        UpdateDangerMap();
+      }
+      
+      UpdateReachability();
       
-      // Draw the score and HUD
-      DrawHUD( ctx );
+      uint64_t nKey = FrameStateKey();
+      
+      if( ! FrameMemoRestore( ctx, nKey ) )
+      {
+        // Repaint the isometric view
+        DrawIsoTiles( ctx );
+        
+        // Draw the score and HUD
+        DrawHUD( ctx );
+        
+        FrameMemoStore( ctx, nKey );
+      }
+    }
+    
+    if( FrameCaptureActive() )
+    {
+      CaptureFrame( ctx );
     }
   }
 }
 
+static bool WriteFrameCaptureLog( const uint8_t* pData, int nBytes, void* pContext )
+{
+  return data_logging_log( (DataLoggingSessionRef)pContext, pData, (uint32_t)nBytes ) == DATA_LOGGING_SUCCESS;
+}
+
+void StartFrameCapture()
+{
+  g_pFrameCaptureLog = data_logging_create( c_nFrameCaptureLogTag, DATA_LOGGING_BYTE_ARRAY, 1, false );
+  
+  if(    ! g_pFrameCaptureLog
+      || ! FrameCaptureBegin( WriteFrameCaptureLog, g_pFrameCaptureLog ) )
+  {
+    APP_LOG( APP_LOG_LEVEL_WARNING, "frame capture : couldn't start" );
+  }
+}
+
+// The frame just drawn, as it is in the framebuffer
+void CaptureFrame( GContext* ctx )
+{
+  GBitmap* pFramebuffer = graphics_capture_frame_buffer( ctx );
+  
+  if( ! pFramebuffer )
+  {
+    return;
+  }
+  
+  time_t nSeconds;
+  uint16_t nMs;
+  
+  time_ms( &nSeconds, &nMs );
+  
+  FrameCaptureFrame( gbitmap_get_data( pFramebuffer ),
+                     gbitmap_get_bytes_per_row( pFramebuffer ),
+                     (uint32_t)nSeconds * 1000u + nMs );
+  
+  graphics_release_frame_buffer( ctx, pFramebuffer );
+}
+
+static uint64_t MixKey( uint64_t nKey, uint64_t nValue )
+{
+  return RngMix64( nKey ^ nValue );
+}
+
+// Everything the play view draws from. Anything added to DrawIsoTiles or
+// DrawHUD has to be added here too or the memo will show stale frames.
+uint64_t FrameStateKey()
+{
+  uint64_t nKey = 0x484f50504552ull;
+  
+  nKey = MixKey( nKey, g_nLandBits );
+  nKey = MixKey( nKey, EntityStoreCells( eEntityKindGem ) );
+  nKey = MixKey( nKey, EntityStoreCells( eEntityKindEnemy ) );
+  
+  // Skeleton facings, in map order so the store's slot order can't matter
+  Bitboard nEnemies = EntityStoreCells( eEntityKindEnemy );
+  uint64_t nFacings = 0;
+  
+  while( nEnemies )
+  {
+    int nCell = BitboardLowestIndex( nEnemies );
+    
+    nFacings = nFacings * 4 + EntityStorePayload( eEntityKindEnemy, nCell / cnBitboardSide, nCell % cnBitboardSide );
+    nEnemies &= nEnemies - 1;
+  }
+  
+  nKey = MixKey( nKey, nFacings );
+  
+  nKey = MixKey( nKey,   (uint64_t)(uint8_t)g_gameOptions.m_playerObj.m_nX
+                       | (uint64_t)(uint8_t)g_gameOptions.m_playerObj.m_nY << 8
+                       | (uint64_t)g_gameOptions.m_playerObj.m_eDirectionFacing << 16
+                       | (uint64_t)(uint8_t)g_gameOptions.m_exitObj.m_nX << 24
+                       | (uint64_t)(uint8_t)g_gameOptions.m_exitObj.m_nY << 32
+                       | (uint64_t)g_gameOptions.m_fCanLevelBeExited << 40
+                       | (uint64_t)g_fBounceSpritesThisSecond << 41
+                       | (uint64_t)g_fShowDangerMap << 42
+                       | (uint64_t)g_fLevelCutOff << 43
+                       | (uint64_t)g_fCanAffordBridge << 44 );
+  
+  nKey = MixKey( nKey, g_fShowDangerMap ? g_nDangerBits : 0 );
+  nKey = MixKey( nKey, g_nBridgeHintBits );
+  nKey = MixKey( nKey, (uint64_t)(uint32_t)g_gameOptions.m_nScore << 32 | (uint32_t)g_gameOptions.m_nHighScore );
+  
+  return nKey;
+}
+
 void DrawGameOverScreen( GContext* ctx )
 {
   static char szGameOverText[] =   "Game Over!";
   static char szScoreBufferScore[] =   "Final Score : 00000000";
   static char szHighScoreText[] =   "** New high score!! **";
   static char szPlayAgainText[] =   "Press any key to play again...";
+  static char szEndlessText[] =   "Hold select for endless mode";
+  static char szStatsText[] =   "Runs 00000 p50 00000 p90 00000";
   
   snprintf( &szScoreBufferScore[ 0 ],
               sizeof( szScoreBufferScore ),
@@ -689,39 +1682,40 @@ void DrawGameOverScreen( GContext* ctx )
                       GTextOverflowModeTrailingEllipsis ,
                       GTextAlignmentCenter,
                       NULL );
-}
-
-bool IsTreasure( EEntityType eEntityType )
-{
-  switch( eEntityType )
-  {
-    case eTreasureGem:  
-      return true;
-    
-    default:
-      return false;
-  }
   
-  return false;
+  rectTextPos.origin.y += 25;
+  
+  // Straight from the score sketch, no history to walk
+  snprintf( &szStatsText[ 0 ],
+              sizeof( szStatsText ),
+              "Runs %d p50 %d p90 %d",
+              AnalyticsSamples( eAnalyticsRunScore ),
+              AnalyticsQuantile( eAnalyticsRunScore, 50 ),
+              AnalyticsQuantile( eAnalyticsRunScore, 90 ) );
+  
+  graphics_draw_text( ctx,
+                      &szStatsText[0],
+                      fonts_get_system_font( FONT_KEY_GOTHIC_14 ),
+                      rectTextPos,
+                      GTextOverflowModeTrailingEllipsis ,
+                      GTextAlignmentCenter,
+                      NULL );
+  
+  rectTextPos.origin.y += 20;
+  
+  graphics_draw_text( ctx,
+                      &szEndlessText[0],
+                      fonts_get_system_font( FONT_KEY_GOTHIC_14 ),
+                      rectTextPos,
+                      GTextOverflowModeTrailingEllipsis ,
+                      GTextAlignmentCenter,
+                      NULL );
 }
 
 bool CheckIfLevelIsComplete()
 {
-  bool fTreasureFound = false;
-  
-  for( int x = 0 ; x < cnArrayWidth ; ++x )  
-  {
-    for( int y = 0 ; y < cnArrayHeight ; ++y )  
-    {
-        if( IsTreasure( g_nNonPlayerEntities[ x ][ y ] ) )
-        {
-          // Level not yet complete
-          return false;
-        }
-    }
-  }
-  
-  return true;
+  // Level complete once the last gem is gone
+  return EntityStoreCount( eEntityKindGem ) == 0;
 }
 
 void DrawHUD( GContext* ctx )
@@ -764,6 +1758,21 @@ void DrawHUD( GContext* ctx )
                       GTextAlignmentCenter,
                       NULL );
   
+  UpdateReachability();
+  
+  if( g_fLevelCutOff )
+  {
+    rectTextPos.origin.y = 168 - 20;
+    
+    graphics_draw_text( ctx,
+                        g_fCanAffordBridge ? "Cut off! Build the marked tiles"
+                                           : "Cut off! Hold select to reshuffle",
+                        fonts_get_system_font( FONT_KEY_GOTHIC_14 ),
+                        rectTextPos,
+                        GTextOverflowModeTrailingEllipsis ,
+                        GTextAlignmentCenter,
+                        NULL );
+  }
 }
 
 void UpdatePlayerDirectionFacing( bool fUp )
@@ -817,273 +1826,217 @@ void UpdatePlayerDirectionFacing( bool fUp )
         break;
     }
   }
-  
-  layer_mark_dirty( g_pDrawingLayer );
 }
 
-void DrawIsoObject( int nXPx, int nYPx, GContext* ctx )
+void InitProjection()
 {
-  gpath_move_to( g_pIsometricBlock, GPoint( nXPx, nYPx ) );
-  
-  // Fill the path:
-  graphics_context_set_fill_color(ctx, GColorWhite);
-  gpath_draw_filled(ctx, g_pIsometricBlock);
-  // Stroke the path:
-  graphics_context_set_stroke_color(ctx, GColorBlack);
-  gpath_draw_outline(ctx, g_pIsometricBlock);
-  
-  // draw face outlines
-  graphics_draw_line( ctx,
-                      GPoint( nXPx + 0,
-                              nYPx + 5 ),
-                      GPoint( nXPx + 8,
-                              nYPx + 10 ) );
-  
-  graphics_draw_line( ctx,
-                      GPoint( nXPx + 8,
-                              nYPx + 10 ),
-                      GPoint( nXPx + 16,
-                              nYPx + 5 ) );
-  
-  graphics_draw_line( ctx,
-                      GPoint( nXPx + 8,
-                              nYPx + 10 ),
-                      GPoint( nXPx + 8,
-                              nYPx + 21 ) );
-}
-
-void DrawExitMarker( int nXPx, int nYPx, GContext* ctx )
-{
-  if( ! g_gameOptions.m_fCanLevelBeExited )
-  {
-    // don't draw yet
-    return;
-  }
-  
-  gpath_move_to( g_pExitMarker, GPoint( nXPx, nYPx ) );
+  const int cnXStartPoint = -5;
+  const int cnYStartPoint = 168 / 2;
   
-  // Fill the path:
-  if( g_fBounceSpritesThisSecond )
-  {
-    graphics_context_set_fill_color(ctx, GColorWhite );
-  }
-  else
+  for( int x = 0; x < cnArrayWidth; ++x )
   {
-    graphics_context_set_fill_color(ctx, GColorBlack );
+    for( int y = 0; y < cnArrayHeight; ++y )
+    {
+      // Same isometric projection the two pass renderer used, where its
+      // row counter ran one ahead of the map row
+      g_vTileOriginPx[ x ][ y ] = GPoint( cnXStartPoint + ( ( y + 1 ) * c_nTileWidth / 2 ) + ( x * c_nTileWidth / 2 ),
+                                          cnYStartPoint + ( x * c_nTileHeight / 2 ) - ( ( y + 1 ) * c_nTileHeight / 2 ) );
+    }
   }
-  
-  gpath_draw_filled(ctx, g_pExitMarker);
-  // Stroke the path:
-  graphics_context_set_stroke_color(ctx, GColorBlack);
-  gpath_draw_outline(ctx, g_pExitMarker);
 }
 
-void DrawTileEntity( EEntityType eType, 
-                     int nXPx, 
-                     int nYPx, 
+int GetEntitySprite( EEntityType eType, 
                      EEntityDirectionFacing eDirectionFacing, 
-                     GContext* ctx )
+                     int* pnYBounceMassage )
 {
-  GBitmap* pBitmapToDrawMask = NULL;
-  GBitmap* pBitmapToDrawSprite = NULL;
-  
-  int nYBounceMassage = 0;
+  *pnYBounceMassage = 0;
   
   switch( eType )
   {
     case eEntityPlayer:
       switch( eDirectionFacing )
       {
+        default:
         case eEntityFacingNE:
-          pBitmapToDrawMask = g_pBitmapPlayerNE_Mask;
-          pBitmapToDrawSprite = g_pBitmapPlayerNE_Sprite;
-          break;
+          return eSpritePlayerNE;
         
         case eEntityFacingNW:
-          pBitmapToDrawMask = g_pBitmapPlayerNW_Mask;
-          pBitmapToDrawSprite = g_pBitmapPlayerNW_Sprite;
-          break;
+          return eSpritePlayerNW;
         
         case eEntityFacingSE:
-          pBitmapToDrawMask = g_pBitmapPlayerSE_Mask;
-          pBitmapToDrawSprite = g_pBitmapPlayerSE_Sprite;
-          break;
+          return eSpritePlayerSE;
         
         case eEntityFacingSW:
-          pBitmapToDrawMask = g_pBitmapPlayerSW_Mask;
-          pBitmapToDrawSprite = g_pBitmapPlayerSW_Sprite;
-          break;
+          return eSpritePlayerSW;
       }
-      break;
     
     case eEntityEnemy:
       switch( eDirectionFacing )
       {
+        default:
         case eEntityFacingNE:
         case eEntityFacingSE:
-          if( g_fBounceSpritesThisSecond )
-          {
-            pBitmapToDrawMask = g_pBitmapEnemyUnit1_Mask;
-            pBitmapToDrawSprite = g_pBitmapEnemyUnit1_Sprite;
-          }
-          else
-          {
-            pBitmapToDrawMask = g_pBitmapEnemyUnit2_Mask;
-            pBitmapToDrawSprite = g_pBitmapEnemyUnit2_Sprite;
-          }
-          break;
+          return g_fBounceSpritesThisSecond ? eSpriteEnemyUnit1 : eSpriteEnemyUnit2;
         
         case eEntityFacingNW:
         case eEntityFacingSW:
-          if( g_fBounceSpritesThisSecond )
-          {
-            pBitmapToDrawMask = g_pBitmapEnemyUnit3_Mask;
-            pBitmapToDrawSprite = g_pBitmapEnemyUnit3_Sprite;
-          }
-          else
-          {
-            pBitmapToDrawMask = g_pBitmapEnemyUnit4_Mask;
-            pBitmapToDrawSprite = g_pBitmapEnemyUnit4_Sprite;
-          }
-          break;
+          return g_fBounceSpritesThisSecond ? eSpriteEnemyUnit3 : eSpriteEnemyUnit4;
       }
-      
-      break;
     
     case eTreasureGem:
-      pBitmapToDrawMask = g_pBitmapTreasureGem_Mask;
-      pBitmapToDrawSprite = g_pBitmapTreasureGem_Sprite;
-    
       if( g_fBounceSpritesThisSecond )
       {
-        nYBounceMassage = 2;
+        *pnYBounceMassage = 2;
       }
-    break;
+      return eSpriteTreasureGem;
     
     default:
-      // Do nothing
-      break;
-  }
-  
-  if(    pBitmapToDrawMask
-      && pBitmapToDrawSprite )
-  {
-    graphics_context_set_compositing_mode( ctx, GCompOpOr );
-    
-    graphics_draw_bitmap_in_rect( ctx, 
-                                  (const GBitmap*) pBitmapToDrawMask,
-                                  GRect( nXPx,
-                                         nYPx + nYBounceMassage,
-                                         c_nSpriteDimensionPx,
-                                         c_nSpriteDimensionPx ) );
-    
-    graphics_context_set_compositing_mode( ctx, GCompOpAnd );
-    
-    graphics_draw_bitmap_in_rect( ctx, 
-                                  (const GBitmap*) pBitmapToDrawSprite,
-                                  GRect( nXPx,
-                                         nYPx + nYBounceMassage,
-                                         c_nSpriteDimensionPx,
-                                         c_nSpriteDimensionPx ) );
+      // Nothing to draw
+      return -1;
   }
 }
 
 void DrawIsoTiles( GContext* ctx )
 {
-  const int cnXStartPoint = -5;
-  const int cnYStartPoint = 168 / 2;
+  if( g_fShowDangerMap )
+  {
+    UpdateDangerMap();
+  }
+  
+  UpdateReachability();
+  
+  //
+  //  Occlusion : blocks are all one height so nothing ever covers a top
+  //  face, but a side face is fully covered once the block beside it
+  //  and the block straight in front are both land. The left face sits
+  //  behind ( x, y - 1 ), the right behind ( x + 1, y ) and both behind
+  //  ( x + 1, y - 1 ). Hidden faces aren't filled, the edge between
+  //  each one and the top face still is.
+  //
+  
+  Bitboard nLandFront = BitboardShiftNW( BitboardShiftNE( g_nLandBits ) );
+  Bitboard nLeftHidden = BitboardShiftNE( g_nLandBits ) & nLandFront;
+  Bitboard nRightHidden = BitboardShiftNW( g_nLandBits ) & nLandFront;
   
   //
-  //  First draw the world
+  //  Describe the frame back to front, each tile followed by whatever
+  //  stands on it, so nearer blocks correctly hide the feet of units
+  //  behind them
   //
   
+  DrawListBegin();
+  
   for( int x = 0; x < cnArrayWidth; ++x )
   {
-    for( int y = cnArrayHeight; y > 0; --y )
+    for( int y = cnArrayHeight - 1; y >= 0; --y )
     {
-      int nXpositionPx = (y * c_nTileWidth / 2) + (x * c_nTileWidth / 2);
-      int nYpositionPx = (x * c_nTileHeight / 2) - (y * c_nTileHeight / 2);
+      GPoint tileOrigin = g_vTileOriginPx[ x ][ y ];
       
-      if( g_nMap[ x ][ y - 1 ] )
+      if( g_nMap[ x ][ y ] )
       {
-        DrawIsoObject( cnXStartPoint + nXpositionPx, 
-                       cnYStartPoint + nYpositionPx, 
-                       ctx );
+        int nFaces = eBlockFaceAll;
+        
+        if( BitboardTest( nLeftHidden, x, y ) )
+        {
+          nFaces &= ~eBlockFaceLeft;
+        }
+        
+        if( BitboardTest( nRightHidden, x, y ) )
+        {
+          nFaces &= ~eBlockFaceRight;
+        }
+        
+        DrawListAddBlock( tileOrigin.x, tileOrigin.y, nFaces );
+        
+        if(    g_fShowDangerMap
+            && BitboardTest( g_nDangerBits, x, y ) )
+        {
+          DrawListAddDangerMarker( tileOrigin.x, tileOrigin.y );
+        }
+      }
+      else if( BitboardTest( g_nBridgeHintBits, x, y ) )
+      {
+        DrawListAddBridgeHint( tileOrigin.x, tileOrigin.y );
       }
       
-      if(    g_gameOptions.m_exitObj.m_nX == x
-          && g_gameOptions.m_exitObj.m_nY == y - 1 )
+      if(    g_gameOptions.m_fCanLevelBeExited
+          && g_gameOptions.m_exitObj.m_nX == x
+          && g_gameOptions.m_exitObj.m_nY == y )
       {
-        // Draw exit position  
-        DrawExitMarker( cnXStartPoint + nXpositionPx + 5,
-                        cnYStartPoint + nYpositionPx + 2,
-                        ctx );
+        DrawListAddExitMarker( tileOrigin.x + 5,
+                               tileOrigin.y + 2,
+                               g_fBounceSpritesThisSecond );
       }
-    }
-  }
-  
-  //
-  //  Next draw entities on the world
-  //
-  
-  for( int x = 0; x < cnArrayWidth; ++x )
-  {
-    for( int y = cnArrayHeight; y > 0; --y )
-    {
-        int nXpositionPx = (y * c_nTileWidth / 2) + (x * c_nTileWidth / 2);
-        int nYpositionPx = (x * c_nTileHeight / 2) - (y * c_nTileHeight / 2);
       
-        // Draw object 'above' the tile cell but centered half way down
-        nYpositionPx -= 8;
+      // Draw objects 'above' the tile cell but centered half way down
+      int nYSpritePx = tileOrigin.y - 8;
+      int nYBounceMassage = 0;
       
-        // Draw any entities on this block (BUT not the player)
-        if( g_nNonPlayerEntities[ x ][ y - 1 ] != eEntityNone )
-        {
-          EEntityDirectionFacing eDirectionFacing = eEntityFacingNE;
-          
-          // If this is an enemy unit then get the direction the entity is facing
-          int nEntityIndex = 0;
-          
-          for( ; nEntityIndex < g_gameOptions.m_nNumberOfEnemies ; ++nEntityIndex )
-          {
-            if(    g_gameOptions.m_enemiesArray[ nEntityIndex ].m_nX == x
-                && g_gameOptions.m_enemiesArray[ nEntityIndex ].m_nY == y )
-            {
-              eDirectionFacing = g_gameOptions.m_enemiesArray[ nEntityIndex ].m_eDirectionFacing;
-            }
-            
-          }
-          
-          DrawTileEntity( g_nNonPlayerEntities[ x ][ y - 1 ],
-                          cnXStartPoint + nXpositionPx, 
-                          cnYStartPoint + nYpositionPx, 
-                          eDirectionFacing,
-                          ctx );
-        }
+      // Anything on this block (BUT not the player), a gem before any
+      // skeleton sharing its tile
+      uint8_t nKinds = EntityStoreCellMask( x, y );
+      
+      if( nKinds & EntityKindBit( eEntityKindGem ) )
+      {
+        int nSprite = GetEntitySprite( eTreasureGem, eEntityFacingNE, &nYBounceMassage );
+        
+        DrawListAddSprite( nSprite, tileOrigin.x, nYSpritePx + nYBounceMassage );
+      }
       
-        // Draw player position if required
-        if(    g_gameOptions.m_playerObj.m_nX == x 
-            && g_gameOptions.m_playerObj.m_nY == y - 1 )
-        { 
-            DrawTileEntity( eEntityPlayer,
-                            cnXStartPoint + nXpositionPx, 
-                            cnYStartPoint + nYpositionPx, 
-                            g_gameOptions.m_playerObj.m_eDirectionFacing,
-                            ctx );
-         }
+      if( nKinds & EntityKindBit( eEntityKindEnemy ) )
+      {
+        // The store keeps each skeleton's facing as its payload
+        EEntityDirectionFacing eDirectionFacing = (EEntityDirectionFacing)EntityStorePayload( eEntityKindEnemy, x, y );
+        
+        int nSprite = GetEntitySprite( eEntityEnemy, eDirectionFacing, &nYBounceMassage );
+        
+        DrawListAddSprite( nSprite, tileOrigin.x, nYSpritePx + nYBounceMassage );
+      }
+      
+      if(    g_gameOptions.m_playerObj.m_nX == x 
+          && g_gameOptions.m_playerObj.m_nY == y )
+      {
+        int nSprite = GetEntitySprite( eEntityPlayer,
+                                       g_gameOptions.m_playerObj.m_eDirectionFacing,
+                                       &nYBounceMassage );
+        
+        DrawListAddSprite( nSprite, tileOrigin.x, nYSpritePx + nYBounceMassage );
+      }
     }
   }
+  
+  DrawListDraw( ctx );
 }
 
 static void tick_handler(struct tm *tick_time, TimeUnits units_changed) 
 {
   g_fBounceSpritesThisSecond = ! g_fBounceSpritesThisSecond;
   
+  MemTrackSample();
+  
   if( ! g_gameOptions.m_fGameOver )
   {
+    AnalyticsCount( eAnalyticsTicks );
     TickEnemyUnits();
   }
   
+  if(    g_fAutoHopActive
+      && ! g_gameOptions.m_fGameOver )
+  {
+    AutoHopStep();
+  }
+  
+  // Everything this tick asked for comes out as at most one buzz
+  HapticsFlush();
+  
+  if( tick_time->tm_sec == 0 )
+  {
+    HapticsLogSummary();
+    FrameMemoLogSummary();
+    DrawListLogSummary();
+    InputLogSummary();
+  }
+  
   // mark view as dirty so we can repaint
   
   layer_mark_dirty( g_pDrawingLayer );
@@ -1097,30 +2050,80 @@ void handle_deinit(void)
     persist_write_int( c_nHighScoreKey, g_gameOptions.m_nScore ); 
   }
   
-  layer_destroy(g_pDrawingLayer);
-  window_destroy(my_window);
+  // Pick the pack up where we left off next time
+  if( g_nLevelPackLevels > 0 )
+  {
+    persist_write_int( c_nLevelPackKey, (int32_t)g_nLevelPackNext );
+  }
+  
   tick_timer_service_unsubscribe();
+  accel_tap_service_unsubscribe();
+  
+  if( g_pCommandDrainTimer )
+  {
+    app_timer_cancel( g_pCommandDrainTimer );
+  }
+  
+  MemTrackBitmapDestroy( g_pBitmapPlayerNE_Sprite );
+  MemTrackBitmapDestroy( g_pBitmapPlayerNW_Sprite );
+  MemTrackBitmapDestroy( g_pBitmapPlayerSW_Sprite );
+  MemTrackBitmapDestroy( g_pBitmapPlayerSE_Sprite );
+  MemTrackBitmapDestroy( g_pBitmapPlayerNE_Mask );
+  MemTrackBitmapDestroy( g_pBitmapPlayerNW_Mask );
+  MemTrackBitmapDestroy( g_pBitmapPlayerSW_Mask );
+  MemTrackBitmapDestroy( g_pBitmapPlayerSE_Mask );
+  MemTrackBitmapDestroy( g_pBitmapEnemyUnit1_Sprite );
+  MemTrackBitmapDestroy( g_pBitmapEnemyUnit1_Mask );
+  MemTrackBitmapDestroy( g_pBitmapEnemyUnit2_Sprite );
+  MemTrackBitmapDestroy( g_pBitmapEnemyUnit2_Mask );
+  MemTrackBitmapDestroy( g_pBitmapEnemyUnit3_Sprite );
+  MemTrackBitmapDestroy( g_pBitmapEnemyUnit3_Mask );
+  MemTrackBitmapDestroy( g_pBitmapEnemyUnit4_Sprite );
+  MemTrackBitmapDestroy( g_pBitmapEnemyUnit4_Mask );
+  MemTrackBitmapDestroy( g_pBitmapTreasureGem_Mask );
+  MemTrackBitmapDestroy( g_pBitmapTreasureGem_Sprite );
+  
+  MemTrackPathDestroy( g_pIsometricBlock );
+  MemTrackPathDestroy( g_pIsometricBlockTop );
+  MemTrackPathDestroy( g_pIsometricBlockTopLeft );
+  MemTrackPathDestroy( g_pIsometricBlockTopRight );
+  MemTrackPathDestroy( g_pExitMarker );
+  MemTrackPathDestroy( g_pDangerMarker );
+  
+  if( FrameCaptureActive() )
+  {
+    FrameCaptureEnd();
+    
+    APP_LOG( APP_LOG_LEVEL_INFO,
+             "frame capture : %d frames, %d keyframes, %d bytes",
+             FrameCaptureFrames(),
+             FrameCaptureKeyframes(),
+             FrameCaptureBytes() );
+  }
+  
+  if( g_pFrameCaptureLog )
+  {
+    data_logging_finish( g_pFrameCaptureLog );
+    g_pFrameCaptureLog = NULL;
+  }
+  
+  MemTrackLogSummary();
+  HapticsLogSummary();
+  FrameMemoLogSummary();
+  DrawListLogSummary();
+  InputLogSummary();
+  AnalyticsLogSummary();
+  
+  MemTrackLayerDestroy(g_pDrawingLayer);
+  MemTrackWindowDestroy(my_window);
   
-  gbitmap_destroy( g_pBitmapPlayerNE_Sprite );
-  gbitmap_destroy( g_pBitmapPlayerNW_Sprite );
-  gbitmap_destroy( g_pBitmapPlayerSW_Sprite );
-  gbitmap_destroy( g_pBitmapPlayerSE_Sprite );
-  gbitmap_destroy( g_pBitmapPlayerNE_Mask );
-  gbitmap_destroy( g_pBitmapPlayerNW_Mask );
-  gbitmap_destroy( g_pBitmapPlayerSW_Mask );
-  gbitmap_destroy( g_pBitmapPlayerSE_Mask );
-  gbitmap_destroy( g_pBitmapEnemyUnit1_Sprite );
-  gbitmap_destroy( g_pBitmapEnemyUnit1_Mask );
-  gbitmap_destroy( g_pBitmapEnemyUnit2_Sprite );
-  gbitmap_destroy( g_pBitmapEnemyUnit2_Mask );
-  gbitmap_destroy( g_pBitmapEnemyUnit3_Sprite );
-  gbitmap_destroy( g_pBitmapEnemyUnit3_Mask );
-  gbitmap_destroy( g_pBitmapEnemyUnit4_Sprite );
-  gbitmap_destroy( g_pBitmapEnemyUnit4_Mask );
+  // Everything should be gone by now
+  MemTrackReportLeaks();
 }
 
 int main(void) {
   handle_init();
   app_event_loop();
   handle_deinit();
+  return 0;
 }
@@ -0,0 +1,197 @@
+#include "memtrack.h"
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+// Enough for every object the app holds with room for new sprites
+#define cnMemTrackMaxObjects 48
+
+struct MemTrackEntry
+{
+  const void* m_pObject;
+  EMemCategory m_eCategory;
+  int m_nBytes;
+};
+
+static struct MemTrackEntry g_memTrackEntries[ cnMemTrackMaxObjects ];
+static int g_nMemTrackEntryCount = 0;
+
+static int g_nMemTrackLiveBytes[ eMemCategoryCount ];
+static int g_nMemTrackPeakBytes[ eMemCategoryCount ];
+static int g_nMemTrackPeakHeapBytes = 0;
+static int g_nMemTrackDropped = 0;
+
+static const char* const c_szMemCategoryNames[ eMemCategoryCount ] = {
+  "bitmap",
+  "path",
+  "layer",
+  "window"
+};
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+static void TrackCreate( const void* pObject, EMemCategory eCategory, int nBytes )
+{
+  if( ! pObject )
+  {
+    return;
+  }
+
+  if( g_nMemTrackEntryCount == cnMemTrackMaxObjects )
+  {
+    // Table full, still works but we lose sight of this object
+    ++g_nMemTrackDropped;
+    return;
+  }
+
+  struct MemTrackEntry* pEntry = &g_memTrackEntries[ g_nMemTrackEntryCount++ ];
+
+  pEntry->m_pObject = pObject;
+  pEntry->m_eCategory = eCategory;
+  pEntry->m_nBytes = nBytes;
+
+  g_nMemTrackLiveBytes[ eCategory ] += nBytes;
+
+  if( g_nMemTrackLiveBytes[ eCategory ] > g_nMemTrackPeakBytes[ eCategory ] )
+  {
+    g_nMemTrackPeakBytes[ eCategory ] = g_nMemTrackLiveBytes[ eCategory ];
+  }
+
+  MemTrackSample();
+}
+
+static void TrackDestroy( const void* pObject )
+{
+  for( int nEntry = 0 ; nEntry < g_nMemTrackEntryCount ; ++nEntry )
+  {
+    if( g_memTrackEntries[ nEntry ].m_pObject == pObject )
+    {
+      g_nMemTrackLiveBytes[ g_memTrackEntries[ nEntry ].m_eCategory ] -= g_memTrackEntries[ nEntry ].m_nBytes;
+
+      // Swap the last entry into the hole
+      g_memTrackEntries[ nEntry ] = g_memTrackEntries[ --g_nMemTrackEntryCount ];
+      return;
+    }
+  }
+}
+
+GBitmap* MemTrackBitmapCreateWithResource( uint32_t nResourceId )
+{
+  int nHeapBefore = (int)heap_bytes_used();
+  GBitmap* pBitmap = gbitmap_create_with_resource( nResourceId );
+
+  TrackCreate( pBitmap, eMemCategoryBitmap, (int)heap_bytes_used() - nHeapBefore );
+  return pBitmap;
+}
+
+void MemTrackBitmapDestroy( GBitmap* pBitmap )
+{
+  TrackDestroy( pBitmap );
+  gbitmap_destroy( pBitmap );
+}
+
+GPath* MemTrackPathCreate( const GPathInfo* pPathInfo )
+{
+  int nHeapBefore = (int)heap_bytes_used();
+  GPath* pPath = gpath_create( pPathInfo );
+
+  TrackCreate( pPath, eMemCategoryPath, (int)heap_bytes_used() - nHeapBefore );
+  return pPath;
+}
+
+void MemTrackPathDestroy( GPath* pPath )
+{
+  TrackDestroy( pPath );
+  gpath_destroy( pPath );
+}
+
+Layer* MemTrackLayerCreate( GRect frame )
+{
+  int nHeapBefore = (int)heap_bytes_used();
+  Layer* pLayer = layer_create( frame );
+
+  TrackCreate( pLayer, eMemCategoryLayer, (int)heap_bytes_used() - nHeapBefore );
+  return pLayer;
+}
+
+void MemTrackLayerDestroy( Layer* pLayer )
+{
+  TrackDestroy( pLayer );
+  layer_destroy( pLayer );
+}
+
+Window* MemTrackWindowCreate()
+{
+  int nHeapBefore = (int)heap_bytes_used();
+  Window* pWindow = window_create();
+
+  TrackCreate( pWindow, eMemCategoryWindow, (int)heap_bytes_used() - nHeapBefore );
+  return pWindow;
+}
+
+void MemTrackWindowDestroy( Window* pWindow )
+{
+  TrackDestroy( pWindow );
+  window_destroy( pWindow );
+}
+
+void MemTrackSample()
+{
+  int nHeapUsed = (int)heap_bytes_used();
+
+  if( nHeapUsed > g_nMemTrackPeakHeapBytes )
+  {
+    g_nMemTrackPeakHeapBytes = nHeapUsed;
+  }
+}
+
+int MemTrackLiveBytes( EMemCategory eCategory )
+{
+  return g_nMemTrackLiveBytes[ eCategory ];
+}
+
+int MemTrackPeakBytes( EMemCategory eCategory )
+{
+  return g_nMemTrackPeakBytes[ eCategory ];
+}
+
+int MemTrackPeakHeapBytes()
+{
+  return g_nMemTrackPeakHeapBytes;
+}
+
+void MemTrackLogSummary()
+{
+  for( int nCategory = 0 ; nCategory < eMemCategoryCount ; ++nCategory )
+  {
+    APP_LOG( APP_LOG_LEVEL_INFO,
+             "mem %s live %d peak %d",
+             c_szMemCategoryNames[ nCategory ],
+             g_nMemTrackLiveBytes[ nCategory ],
+             g_nMemTrackPeakBytes[ nCategory ] );
+  }
+
+  APP_LOG( APP_LOG_LEVEL_INFO,
+           "mem heap used %d free %d peak %d untracked %d",
+           (int)heap_bytes_used(),
+           (int)heap_bytes_free(),
+           g_nMemTrackPeakHeapBytes,
+           g_nMemTrackDropped );
+}
+
+int MemTrackReportLeaks()
+{
+  for( int nEntry = 0 ; nEntry < g_nMemTrackEntryCount ; ++nEntry )
+  {
+    APP_LOG( APP_LOG_LEVEL_WARNING,
+             "mem leak %s %p %d bytes",
+             c_szMemCategoryNames[ g_memTrackEntries[ nEntry ].m_eCategory ],
+             g_memTrackEntries[ nEntry ].m_pObject,
+             g_memTrackEntries[ nEntry ].m_nBytes );
+  }
+
+  return g_nMemTrackEntryCount;
+}
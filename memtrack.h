@@ -0,0 +1,48 @@
+#ifndef HOPPER_MEMTRACK_H
+#define HOPPER_MEMTRACK_H
+
+#include <pebble.h>
+
+// -------------------------------------------------------------------
+// Heap accounting for the SDK objects we create
+//
+// Wraps the bitmap, path, layer and window create / destroy calls. Each
+// create is charged the change in heap_bytes_used() across the call, so
+// the numbers include whatever the SDK allocates behind the handle.
+//
+
+typedef enum
+{
+  eMemCategoryBitmap = 0,
+  eMemCategoryPath = 1,
+  eMemCategoryLayer = 2,
+  eMemCategoryWindow = 3,
+  eMemCategoryCount = 4
+} EMemCategory;
+
+GBitmap* MemTrackBitmapCreateWithResource( uint32_t nResourceId );
+void MemTrackBitmapDestroy( GBitmap* pBitmap );
+
+GPath* MemTrackPathCreate( const GPathInfo* pPathInfo );
+void MemTrackPathDestroy( GPath* pPath );
+
+Layer* MemTrackLayerCreate( GRect frame );
+void MemTrackLayerDestroy( Layer* pLayer );
+
+Window* MemTrackWindowCreate();
+void MemTrackWindowDestroy( Window* pWindow );
+
+// Record heap_bytes_used() and keep the peak, call once a tick
+void MemTrackSample();
+
+int MemTrackLiveBytes( EMemCategory eCategory );
+int MemTrackPeakBytes( EMemCategory eCategory );
+int MemTrackPeakHeapBytes();
+
+// Log live and peak bytes per category plus the heap totals
+void MemTrackLogSummary();
+
+// Log anything still alive, returns the number of leaked objects
+int MemTrackReportLeaks();
+
+#endif // HOPPER_MEMTRACK_H
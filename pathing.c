@@ -0,0 +1,202 @@
+#include "pathing.h"
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+#define cnPathingCells ( cnBitboardSide * cnBitboardSide )
+
+static Bitboard g_nReachable[ cnPathingCells ];
+static Bitboard g_nNextHopLo[ cnPathingCells ];
+static Bitboard g_nNextHopHi[ cnPathingCells ];
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+static void RebuildTarget( Bitboard nLand, int nTarget )
+{
+  g_nReachable[ nTarget ] = 0;
+  g_nNextHopLo[ nTarget ] = 0;
+  g_nNextHopHi[ nTarget ] = 0;
+
+  Bitboard nLayer = (Bitboard)1 << nTarget;
+
+  if( ! ( nLayer & nLand ) )
+  {
+    // Can't stand on the target so nothing reaches it
+    return;
+  }
+
+  Bitboard nVisited = nLayer;
+  Bitboard nLo = 0;
+  Bitboard nHi = 0;
+
+  while( nLayer )
+  {
+    Bitboard nNext = BitboardNeighbours( nLayer ) & nLand & ~nVisited;
+
+    // Every new cell hops back into the previous layer. Pick the first
+    // direction that gets there, in NE, NW, SE, SW order.
+    Bitboard nRest = nNext;
+
+    Bitboard nNE = nRest & BitboardShiftSW( nLayer );
+    nRest &= ~nNE;
+
+    Bitboard nNW = nRest & BitboardShiftSE( nLayer );
+    nRest &= ~nNW;
+
+    Bitboard nSE = nRest & BitboardShiftNW( nLayer );
+    nRest &= ~nSE;
+
+    Bitboard nSW = nRest;
+
+    nLo |= nNW | nSW;
+    nHi |= nSE | nSW;
+
+    nVisited |= nNext;
+    nLayer = nNext;
+  }
+
+  g_nReachable[ nTarget ] = nVisited;
+  g_nNextHopLo[ nTarget ] = nLo;
+  g_nNextHopHi[ nTarget ] = nHi;
+}
+
+static void RebuildTargets( Bitboard nLand, Bitboard nTargets )
+{
+  while( nTargets )
+  {
+    int nTarget = BitboardLowestIndex( nTargets );
+    nTargets &= nTargets - 1;
+
+    RebuildTarget( nLand, nTarget );
+  }
+}
+
+void PathingRebuild( Bitboard nLand )
+{
+  RebuildTargets( nLand, c_nBitboardFull );
+}
+
+void PathingOnTileChanged( Bitboard nLand, int x, int y, bool fLand )
+{
+  int nCell = BitboardIndex( x, y );
+  Bitboard nAffected = BitboardCell( x, y );
+
+  if( fLand )
+  {
+    // New land joins every component it touches
+    Bitboard nNeighbours = BitboardNeighbours( nAffected ) & nLand;
+
+    while( nNeighbours )
+    {
+      int nNeighbour = BitboardLowestIndex( nNeighbours );
+      nNeighbours &= nNeighbours - 1;
+
+      nAffected |= g_nReachable[ nNeighbour ];
+    }
+  }
+  else
+  {
+    // Only the component the tile was part of can split
+    nAffected |= g_nReachable[ nCell ];
+  }
+
+  RebuildTargets( nLand, nAffected );
+}
+
+Bitboard PathingReachableFrom( int x, int y )
+{
+  return g_nReachable[ BitboardIndex( x, y ) ];
+}
+
+static Bitboard StepCell( Bitboard nCell, int nDirection )
+{
+  switch( nDirection )
+  {
+    default:
+    case 0:
+      return BitboardShiftNE( nCell );
+
+    case 1:
+      return BitboardShiftNW( nCell );
+
+    case 2:
+      return BitboardShiftSE( nCell );
+
+    case 3:
+      return BitboardShiftSW( nCell );
+  }
+}
+
+bool PathingNextHop( int nFromX,
+                     int nFromY,
+                     int nToX,
+                     int nToY,
+                     int* pnDirection )
+{
+  int nFrom = BitboardIndex( nFromX, nFromY );
+  int nTo = BitboardIndex( nToX, nToY );
+
+  if( nFrom == nTo )
+  {
+    return false;
+  }
+
+  Bitboard nReachable = g_nReachable[ nTo ];
+
+  if( ( nReachable >> nFrom ) & 1 )
+  {
+    *pnDirection = (int)( ( g_nNextHopLo[ nTo ] >> nFrom ) & 1 )
+                 | (int)( ( ( g_nNextHopHi[ nTo ] >> nFrom ) & 1 ) << 1 );
+    return true;
+  }
+
+  // Off the land graph, step on to anything connected to the target
+  Bitboard nFromCell = (Bitboard)1 << nFrom;
+
+  for( int nDirection = 0 ; nDirection < 4 ; ++nDirection )
+  {
+    if( StepCell( nFromCell, nDirection ) & nReachable )
+    {
+      *pnDirection = nDirection;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool PathingFindNearest( Bitboard nLand,
+                         int x,
+                         int y,
+                         Bitboard nTargets,
+                         int* pnTargetX,
+                         int* pnTargetY )
+{
+  Bitboard nLayer = BitboardCell( x, y );
+  Bitboard nVisited = nLayer;
+
+  // Standing on a target doesn't count as reaching it
+  nTargets &= ~nLayer;
+
+  while( nLayer )
+  {
+    nLayer = BitboardNeighbours( nLayer ) & nLand & ~nVisited;
+    nVisited |= nLayer;
+
+    Bitboard nHit = nLayer & nTargets;
+
+    if( nHit )
+    {
+      int nCell = BitboardLowestIndex( nHit );
+
+      *pnTargetX = nCell / cnBitboardSide;
+      *pnTargetY = nCell % cnBitboardSide;
+      return true;
+    }
+  }
+
+  return false;
+}
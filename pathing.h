@@ -0,0 +1,46 @@
+#ifndef HOPPER_PATHING_H
+#define HOPPER_PATHING_H
+
+#include "bitboard.h"
+
+// -------------------------------------------------------------------
+// All-pairs next hop tables over the land tiles
+//
+// For every target cell we keep the set of cells that can reach it and,
+// for each of those cells, the direction of the first hop along a
+// shortest path. Directions are stored as two bitboards per target
+// ( low and high bit of the direction code ) so one lookup is a couple
+// of shifts and the whole table is 1.5KB.
+//
+// Direction codes follow EEntityDirectionFacing : NE, NW, SE, SW.
+//
+
+// Rebuild every target from scratch, used when a new map is generated
+void PathingRebuild( Bitboard nLand );
+
+// Patch the tables after a single tile flips. Only targets in the
+// component(s) touching the tile are rebuilt.
+void PathingOnTileChanged( Bitboard nLand, int x, int y, bool fLand );
+
+// Cells from which ( x, y ) can be reached over land
+Bitboard PathingReachableFrom( int x, int y );
+
+// First hop from ( nFromX, nFromY ) towards ( nToX, nToY ). Returns false
+// if the target can't be reached. A source that is not itself land (the
+// player can start in the sea) steps onto any neighbour that can reach
+// the target.
+bool PathingNextHop( int nFromX,
+                     int nFromY,
+                     int nToX,
+                     int nToY,
+                     int* pnDirection );
+
+// Closest cell in nTargets reachable from ( x, y ), by hop count
+bool PathingFindNearest( Bitboard nLand,
+                         int x,
+                         int y,
+                         Bitboard nTargets,
+                         int* pnTargetX,
+                         int* pnTargetY );
+
+#endif // HOPPER_PATHING_H
@@ -0,0 +1,91 @@
+#include "rng.h"
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+uint64_t RngMix64( uint64_t n )
+{
+  n = ( n ^ ( n >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+  n = ( n ^ ( n >> 27 ) ) * 0x94D049BB133111EBULL;
+  return n ^ ( n >> 31 );
+}
+
+void RngSeed( struct Rng* pRng, uint64_t nSeed )
+{
+  // Spread the seed with splitmix64 so similar seeds give unrelated
+  // streams, and the state can never be all zero in practice
+  uint64_t nA = RngMix64( nSeed += 0x9E3779B97F4A7C15ULL );
+  uint64_t nB = RngMix64( nSeed += 0x9E3779B97F4A7C15ULL );
+
+  pRng->m_nState[ 0 ] = (uint32_t)nA;
+  pRng->m_nState[ 1 ] = (uint32_t)( nA >> 32 );
+  pRng->m_nState[ 2 ] = (uint32_t)nB;
+  pRng->m_nState[ 3 ] = (uint32_t)( nB >> 32 );
+
+  if( ! ( nA | nB ) )
+  {
+    pRng->m_nState[ 0 ] = 1;
+  }
+}
+
+void RngJump( struct Rng* pRng )
+{
+  static const uint32_t c_nJump[] = { 0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b };
+
+  uint32_t s0 = 0;
+  uint32_t s1 = 0;
+  uint32_t s2 = 0;
+  uint32_t s3 = 0;
+
+  for( int nWord = 0 ; nWord < 4 ; ++nWord )
+  {
+    for( int nBit = 0 ; nBit < 32 ; ++nBit )
+    {
+      if( c_nJump[ nWord ] & ( (uint32_t)1 << nBit ) )
+      {
+        s0 ^= pRng->m_nState[ 0 ];
+        s1 ^= pRng->m_nState[ 1 ];
+        s2 ^= pRng->m_nState[ 2 ];
+        s3 ^= pRng->m_nState[ 3 ];
+      }
+
+      RngNext( pRng );
+    }
+  }
+
+  pRng->m_nState[ 0 ] = s0;
+  pRng->m_nState[ 1 ] = s1;
+  pRng->m_nState[ 2 ] = s2;
+  pRng->m_nState[ 3 ] = s3;
+}
+
+void RngStream( struct Rng* pRng, const struct Rng* pBase, int nStream )
+{
+  *pRng = *pBase;
+
+  for( int nJump = 0 ; nJump < nStream ; ++nJump )
+  {
+    RngJump( pRng );
+  }
+}
+
+void RngFill( struct Rng* pRng, uint32_t* pnOut, int nCount )
+{
+  // Counter mode : hash key + index with a 32 bit finaliser. No element
+  // depends on another so the loop vectorises.
+  uint32_t nKey = RngNext( pRng );
+
+  for( int n = 0 ; n < nCount ; ++n )
+  {
+    uint32_t x = nKey + (uint32_t)n * 0x9E3779B9u;
+
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+
+    pnOut[ n ] = x;
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef HOPPER_RNG_H
+#define HOPPER_RNG_H
+
+#include <stdint.h>
+
+// -------------------------------------------------------------------
+// Per game random numbers
+//
+// xoshiro128** : 16 bytes of state, 32 bit output, only shifts, xors and
+// a couple of 32 bit multiplies per draw so it's cheap on the watch. Each
+// game owns its generator, so a run replays exactly from its seed and any
+// number of games can run side by side.
+//
+// RngJump advances a stream by 2^64 draws, giving non-overlapping
+// streams for parallel workers. RngFill produces a block of draws from
+// a single key with no dependency between elements, so the compiler can
+// vectorise it.
+//
+
+struct Rng
+{
+  uint32_t m_nState[ 4 ];
+};
+
+void RngSeed( struct Rng* pRng, uint64_t nSeed );
+
+// Equivalent to 2^64 calls to RngNext
+void RngJump( struct Rng* pRng );
+
+// Copy of pBase moved on to its nStream'th non-overlapping stream
+void RngStream( struct Rng* pRng, const struct Rng* pBase, int nStream );
+
+// nCount independent draws, advances pRng by a single step
+void RngFill( struct Rng* pRng, uint32_t* pnOut, int nCount );
+
+// splitmix64 finaliser, also handy for hashing coordinates into seeds
+uint64_t RngMix64( uint64_t n );
+
+static inline uint32_t RngRotl( uint32_t n, int nBits )
+{
+  return ( n << nBits ) | ( n >> ( 32 - nBits ) );
+}
+
+static inline uint32_t RngNext( struct Rng* pRng )
+{
+  uint32_t* s = pRng->m_nState;
+
+  uint32_t nResult = RngRotl( s[ 1 ] * 5, 7 ) * 9;
+  uint32_t t = s[ 1 ] << 9;
+
+  s[ 2 ] ^= s[ 0 ];
+  s[ 3 ] ^= s[ 1 ];
+  s[ 1 ] ^= s[ 2 ];
+  s[ 0 ] ^= s[ 3 ];
+  s[ 2 ] ^= t;
+  s[ 3 ] = RngRotl( s[ 3 ], 11 );
+
+  return nResult;
+}
+
+// Uniform in [ 0, nRange ) using a multiply rather than a divide
+static inline int RngBelow( struct Rng* pRng, int nRange )
+{
+  return (int)( ( (uint64_t)RngNext( pRng ) * (uint32_t)nRange ) >> 32 );
+}
+
+// Same scaling for a 16 bit slice of a draw from RngFill
+static inline int RngScale16( uint32_t nBits, int nRange )
+{
+  return (int)( ( ( nBits & 0xFFFF ) * (uint32_t)nRange ) >> 16 );
+}
+
+#endif // HOPPER_RNG_H
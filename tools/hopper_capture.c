@@ -0,0 +1,240 @@
+// -------------------------------------------------------------------
+// Host tool : record a capture stream
+//
+// Build with the host build and run from the repo root :
+//
+//   cmake -S . -B build && cmake --build build --target hopper_capture
+//   ./build/hopper_capture [ out file ] [ seconds ] [ seed ]
+//
+// Runs main.c against the host stand-in for the SDK with a scripted
+// player pressing buttons at random, and records every frame drawn into
+// a capture stream ( see framecapture.h ) through the same hook the
+// watch uses. capture.hcap, 600 seconds and seed 1 by default, the same
+// seed gives the same file.
+//
+// Afterwards the file is read back to check every frame comes out as it
+// was drawn, and the frames are encoded again on their own to time the
+// encoder. Results are key value lines.
+//
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// main.c's types and globals are file scope, so take the whole file and
+// keep its entry point out of the way
+#define main HopperAppMain
+#include "main.c"
+#undef main
+
+// Input is looked at every this many ms of game time
+#define cnStepMs 100
+
+static double NowNs()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint32_t Mix( uint32_t nChecksum, uint32_t nValue )
+{
+  return ( nChecksum ^ nValue ) * 16777619u;
+}
+
+// Rows without their padding, as the stream has them
+static uint32_t FrameChecksum( uint32_t nChecksum, const uint8_t* pRows, int nBytesPerRow )
+{
+  for( int y = 0 ; y < cnFrameCaptureHeight ; ++y )
+  {
+    for( int nByte = 0 ; nByte < cnFrameCaptureRowBytes ; ++nByte )
+    {
+      nChecksum = Mix( nChecksum, pRows[ y * nBytesPerRow + nByte ] );
+    }
+  }
+
+  return nChecksum;
+}
+
+static bool WriteFile( const uint8_t* pData, int nBytes, void* pContext )
+{
+  return fwrite( pData, 1, (size_t)nBytes, (FILE*)pContext ) == (size_t)nBytes;
+}
+
+static bool CountBytes( const uint8_t* pData, int nBytes, void* pContext )
+{
+  (void)pData;
+  *(long*)pContext += nBytes;
+
+  return true;
+}
+
+// Something a player might do, or nothing, about every cnStepMs
+static void ScriptedInput( struct Rng* pRng )
+{
+  int nRoll = RngBelow( pRng, 100 );
+
+  if( nRoll < 12 )
+  {
+    host_click( BUTTON_ID_SELECT );
+  }
+  else if( nRoll < 20 )
+  {
+    host_click( BUTTON_ID_UP );
+  }
+  else if( nRoll < 28 )
+  {
+    host_click( BUTTON_ID_DOWN );
+  }
+  else if( nRoll < 29 )
+  {
+    host_long_click( BUTTON_ID_SELECT );
+  }
+  else if( nRoll < 30 )
+  {
+    host_accel_tap();
+  }
+  else if(    nRoll < 32
+           && UndoHopsAvailable() > 0
+           && ! g_gameOptions.m_fGameOver )
+  {
+    // Back with nothing to undo would quit
+    host_click( BUTTON_ID_BACK );
+  }
+}
+
+// Whole decimal number and nothing else, strtoull alone takes a sign
+// and stops quietly at the first bad character
+static bool ParseUnsigned( const char* szArg, uint64_t* pnValue )
+{
+  char* szEnd = NULL;
+
+  if( szArg[ 0 ] < '0' || szArg[ 0 ] > '9' )
+  {
+    return false;
+  }
+
+  errno = 0;
+  *pnValue = strtoull( szArg, &szEnd, 10 );
+
+  return errno == 0 && *szEnd == '\0';
+}
+
+int main( int argc, char** argv )
+{
+  const char* szOut = argc > 1 ? argv[ 1 ] : "capture.hcap";
+  uint64_t nSecondsArg = 600;
+  uint64_t nSeed = 1;
+
+  if(    argc > 4
+      || szOut[ 0 ] == '-'
+      || ( argc > 2 && ( ! ParseUnsigned( argv[ 2 ], &nSecondsArg ) || nSecondsArg == 0 || nSecondsArg > 86400 ) )
+      || ( argc > 3 && ! ParseUnsigned( argv[ 3 ], &nSeed ) ) )
+  {
+    fprintf( stderr, "usage : hopper_capture [ out_file ] [ seconds ] [ seed ]\n" );
+    return 1;
+  }
+
+  long nSeconds = (long)nSecondsArg;
+
+  FILE* pFile = fopen( szOut, "wb" );
+
+  if( ! pFile )
+  {
+    fprintf( stderr, "can't write %s\n", szOut );
+    return 1;
+  }
+
+  handle_init();
+
+  // The app seeds itself from the clock, start again from the seed
+  RngSeed( &g_gameOptions.m_rng, nSeed );
+  ResetGame();
+
+  struct Rng inputRng;
+  RngSeed( &inputRng, nSeed ^ 0x5eedull );
+
+  FrameCaptureBegin( WriteFile, pFile );
+
+  uint32_t nDrawnChecksum = 2166136261u;
+
+  for( long nStep = 0 ; nStep < nSeconds * 1000 / cnStepMs ; ++nStep )
+  {
+    ScriptedInput( &inputRng );
+
+    host_advance_ms( cnStepMs );
+
+    if( host_render() )
+    {
+      GBitmap* pScreen = host_screen_bitmap();
+
+      nDrawnChecksum = FrameChecksum( nDrawnChecksum, gbitmap_get_data( pScreen ), gbitmap_get_bytes_per_row( pScreen ) );
+    }
+  }
+
+  FrameCaptureEnd();
+  fclose( pFile );
+
+  int nFrames = FrameCaptureFrames();
+  int nKeyframes = FrameCaptureKeyframes();
+  int nBytes = FrameCaptureBytes();
+
+  handle_deinit();
+
+  // Read it back
+  pFile = fopen( szOut, "rb" );
+
+  uint8_t* pData = malloc( (size_t)nBytes );
+  size_t nRead = pFile ? fread( pData, 1, (size_t)nBytes, pFile ) : 0;
+
+  if( pFile )
+  {
+    fclose( pFile );
+  }
+
+  static struct FrameCaptureReader reader;
+
+  if(    nRead != (size_t)nBytes
+      || ! FrameCaptureReaderOpen( &reader, pData, nRead ) )
+  {
+    fprintf( stderr, "can't read %s back\n", szOut );
+    return 1;
+  }
+
+  uint32_t nReadChecksum = 2166136261u;
+  const uint8_t* pFrame;
+  long nEncodedBytes = 0;
+  double fEncodeNs = 0.0;
+  int nReadFrames = 0;
+
+  FrameCaptureBegin( CountBytes, &nEncodedBytes );
+
+  while( FrameCaptureReaderNext( &reader, &pFrame ) )
+  {
+    nReadChecksum = FrameChecksum( nReadChecksum, pFrame, cnFrameCaptureRowBytes );
+
+    double fStart = NowNs();
+    FrameCaptureFrame( pFrame, cnFrameCaptureRowBytes, reader.m_nTimeMs );
+    fEncodeNs += NowNs() - fStart;
+
+    ++nReadFrames;
+  }
+
+  FrameCaptureEnd();
+  free( pData );
+
+  printf( "seconds %ld\n", nSeconds );
+  printf( "frames %d\n", nFrames );
+  printf( "keyframes %d\n", nKeyframes );
+  printf( "bytes %d\n", nBytes );
+  printf( "bytes_per_frame %.1f\n", nFrames ? (double)nBytes / nFrames : 0.0 );
+  printf( "bytes_per_minute %.0f\n", nSeconds ? (double)nBytes * 60.0 / nSeconds : 0.0 );
+  printf( "raw_bytes %ld\n", (long)nFrames * cnFrameCaptureFrameBytes );
+  printf( "frames_read_back %d\n", nReadFrames );
+  printf( "frames_identical %d\n", nReadFrames == nFrames && nReadChecksum == nDrawnChecksum );
+  printf( "reencoded_bytes %ld\n", nEncodedBytes );
+  printf( "encode_us_per_frame %.2f\n", nReadFrames ? fEncodeNs / nReadFrames * 1e-3 : 0.0 );
+
+  return 0;
+}
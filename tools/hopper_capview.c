@@ -0,0 +1,327 @@
+// -------------------------------------------------------------------
+// Host tool : read capture streams
+//
+// Build and run from the repo root :
+//
+//   cc -O2 -I. tools/hopper_capview.c framecapture.c -o hopper_capview
+//   ./hopper_capview info capture.hcap
+//   ./hopper_capview decode capture.hcap out_dir [ first ] [ count ]
+//   ./hopper_capview diff a.hcap b.hcap [ out_dir ]
+//
+// info prints what's in a stream ( see framecapture.h ). decode writes
+// frames from first on, all of them by default, as out_dir/frame_NNNNNN.pbm,
+// seeking through the index to the keyframe before first. diff reads two
+// streams side by side and counts the frames and pixels that differ,
+// writing each differing frame's changed pixels as a pbm if given a
+// directory. A stream recorded on the watch comes off the phone as the
+// bytes of its data logging session, tag "HCAP", in order.
+//
+// Results are key value lines, nothing but the pbm files is written.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "framecapture.h"
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+static uint8_t* LoadFile( const char* szPath, size_t* pnBytes )
+{
+  FILE* pFile = fopen( szPath, "rb" );
+
+  if( ! pFile )
+  {
+    fprintf( stderr, "can't read %s\n", szPath );
+    return NULL;
+  }
+
+  fseek( pFile, 0, SEEK_END );
+  long nBytes = ftell( pFile );
+  fseek( pFile, 0, SEEK_SET );
+
+  uint8_t* pData = malloc( nBytes > 0 ? (size_t)nBytes : 1 );
+
+  if(    nBytes < 0
+      || fread( pData, 1, (size_t)nBytes, pFile ) != (size_t)nBytes )
+  {
+    fprintf( stderr, "can't read %s\n", szPath );
+    free( pData );
+    pData = NULL;
+  }
+
+  fclose( pFile );
+
+  *pnBytes = (size_t)nBytes;
+
+  return pData;
+}
+
+static bool OpenStream( struct FrameCaptureReader* pReader, const char* szPath, uint8_t** ppData )
+{
+  size_t nBytes = 0;
+
+  *ppData = LoadFile( szPath, &nBytes );
+
+  if(    *ppData
+      && ! FrameCaptureReaderOpen( pReader, *ppData, nBytes ) )
+  {
+    fprintf( stderr, "%s isn't a capture stream\n", szPath );
+    free( *ppData );
+    *ppData = NULL;
+  }
+
+  return *ppData != NULL;
+}
+
+// PBM is 1 for black and the leftmost pixel in the top bit, the stream
+// is 1 for white and the leftmost pixel in the bottom bit
+static bool WritePbm( const char* szPath, const uint8_t* pFrame )
+{
+  FILE* pFile = fopen( szPath, "wb" );
+
+  if( ! pFile )
+  {
+    fprintf( stderr, "can't write %s\n", szPath );
+    return false;
+  }
+
+  fprintf( pFile, "P4\n%d %d\n", cnFrameCaptureWidth, cnFrameCaptureHeight );
+
+  for( int nByte = 0 ; nByte < cnFrameCaptureFrameBytes ; ++nByte )
+  {
+    uint8_t nIn = pFrame[ nByte ];
+    uint8_t nOut = 0;
+
+    for( int nBit = 0 ; nBit < 8 ; ++nBit )
+    {
+      nOut |= (uint8_t)( ( ( nIn >> nBit ) & 1 ) << ( 7 - nBit ) );
+    }
+
+    fputc( (uint8_t)~nOut, pFile );
+  }
+
+  fclose( pFile );
+
+  return true;
+}
+
+static int Info( const char* szPath )
+{
+  static struct FrameCaptureReader reader;
+  uint8_t* pData;
+
+  if( ! OpenStream( &reader, szPath, &pData ) )
+  {
+    return 1;
+  }
+
+  const uint8_t* pFrame;
+  uint32_t nFrames = 0;
+  uint32_t nKeyframes = 0;
+
+  while( FrameCaptureReaderNext( &reader, &pFrame ) )
+  {
+    nKeyframes += reader.m_nSinceKeyframe == 0;
+    ++nFrames;
+  }
+
+  printf( "bytes %zu\n", reader.m_nBytes + ( reader.m_fIndexed ? cnFrameCaptureTrailerBytes : 0 ) );
+  printf( "indexed %d\n", reader.m_fIndexed );
+  printf( "keyframe_interval %d\n", reader.m_nKeyframeInterval );
+  printf( "frames %u\n", nFrames );
+  printf( "keyframes %u\n", nKeyframes );
+  printf( "seconds %.1f\n", reader.m_nTimeMs / 1000.0 );
+  printf( "bytes_per_frame %.1f\n", nFrames ? (double)reader.m_nBytes / nFrames : 0.0 );
+  printf( "complete %d\n", reader.m_nPos == reader.m_nBytes );
+
+  free( pData );
+
+  return 0;
+}
+
+static int Decode( const char* szPath, const char* szDir, uint32_t nFirst, uint32_t nCount )
+{
+  static struct FrameCaptureReader reader;
+  uint8_t* pData;
+
+  if( ! OpenStream( &reader, szPath, &pData ) )
+  {
+    return 1;
+  }
+
+  if(    nFirst > 0
+      && ! FrameCaptureReaderSeek( &reader, nFirst ) )
+  {
+    fprintf( stderr, "no frame %u in %s\n", nFirst, szPath );
+    free( pData );
+    return 1;
+  }
+
+  const uint8_t* pFrame;
+  uint32_t nWritten = 0;
+  uint32_t nSkipped = 0;
+
+  while(    nWritten < nCount
+         && FrameCaptureReaderNext( &reader, &pFrame ) )
+  {
+    uint32_t nFrame = reader.m_nFrame - 1;
+
+    // Frames between the keyframe and the first one asked for
+    if( nFrame < nFirst )
+    {
+      ++nSkipped;
+      continue;
+    }
+
+    char szFile[ 1024 ];
+    snprintf( szFile, sizeof( szFile ), "%s/frame_%06u.pbm", szDir, nFrame );
+
+    if( ! WritePbm( szFile, pFrame ) )
+    {
+      free( pData );
+      return 1;
+    }
+
+    ++nWritten;
+  }
+
+  printf( "frames_written %u\n", nWritten );
+  printf( "frames_decoded_to_seek %u\n", nSkipped );
+
+  free( pData );
+
+  return 0;
+}
+
+static int Diff( const char* szPathA, const char* szPathB, const char* szDir )
+{
+  static struct FrameCaptureReader readerA;
+  static struct FrameCaptureReader readerB;
+  uint8_t* pDataA;
+  uint8_t* pDataB;
+
+  if( ! OpenStream( &readerA, szPathA, &pDataA ) )
+  {
+    return 1;
+  }
+
+  if( ! OpenStream( &readerB, szPathB, &pDataB ) )
+  {
+    free( pDataA );
+    return 1;
+  }
+
+  const uint8_t* pFrameA;
+  const uint8_t* pFrameB;
+  bool fMoreA = true;
+  bool fMoreB = true;
+
+  uint32_t nFramesA = 0;
+  uint32_t nFramesB = 0;
+  uint32_t nDiffering = 0;
+  long nFirstDiffering = -1;
+  long nPixels = 0;
+
+  for( ;; )
+  {
+    fMoreA = fMoreA && FrameCaptureReaderNext( &readerA, &pFrameA );
+    fMoreB = fMoreB && FrameCaptureReaderNext( &readerB, &pFrameB );
+
+    nFramesA += fMoreA;
+    nFramesB += fMoreB;
+
+    if( ! fMoreA || ! fMoreB )
+    {
+      if( ! fMoreA && ! fMoreB )
+      {
+        break;
+      }
+
+      continue;
+    }
+
+    uint8_t vChanged[ cnFrameCaptureFrameBytes ];
+    int nFramePixels = 0;
+
+    for( int nByte = 0 ; nByte < cnFrameCaptureFrameBytes ; ++nByte )
+    {
+      vChanged[ nByte ] = pFrameA[ nByte ] ^ pFrameB[ nByte ];
+      nFramePixels += __builtin_popcount( vChanged[ nByte ] );
+    }
+
+    if( nFramePixels == 0 )
+    {
+      continue;
+    }
+
+    uint32_t nFrame = readerA.m_nFrame - 1;
+
+    if( nFirstDiffering < 0 )
+    {
+      nFirstDiffering = nFrame;
+    }
+
+    ++nDiffering;
+    nPixels += nFramePixels;
+
+    if( szDir )
+    {
+      char szFile[ 1024 ];
+      snprintf( szFile, sizeof( szFile ), "%s/diff_%06u.pbm", szDir, nFrame );
+
+      // Changed pixels come out black on white
+      for( int nByte = 0 ; nByte < cnFrameCaptureFrameBytes ; ++nByte )
+      {
+        vChanged[ nByte ] = (uint8_t)~vChanged[ nByte ];
+      }
+
+      WritePbm( szFile, vChanged );
+    }
+  }
+
+  printf( "frames_a %u\n", nFramesA );
+  printf( "frames_b %u\n", nFramesB );
+  printf( "frames_differing %u\n", nDiffering );
+  printf( "first_differing_frame %ld\n", nFirstDiffering );
+  printf( "pixels_differing %ld\n", nPixels );
+  printf( "identical %d\n", nFramesA == nFramesB && nDiffering == 0 );
+
+  free( pDataA );
+  free( pDataB );
+
+  return 0;
+}
+
+int main( int argc, char** argv )
+{
+  const char* szCommand = argc > 1 ? argv[ 1 ] : "";
+
+  if( strcmp( szCommand, "info" ) == 0 && argc > 2 )
+  {
+    return Info( argv[ 2 ] );
+  }
+
+  if( strcmp( szCommand, "decode" ) == 0 && argc > 3 )
+  {
+    return Decode( argv[ 2 ],
+                   argv[ 3 ],
+                   argc > 4 ? (uint32_t)strtoul( argv[ 4 ], NULL, 10 ) : 0,
+                   argc > 5 ? (uint32_t)strtoul( argv[ 5 ], NULL, 10 ) : UINT32_MAX );
+  }
+
+  if( strcmp( szCommand, "diff" ) == 0 && argc > 3 )
+  {
+    return Diff( argv[ 2 ], argv[ 3 ], argc > 4 ? argv[ 4 ] : NULL );
+  }
+
+  fprintf( stderr,
+           "usage : hopper_capview info file\n"
+           "        hopper_capview decode file out_dir [ first ] [ count ]\n"
+           "        hopper_capview diff file_a file_b [ out_dir ]\n" );
+
+  return 1;
+}
@@ -0,0 +1,184 @@
+// -------------------------------------------------------------------
+// Host tool : best score solver
+//
+// Build with the host build and run from the repo root :
+//
+//   cmake -S . -B build && cmake --build build --target hopper_solve
+//   ./build/hopper_solve [ seed ] [ horizon ] [ threads ] [ table bits ]
+//
+// Deals the first level for the seed and searches for the best score
+// reachable within the horizon, one action deeper per pass ( see
+// env/hopper_solver.h ). Each pass prints a line of stats, the final
+// answer and its line of actions follow as key value pairs. Threads of
+// 0 uses every core, the default table is 2^22 slots, 64MB.
+//
+// The search runs on the env's twin of the rules, so the best line is
+// played again through main.c itself, dealt live from the same seed,
+// and best_score is what the watch scores for it. If the two ever
+// disagree the tool says so and fails.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// main.c's types and globals are file scope, so take the whole file and
+// keep its entry point out of the way
+#define main HopperAppMain
+#include "main.c"
+#undef main
+
+#include "env/hopper_solver.h"
+
+static const char c_vActionLetters[ eHopperActionCount ] = { 'u', 'd', 'h' };
+
+// Summed over every pass
+static double g_fTotalSeconds = 0;
+static uint64_t g_nTotalNodes = 0;
+static uint64_t g_nTotalProbes = 0;
+static uint64_t g_nTotalHits = 0;
+
+static void PrintPass( const struct HopperSolveResult* pResult )
+{
+  g_fTotalSeconds += pResult->m_fSeconds;
+  g_nTotalNodes += pResult->m_nNodes;
+  g_nTotalProbes += pResult->m_nTableProbes;
+  g_nTotalHits += pResult->m_nTableHits;
+
+  printf( "pass %2d  best %6d  nodes %12llu  %7.2fM nodes/s  hits %5.1f%%  cutoffs %11llu  %8.3fs\n",
+          pResult->m_nHorizon,
+          pResult->m_nBestScore,
+          (unsigned long long)pResult->m_nNodes,
+          pResult->m_fSeconds > 0 ? (double)pResult->m_nNodes / pResult->m_fSeconds / 1e6 : 0.0,
+          pResult->m_nTableProbes ? 100.0 * (double)pResult->m_nTableHits / (double)pResult->m_nTableProbes : 0.0,
+          (unsigned long long)pResult->m_nCutoffs,
+          pResult->m_fSeconds );
+
+  fflush( stdout );
+}
+
+// The line played through main.c as the solver plays it, a hop or a
+// turn then an enemy tick, stopping once the exit is taken or the
+// penguin is caught. Returns the watch's score at the end.
+static int WatchReplay( uint64_t nSeed, const uint8_t* pnLine, int nLength )
+{
+  g_nLevelPackLevels = 0;
+  g_nLevelsDealt = 0;
+
+  RngSeed( &g_gameOptions.m_rng, nSeed );
+  g_gameOptions.m_nScore = 0;
+  g_gameOptions.m_fGameOver = false;
+
+  GenerateNewMap();
+
+  for( int nAction = 0 ; nAction < nLength ; ++nAction )
+  {
+    int nLevelsDealt = g_nLevelsDealt;
+
+    if( pnLine[ nAction ] == eHopperActionHop )
+    {
+      HandlePlayerMove();
+    }
+    else
+    {
+      UpdatePlayerDirectionFacing( pnLine[ nAction ] == eHopperActionRotateUp );
+    }
+
+    if( g_nLevelsDealt != nLevelsDealt )
+    {
+      break;
+    }
+
+    TickEnemyUnits();
+
+    if( g_gameOptions.m_fGameOver )
+    {
+      break;
+    }
+  }
+
+  return g_gameOptions.m_nScore;
+}
+
+int main( int argc, char** argv )
+{
+  uint64_t nSeed = argc > 1 ? strtoull( argv[ 1 ], NULL, 0 ) : 1;
+  int nHorizon = argc > 2 ? atoi( argv[ 2 ] ) : 32;
+  int nThreads = argc > 3 ? atoi( argv[ 3 ] ) : 0;
+  int nTableBits = argc > 4 ? atoi( argv[ 4 ] ) : 22;
+
+  if(    nHorizon < 1
+      || nHorizon > cnHopperSolveMaxHorizon
+      || nTableBits < 10
+      || nTableBits > 32 )
+  {
+    fprintf( stderr, "horizon must be 1 to %d, table bits 10 to 32\n", cnHopperSolveMaxHorizon );
+    return 1;
+  }
+
+  struct HopperSolver* pSolver = HopperSolverCreate( nTableBits, nThreads );
+
+  if( ! pSolver )
+  {
+    fprintf( stderr, "out of memory for 2^%d table slots\n", nTableBits );
+    return 1;
+  }
+
+  struct HopperGame game;
+  HopperGameReset( &game, nSeed );
+
+  printf( "seed %llu\n", (unsigned long long)nSeed );
+  printf( "threads %d\n", HopperSolverThreadCount( pSolver ) );
+  printf( "gems %d\n", BitboardCount( game.m_nGems ) );
+  printf( "enemies %d\n", game.m_nNumberOfEnemies );
+
+  struct HopperSolveResult result;
+
+  HopperSolverRun( pSolver, &game, nHorizon, PrintPass, &result );
+
+  char szLine[ cnHopperSolveMaxHorizon + 1 ];
+
+  for( int nAction = 0 ; nAction < result.m_nLineLength ; ++nAction )
+  {
+    szLine[ nAction ] = c_vActionLetters[ result.m_vLine[ nAction ] ];
+  }
+
+  szLine[ result.m_nLineLength ] = '\0';
+
+  // Play the line back through the rules to check the score it claims
+  struct HopperGame replay = game;
+
+  for( int nAction = 0 ; nAction < result.m_nLineLength ; ++nAction )
+  {
+    HopperGameStep( &replay, (EHopperAction)result.m_vLine[ nAction ] );
+  }
+
+  // And through the watch's own code before calling it the board's best
+  handle_init();
+
+  int nWatchScore = WatchReplay( nSeed, result.m_vLine, result.m_nLineLength );
+
+  handle_deinit();
+
+  printf( "horizon %d\n", result.m_nHorizon );
+  printf( "best_score %d\n", nWatchScore );
+  printf( "solver_score %d\n", result.m_nBestScore );
+  printf( "replay_score %d\n", replay.m_nScore );
+  printf( "watch_agrees %d\n", nWatchScore == result.m_nBestScore );
+  printf( "line %s\n", result.m_nLineLength ? szLine : "-" );
+  printf( "level_cleared %d\n", result.m_fLevelCleared ? 1 : 0 );
+  printf( "caught %d\n", result.m_fCaught ? 1 : 0 );
+  printf( "nodes %llu\n", (unsigned long long)g_nTotalNodes );
+  printf( "nodes_per_sec %.0f\n", g_fTotalSeconds > 0 ? (double)g_nTotalNodes / g_fTotalSeconds : 0.0 );
+  printf( "table_hit_rate %.4f\n", g_nTotalProbes ? (double)g_nTotalHits / (double)g_nTotalProbes : 0.0 );
+  printf( "seconds %.3f\n", g_fTotalSeconds );
+
+  HopperSolverDestroy( pSolver );
+
+  if( nWatchScore != result.m_nBestScore )
+  {
+    fprintf( stderr, "main.c scores the line %d, the solver %d\n", nWatchScore, result.m_nBestScore );
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,371 @@
+// -------------------------------------------------------------------
+// Host tool : generate a level pack
+//
+// Build and run from the repo root :
+//
+//   cc -O2 -pthread -I. tools/levelpack_gen.c levelpack.c env/hopper_game.c rng.c -o levelpack_gen
+//   ./levelpack_gen [ out ] [ candidates ] [ keep ] [ seed ]
+//
+// Deals candidate boards with the same rules as GenerateNewMap, on every
+// core, scores them and writes the best into a pack ( see levelpack.h )
+// for the watch to load as the LEVEL_PACK raw resource. Defaults write
+// res/levels.pack from a million candidates.
+//
+// A board is only kept if the penguin starts on land, can reach every
+// gem and the exit, and no skeleton starts within two hops or on a
+// tile another one has. Kept boards score higher for more gems, a longer
+// walk from the start to the exit and more reachable land.
+//
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "env/hopper_game.h"
+#include "levelpack.h"
+
+static const int c_nScorePerGem = 8;
+static const int c_nScorePerExitHop = 4;
+static const int c_nScorePerReachableTile = 1;
+static const int c_nMinEnemyDistance = 3;
+
+struct Candidate
+{
+  int m_nScore;
+  uint64_t m_nSeed;
+  struct PackedLevel m_level;
+};
+
+struct Worker
+{
+  pthread_t m_thread;
+
+  uint64_t m_nFirst;
+  uint64_t m_nLast;
+  uint64_t m_nBaseSeed;
+  int m_nKeep;
+
+  // Min heap on score, the weakest kept board on top
+  struct Candidate* m_pHeap;
+  int m_nHeapCount;
+
+  uint64_t m_nRejected;
+};
+
+static double NowNs()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Higher score first, then the lower seed so the output is stable
+static bool Better( const struct Candidate* pA, const struct Candidate* pB )
+{
+  if( pA->m_nScore != pB->m_nScore )
+  {
+    return pA->m_nScore > pB->m_nScore;
+  }
+
+  return pA->m_nSeed < pB->m_nSeed;
+}
+
+static int CompareBestFirst( const void* pA, const void* pB )
+{
+  return Better( (const struct Candidate*)pA, (const struct Candidate*)pB ) ? -1 : 1;
+}
+
+static void SiftDown( struct Candidate* pHeap, int nCount, int nIndex )
+{
+  for( ;; )
+  {
+    int nWorst = nIndex;
+    int nLeft = nIndex * 2 + 1;
+    int nRight = nLeft + 1;
+
+    if( nLeft < nCount && Better( &pHeap[ nWorst ], &pHeap[ nLeft ] ) ) nWorst = nLeft;
+    if( nRight < nCount && Better( &pHeap[ nWorst ], &pHeap[ nRight ] ) ) nWorst = nRight;
+
+    if( nWorst == nIndex )
+    {
+      return;
+    }
+
+    struct Candidate swap = pHeap[ nIndex ];
+    pHeap[ nIndex ] = pHeap[ nWorst ];
+    pHeap[ nWorst ] = swap;
+    nIndex = nWorst;
+  }
+}
+
+static void SiftUp( struct Candidate* pHeap, int nIndex )
+{
+  while( nIndex > 0 )
+  {
+    int nParent = ( nIndex - 1 ) / 2;
+
+    if( ! Better( &pHeap[ nParent ], &pHeap[ nIndex ] ) )
+    {
+      return;
+    }
+
+    struct Candidate swap = pHeap[ nIndex ];
+    pHeap[ nIndex ] = pHeap[ nParent ];
+    pHeap[ nParent ] = swap;
+    nIndex = nParent;
+  }
+}
+
+static void Keep( struct Worker* pWorker, const struct Candidate* pCandidate )
+{
+  if( pWorker->m_nHeapCount < pWorker->m_nKeep )
+  {
+    pWorker->m_pHeap[ pWorker->m_nHeapCount ] = *pCandidate;
+    SiftUp( pWorker->m_pHeap, pWorker->m_nHeapCount++ );
+  }
+  else if( Better( pCandidate, &pWorker->m_pHeap[ 0 ] ) )
+  {
+    pWorker->m_pHeap[ 0 ] = *pCandidate;
+    SiftDown( pWorker->m_pHeap, pWorker->m_nHeapCount, 0 );
+  }
+}
+
+// -1 for a board not worth shipping
+static int ScoreBoard( const struct HopperGame* pGame )
+{
+  Bitboard nLand = pGame->m_nLand;
+  Bitboard nStart = BitboardCell( pGame->m_nPlayerX, pGame->m_nPlayerY );
+  Bitboard nExit = BitboardCell( pGame->m_nExitX, pGame->m_nExitY );
+
+  if(    ! ( nLand & nStart )
+      || ! ( nLand & nExit )
+      || nStart == nExit
+      || ! pGame->m_nGems )
+  {
+    return -1;
+  }
+
+  Bitboard nEnemies = 0;
+
+  for( int nEnemy = 0 ; nEnemy < pGame->m_nNumberOfEnemies ; ++nEnemy )
+  {
+    Bitboard nCell = BitboardCell( pGame->m_vEnemyX[ nEnemy ], pGame->m_vEnemyY[ nEnemy ] );
+    int nDeltaX = abs( pGame->m_vEnemyX[ nEnemy ] - pGame->m_nPlayerX );
+    int nDeltaY = abs( pGame->m_vEnemyY[ nEnemy ] - pGame->m_nPlayerY );
+
+    // The watch keeps one skeleton a tile
+    if(    ! ( nLand & nCell )
+        || ( nEnemies & nCell )
+        || ( nDeltaX > nDeltaY ? nDeltaX : nDeltaY ) < c_nMinEnemyDistance )
+    {
+      return -1;
+    }
+
+    nEnemies |= nCell;
+  }
+
+  // Breadth first over land a hop at a time
+  Bitboard nSeen = nStart;
+  Bitboard nFrontier = nStart;
+  int nExitHops = -1;
+
+  for( int nHops = 0 ; nFrontier ; ++nHops )
+  {
+    if( nFrontier & nExit )
+    {
+      nExitHops = nHops;
+    }
+
+    nFrontier = BitboardNeighbours( nFrontier ) & nLand & ~nSeen;
+    nSeen |= nFrontier;
+  }
+
+  if(    nExitHops < 0
+      || ( pGame->m_nGems & ~nSeen ) )
+  {
+    return -1;
+  }
+
+  return   BitboardCount( pGame->m_nGems ) * c_nScorePerGem
+         + nExitHops * c_nScorePerExitHop
+         + BitboardCount( nSeen ) * c_nScorePerReachableTile;
+}
+
+static void PackGame( const struct HopperGame* pGame, struct PackedLevel* pLevel )
+{
+  memset( pLevel, 0, sizeof( *pLevel ) );
+
+  pLevel->m_nLand = pGame->m_nLand;
+  pLevel->m_nGems = pGame->m_nGems;
+  pLevel->m_nPlayerX = pGame->m_nPlayerX;
+  pLevel->m_nPlayerY = pGame->m_nPlayerY;
+  pLevel->m_nExitX = pGame->m_nExitX;
+  pLevel->m_nExitY = pGame->m_nExitY;
+  pLevel->m_nNumberOfEnemies = pGame->m_nNumberOfEnemies;
+
+  for( int nEnemy = 0 ; nEnemy < pGame->m_nNumberOfEnemies && nEnemy < cnLevelPackMaxEnemies ; ++nEnemy )
+  {
+    pLevel->m_vEnemyX[ nEnemy ] = pGame->m_vEnemyX[ nEnemy ];
+    pLevel->m_vEnemyY[ nEnemy ] = pGame->m_vEnemyY[ nEnemy ];
+  }
+}
+
+static void* WorkerMain( void* pContext )
+{
+  struct Worker* pWorker = (struct Worker*)pContext;
+  struct HopperGame game;
+
+  for( uint64_t nCandidate = pWorker->m_nFirst ; nCandidate < pWorker->m_nLast ; ++nCandidate )
+  {
+    uint64_t nSeed = RngMix64( pWorker->m_nBaseSeed + nCandidate );
+
+    HopperGameReset( &game, nSeed );
+
+    int nScore = ScoreBoard( &game );
+
+    if( nScore < 0 )
+    {
+      ++pWorker->m_nRejected;
+      continue;
+    }
+
+    struct Candidate candidate;
+
+    candidate.m_nScore = nScore;
+    candidate.m_nSeed = nSeed;
+    PackGame( &game, &candidate.m_level );
+
+    Keep( pWorker, &candidate );
+  }
+
+  return NULL;
+}
+
+// Whole decimal number and nothing else, strtoull alone takes a sign
+// and stops quietly at the first bad character
+static bool ParseUnsigned( const char* szArg, uint64_t* pnValue )
+{
+  char* szEnd = NULL;
+
+  if( szArg[ 0 ] < '0' || szArg[ 0 ] > '9' )
+  {
+    return false;
+  }
+
+  errno = 0;
+  *pnValue = strtoull( szArg, &szEnd, 10 );
+
+  return errno == 0 && *szEnd == '\0';
+}
+
+int main( int argc, char** argv )
+{
+  const char* szOut = argc > 1 ? argv[ 1 ] : "res/levels.pack";
+  uint64_t nCandidates = 1000000;
+  uint64_t nKeepArg = 256;
+  uint64_t nBaseSeed = 1;
+
+  if(    argc > 5
+      || szOut[ 0 ] == '-'
+      || ( argc > 2 && ( ! ParseUnsigned( argv[ 2 ], &nCandidates ) || nCandidates == 0 ) )
+      || ( argc > 3 && ( ! ParseUnsigned( argv[ 3 ], &nKeepArg ) || nKeepArg == 0 || nKeepArg > 65535 ) )
+      || ( argc > 4 && ! ParseUnsigned( argv[ 4 ], &nBaseSeed ) ) )
+  {
+    fprintf( stderr, "usage : levelpack_gen [ out_file ] [ candidates ] [ keep ] [ seed ]\n" );
+    return 1;
+  }
+
+  int nKeep = (int)nKeepArg;
+
+  int nThreads = (int)sysconf( _SC_NPROCESSORS_ONLN );
+
+  if( nThreads < 1 )
+  {
+    nThreads = 1;
+  }
+
+  struct Worker* pWorkers = (struct Worker*)calloc( (size_t)nThreads, sizeof( struct Worker ) );
+
+  double fStart = NowNs();
+
+  for( int nThread = 0 ; nThread < nThreads ; ++nThread )
+  {
+    struct Worker* pWorker = &pWorkers[ nThread ];
+
+    pWorker->m_nFirst = nCandidates * (uint64_t)nThread / (uint64_t)nThreads;
+    pWorker->m_nLast = nCandidates * (uint64_t)( nThread + 1 ) / (uint64_t)nThreads;
+    pWorker->m_nBaseSeed = nBaseSeed;
+    pWorker->m_nKeep = nKeep;
+    pWorker->m_pHeap = (struct Candidate*)malloc( sizeof( struct Candidate ) * (size_t)nKeep );
+
+    pthread_create( &pWorker->m_thread, NULL, WorkerMain, pWorker );
+  }
+
+  // Every thread's best, then the best of those
+  struct Candidate* pAll = (struct Candidate*)malloc( sizeof( struct Candidate ) * (size_t)nKeep * (size_t)nThreads );
+  int nAll = 0;
+  uint64_t nRejected = 0;
+
+  for( int nThread = 0 ; nThread < nThreads ; ++nThread )
+  {
+    struct Worker* pWorker = &pWorkers[ nThread ];
+
+    pthread_join( pWorker->m_thread, NULL );
+
+    memcpy( &pAll[ nAll ], pWorker->m_pHeap, sizeof( struct Candidate ) * (size_t)pWorker->m_nHeapCount );
+    nAll += pWorker->m_nHeapCount;
+    nRejected += pWorker->m_nRejected;
+
+    free( pWorker->m_pHeap );
+  }
+
+  double fSeconds = ( NowNs() - fStart ) / 1e9;
+
+  qsort( pAll, (size_t)nAll, sizeof( struct Candidate ), CompareBestFirst );
+
+  int nLevels = nAll < nKeep ? nAll : nKeep;
+
+  FILE* pFile = fopen( szOut, "wb" );
+
+  if( ! pFile )
+  {
+    fprintf( stderr, "can't write %s\n", szOut );
+    return 1;
+  }
+
+  uint8_t vHeader[ cnLevelPackHeaderBytes ];
+  LevelPackWriteHeader( vHeader, (uint32_t)nLevels, (uint32_t)nBaseSeed );
+  fwrite( vHeader, 1, sizeof( vHeader ), pFile );
+
+  for( int nLevel = 0 ; nLevel < nLevels ; ++nLevel )
+  {
+    uint8_t vRecord[ cnLevelPackRecordBytes ];
+    LevelPackWriteRecord( vRecord, &pAll[ nLevel ].m_level );
+    fwrite( vRecord, 1, sizeof( vRecord ), pFile );
+  }
+
+  fclose( pFile );
+
+  printf( "threads %d\n", nThreads );
+  printf( "candidates %llu\n", (unsigned long long)nCandidates );
+  printf( "rejected %llu\n", (unsigned long long)nRejected );
+  printf( "candidates_per_sec %.0f\n", (double)nCandidates / fSeconds );
+  printf( "levels %d\n", nLevels );
+
+  if( nLevels > 0 )
+  {
+    printf( "score_best %d\n", pAll[ 0 ].m_nScore );
+    printf( "score_worst_kept %d\n", pAll[ nLevels - 1 ].m_nScore );
+  }
+
+  printf( "pack_bytes %u\n", (unsigned)LevelPackOffset( (uint32_t)nLevels ) );
+
+  free( pAll );
+  free( pWorkers );
+
+  return 0;
+}
@@ -0,0 +1,89 @@
+#include <string.h>
+
+#include "undo.h"
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+// cnUndoSnapshots * 88 bytes, the whole history is under 3k
+static struct UndoSnapshot g_vUndoSnapshots[ cnUndoSnapshots ];
+
+// Slot the next snapshot goes in, and how many are held behind it
+static int g_nUndoNext = 0;
+static int g_nUndoCount = 0;
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+static int SlotBack( int nStepsBack )
+{
+  return ( g_nUndoNext - 1 - nStepsBack + cnUndoSnapshots ) % cnUndoSnapshots;
+}
+
+// Steps back from the newest snapshot to the most recent hop, -1 if
+// there is no hop with a snapshot before it to go back to
+static int FindLastHop()
+{
+  for( int nBack = 0 ; nBack + 1 < g_nUndoCount ; ++nBack )
+  {
+    if( g_vUndoSnapshots[ SlotBack( nBack ) ].m_fAfterHop )
+    {
+      return nBack;
+    }
+  }
+
+  return -1;
+}
+
+void UndoClear()
+{
+  g_nUndoNext = 0;
+  g_nUndoCount = 0;
+}
+
+void UndoPush( const struct UndoSnapshot* pSnapshot )
+{
+  memcpy( &g_vUndoSnapshots[ g_nUndoNext ], pSnapshot, sizeof( struct UndoSnapshot ) );
+
+  g_nUndoNext = ( g_nUndoNext + 1 ) % cnUndoSnapshots;
+
+  if( g_nUndoCount < cnUndoSnapshots )
+  {
+    ++g_nUndoCount;
+  }
+}
+
+bool UndoPopHop( struct UndoSnapshot* pSnapshot )
+{
+  int nBack = FindLastHop();
+
+  if( nBack < 0 )
+  {
+    return false;
+  }
+
+  // Drop the hop and the ticks after it
+  g_nUndoNext = SlotBack( nBack );
+  g_nUndoCount -= nBack + 1;
+
+  memcpy( pSnapshot, &g_vUndoSnapshots[ SlotBack( 0 ) ], sizeof( struct UndoSnapshot ) );
+
+  return true;
+}
+
+int UndoHopsAvailable()
+{
+  int nHops = 0;
+
+  for( int nBack = 0 ; nBack + 1 < g_nUndoCount ; ++nBack )
+  {
+    if( g_vUndoSnapshots[ SlotBack( nBack ) ].m_fAfterHop )
+    {
+      ++nHops;
+    }
+  }
+
+  return nHops;
+}
@@ -0,0 +1,60 @@
+#ifndef HOPPER_UNDO_H
+#define HOPPER_UNDO_H
+
+#include "analytics.h"
+#include "bitboard.h"
+#include "rng.h"
+
+// -------------------------------------------------------------------
+// Undo history
+//
+// A fixed ring of compact game snapshots, one pushed after every hop
+// and every enemy tick. Everything that changes during a level fits in
+// a UndoSnapshot, so taking one and putting it back are both a memcpy;
+// the caller rebuilds anything derived from the land ( pathing,
+// connectivity ) after a restore. Once the ring is full the oldest
+// snapshot is overwritten, so only the last few hops can be undone.
+//
+// The Rng state is part of the snapshot, so after an undo the skeletons
+// walk the same way they did before. So are the analytics counts, so
+// what was undone isn't counted again when it's played again.
+//
+
+#define cnUndoSnapshots 32
+#define cnUndoMaxEnemies 8
+
+struct UndoSnapshot
+{
+  Bitboard m_nLand;
+  Bitboard m_nGems;
+  struct Rng m_rng;
+  int32_t m_nScore;
+
+  uint8_t m_nPlayerX;
+  uint8_t m_nPlayerY;
+  uint8_t m_nPlayerFacing;
+  uint8_t m_fCanLevelBeExited;
+
+  // Set on snapshots taken straight after a hop, undo goes back to the
+  // snapshot before one of these
+  uint8_t m_fAfterHop;
+
+  uint8_t m_nNumberOfEnemies;
+  uint8_t m_vEnemyX[ cnUndoMaxEnemies ];
+  uint8_t m_vEnemyY[ cnUndoMaxEnemies ];
+  uint8_t m_vEnemyFacing[ cnUndoMaxEnemies ];
+
+  struct AnalyticsCounts m_analytics;
+};
+
+void UndoClear();
+void UndoPush( const struct UndoSnapshot* pSnapshot );
+
+// Drops everything back to and including the most recent hop, and copies
+// out the snapshot that is now the newest. False, and nothing dropped,
+// if there is no hop left in the history to undo.
+bool UndoPopHop( struct UndoSnapshot* pSnapshot );
+
+int UndoHopsAvailable();
+
+#endif // HOPPER_UNDO_H
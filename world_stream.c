@@ -0,0 +1,288 @@
+#include <stddef.h>
+
+#include "world_stream.h"
+#include "rng.h"
+
+// -------------------------------------------------------------------
+// Globals
+//
+
+// A view straddles at most four chunks, the rest is slack for hopping
+// back and forth over a chunk border
+#define cnChunkCacheSize 6
+
+#define cnMaxChunkDiffs 32
+
+struct WorldChunk
+{
+  int32_t m_nChunkX;
+  int32_t m_nChunkY;
+  Bitboard m_nLand;
+  Bitboard m_nGems;
+  uint32_t m_nLastUsed;
+  bool m_fValid;
+};
+
+struct WorldChunkDiff
+{
+  int32_t m_nChunkX;
+  int32_t m_nChunkY;
+  Bitboard m_nLandXor;
+  Bitboard m_nGemsXor;
+  uint32_t m_nLastUsed;
+  bool m_fValid;
+};
+
+static uint32_t g_nWorldSeed = 0;
+static uint32_t g_nWorldClock = 0;
+
+static struct WorldChunk g_worldChunkCache[ cnChunkCacheSize ];
+static struct WorldChunkDiff g_worldChunkDiffs[ cnMaxChunkDiffs ];
+
+// -------------------------------------------------------------------
+// Functions
+//
+
+// Rounds towards minus infinity so negative world cells land in the
+// right chunk
+static int FloorDiv( int n, int d )
+{
+  return ( n >= 0 ) ? ( n / d ) : -( ( -n + d - 1 ) / d );
+}
+
+void WorldStreamGenerateChunk( int nChunkX, int nChunkY, Bitboard* pnLand, Bitboard* pnGems )
+{
+  uint64_t nState =   ( (uint64_t)g_nWorldSeed << 32 )
+                    ^ ( (uint64_t)(uint32_t)nChunkX * 0x9E3779B1u )
+                    ^ ( (uint64_t)(uint32_t)nChunkY * 0x85EBCA77u << 16 );
+
+  Bitboard nLand = 0;
+  Bitboard nGems = 0;
+
+  // Same odds as GenerateNewMap : 5 in 6 land, 1 in 5 land cells a gem.
+  // One 64 bit draw covers four cells.
+  for( int nCell = 0 ; nCell < cnChunkSide * cnChunkSide ; nCell += 4 )
+  {
+    nState += 0x9E3779B97F4A7C15ULL;
+    uint64_t nDraw = RngMix64( nState );
+
+    for( int nSub = 0 ; nSub < 4 ; ++nSub )
+    {
+      uint32_t nBits = (uint32_t)( nDraw >> ( nSub * 16 ) ) & 0xFFFF;
+      Bitboard nCellBit = (Bitboard)1 << ( nCell + nSub );
+
+      if( ( nBits & 0xFF ) % 6 != 0 )
+      {
+        nLand |= nCellBit;
+
+        if( ( nBits >> 8 ) % 5 == 0 )
+        {
+          nGems |= nCellBit;
+        }
+      }
+    }
+  }
+
+  *pnLand = nLand;
+  *pnGems = nGems;
+}
+
+void WorldStreamInit( uint32_t nSeed )
+{
+  g_nWorldSeed = nSeed;
+  g_nWorldClock = 0;
+
+  for( int nChunk = 0 ; nChunk < cnChunkCacheSize ; ++nChunk )
+  {
+    g_worldChunkCache[ nChunk ].m_fValid = false;
+  }
+
+  for( int nDiff = 0 ; nDiff < cnMaxChunkDiffs ; ++nDiff )
+  {
+    g_worldChunkDiffs[ nDiff ].m_fValid = false;
+  }
+}
+
+static struct WorldChunkDiff* FindDiff( int nChunkX, int nChunkY )
+{
+  for( int nDiff = 0 ; nDiff < cnMaxChunkDiffs ; ++nDiff )
+  {
+    struct WorldChunkDiff* pDiff = &g_worldChunkDiffs[ nDiff ];
+
+    if(    pDiff->m_fValid
+        && pDiff->m_nChunkX == nChunkX
+        && pDiff->m_nChunkY == nChunkY )
+    {
+      return pDiff;
+    }
+  }
+
+  return NULL;
+}
+
+static void StoreDiff( const struct WorldChunk* pChunk )
+{
+  Bitboard nBaseLand = 0;
+  Bitboard nBaseGems = 0;
+
+  WorldStreamGenerateChunk( pChunk->m_nChunkX, pChunk->m_nChunkY, &nBaseLand, &nBaseGems );
+
+  Bitboard nLandXor = pChunk->m_nLand ^ nBaseLand;
+  Bitboard nGemsXor = pChunk->m_nGems ^ nBaseGems;
+
+  struct WorldChunkDiff* pDiff = FindDiff( pChunk->m_nChunkX, pChunk->m_nChunkY );
+
+  if( ! nLandXor && ! nGemsXor )
+  {
+    // Back to how it was generated, nothing to remember
+    if( pDiff )
+    {
+      pDiff->m_fValid = false;
+    }
+
+    return;
+  }
+
+  if( ! pDiff )
+  {
+    // Take a free slot, or failing that forget the stalest diff
+    pDiff = &g_worldChunkDiffs[ 0 ];
+
+    for( int nDiff = 0 ; nDiff < cnMaxChunkDiffs ; ++nDiff )
+    {
+      struct WorldChunkDiff* pCandidate = &g_worldChunkDiffs[ nDiff ];
+
+      if( ! pCandidate->m_fValid )
+      {
+        pDiff = pCandidate;
+        break;
+      }
+
+      if( pCandidate->m_nLastUsed < pDiff->m_nLastUsed )
+      {
+        pDiff = pCandidate;
+      }
+    }
+  }
+
+  pDiff->m_nChunkX = pChunk->m_nChunkX;
+  pDiff->m_nChunkY = pChunk->m_nChunkY;
+  pDiff->m_nLandXor = nLandXor;
+  pDiff->m_nGemsXor = nGemsXor;
+  pDiff->m_nLastUsed = g_nWorldClock;
+  pDiff->m_fValid = true;
+}
+
+static struct WorldChunk* GetChunk( int nChunkX, int nChunkY )
+{
+  struct WorldChunk* pVictim = &g_worldChunkCache[ 0 ];
+
+  for( int nChunk = 0 ; nChunk < cnChunkCacheSize ; ++nChunk )
+  {
+    struct WorldChunk* pChunk = &g_worldChunkCache[ nChunk ];
+
+    if(    pChunk->m_fValid
+        && pChunk->m_nChunkX == nChunkX
+        && pChunk->m_nChunkY == nChunkY )
+    {
+      pChunk->m_nLastUsed = ++g_nWorldClock;
+      return pChunk;
+    }
+
+    if(    pVictim->m_fValid
+        && ( ! pChunk->m_fValid || pChunk->m_nLastUsed < pVictim->m_nLastUsed ) )
+    {
+      pVictim = pChunk;
+    }
+  }
+
+  if( pVictim->m_fValid )
+  {
+    StoreDiff( pVictim );
+  }
+
+  pVictim->m_nChunkX = nChunkX;
+  pVictim->m_nChunkY = nChunkY;
+  pVictim->m_nLastUsed = ++g_nWorldClock;
+  pVictim->m_fValid = true;
+
+  WorldStreamGenerateChunk( nChunkX, nChunkY, &pVictim->m_nLand, &pVictim->m_nGems );
+
+  struct WorldChunkDiff* pDiff = FindDiff( nChunkX, nChunkY );
+
+  if( pDiff )
+  {
+    pVictim->m_nLand ^= pDiff->m_nLandXor;
+    pVictim->m_nGems ^= pDiff->m_nGemsXor;
+    pDiff->m_nLastUsed = g_nWorldClock;
+  }
+
+  return pVictim;
+}
+
+void WorldStreamReadView( int nOriginX, int nOriginY, Bitboard* pnLand, Bitboard* pnGems )
+{
+  Bitboard nLand = 0;
+  Bitboard nGems = 0;
+
+  for( int x = 0 ; x < cnChunkSide ; ++x )
+  {
+    int nWorldX = nOriginX + x;
+    int nChunkX = FloorDiv( nWorldX, cnChunkSide );
+
+    for( int y = 0 ; y < cnChunkSide ; ++y )
+    {
+      int nWorldY = nOriginY + y;
+      int nChunkY = FloorDiv( nWorldY, cnChunkSide );
+
+      struct WorldChunk* pChunk = GetChunk( nChunkX, nChunkY );
+
+      int nCellX = nWorldX - nChunkX * cnChunkSide;
+      int nCellY = nWorldY - nChunkY * cnChunkSide;
+
+      nLand = BitboardSet( nLand, x, y, BitboardTest( pChunk->m_nLand, nCellX, nCellY ) );
+      nGems = BitboardSet( nGems, x, y, BitboardTest( pChunk->m_nGems, nCellX, nCellY ) );
+    }
+  }
+
+  *pnLand = nLand;
+  *pnGems = nGems;
+}
+
+void WorldStreamWriteView( int nOriginX, int nOriginY, Bitboard nLand, Bitboard nGems )
+{
+  for( int x = 0 ; x < cnChunkSide ; ++x )
+  {
+    int nWorldX = nOriginX + x;
+    int nChunkX = FloorDiv( nWorldX, cnChunkSide );
+
+    for( int y = 0 ; y < cnChunkSide ; ++y )
+    {
+      int nWorldY = nOriginY + y;
+      int nChunkY = FloorDiv( nWorldY, cnChunkSide );
+
+      struct WorldChunk* pChunk = GetChunk( nChunkX, nChunkY );
+
+      int nCellX = nWorldX - nChunkX * cnChunkSide;
+      int nCellY = nWorldY - nChunkY * cnChunkSide;
+
+      pChunk->m_nLand = BitboardSet( pChunk->m_nLand, nCellX, nCellY, BitboardTest( nLand, x, y ) );
+      pChunk->m_nGems = BitboardSet( pChunk->m_nGems, nCellX, nCellY, BitboardTest( nGems, x, y ) );
+    }
+  }
+}
+
+int WorldStreamDiffCount()
+{
+  int nCount = 0;
+
+  for( int nDiff = 0 ; nDiff < cnMaxChunkDiffs ; ++nDiff )
+  {
+    if( g_worldChunkDiffs[ nDiff ].m_fValid )
+    {
+      ++nCount;
+    }
+  }
+
+  return nCount;
+}
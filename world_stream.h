@@ -0,0 +1,34 @@
+#ifndef HOPPER_WORLD_STREAM_H
+#define HOPPER_WORLD_STREAM_H
+
+#include "bitboard.h"
+
+// -------------------------------------------------------------------
+// Endless world made of seeded chunks
+//
+// The world is an unbounded grid of 8x8 chunks. A chunk's starting land
+// and gems come purely from the world seed and its coordinate, so it can
+// be thrown away and regenerated at any time. A small LRU cache holds the
+// chunks around the view; when one is evicted only its changes (tiles
+// created or crumbled, gems taken) are kept, as xor masks against the
+// generated chunk. The diff store is fixed size too, so memory stays flat
+// however far the penguin goes. When it fills up the stalest diff is
+// dropped and that chunk comes back as freshly generated.
+//
+
+#define cnChunkSide cnBitboardSide
+
+void WorldStreamInit( uint32_t nSeed );
+
+// Copy the 8x8 view whose bottom corner is world cell ( nOriginX, nOriginY )
+void WorldStreamReadView( int nOriginX, int nOriginY, Bitboard* pnLand, Bitboard* pnGems );
+
+// Store the view back, recording any changes against the generated world
+void WorldStreamWriteView( int nOriginX, int nOriginY, Bitboard nLand, Bitboard nGems );
+
+// Chunk generation straight from the seed, no caching
+void WorldStreamGenerateChunk( int nChunkX, int nChunkY, Bitboard* pnLand, Bitboard* pnGems );
+
+int WorldStreamDiffCount();
+
+#endif // HOPPER_WORLD_STREAM_H